@@ -10,7 +10,9 @@
 
 #include "clustering_benchmark.hpp"
 #include "configuration_parser.hpp"
+#include "csv.hpp"
 #include "matrix.hpp"
+#include "point_storage.hpp"
 
 #include "kmeans_three_stage.hpp"
 #include "kmeans_three_stage_buffered.hpp"
@@ -18,16 +20,21 @@
 #include "kmeans_single_stage_buffered.hpp"
 #include "kmeans_naive.hpp"
 #include "kmeans_initializer.hpp"
+#include "timer.hpp"
 
 #include "SystemConfig.h"
 
 #include <boost/program_options.hpp>
 #include <boost/compute/core.hpp>
+#include <boost/filesystem.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <set>
+#include <map>
 #include <memory>
 #include <stdexcept>
 
@@ -69,6 +76,16 @@ public:
             ("config",
              po::value<std::string>(),
              "Configuration file")
+            ("points-file",
+             po::value<std::string>(),
+             "Stream points from partitioned file (buffered pipelines)")
+            ("output",
+             po::value<std::string>(),
+             "Write centroids, masses and labels to binary file")
+            ("init-centroids",
+             po::value<std::string>(),
+             "Start from centroids in binary or result file"
+             " (\"input\" for centroids in input file)")
             ;
 
         po::options_description hidden("Hidden options");
@@ -126,6 +143,21 @@ public:
             config_file_ = vm["config"].as<std::string>();
         }
 
+        if (vm.count("points-file")) {
+            points_file_ = vm["points-file"].as<std::string>();
+        }
+
+        if (vm.count("output")) {
+            output_file_ = vm["output"].as<std::string>();
+        }
+
+        if (vm.count("init-centroids")) {
+            init_centroids_ = vm["init-centroids"].as<std::string>();
+            if (init_centroids_ == "input") {
+                init_centroids_ = input_file_;
+            }
+        }
+
         // Ensure we have required options
         if (input_file_.empty()) {
             std::cout << "No input file specified." << std::endl;
@@ -181,6 +213,18 @@ public:
         return config_file_;
     }
 
+    std::string points_file() const {
+        return points_file_;
+    }
+
+    std::string output_file() const {
+        return output_file_;
+    }
+
+    std::string init_centroids() const {
+        return init_centroids_;
+    }
+
 private:
     bool verbose_ = false;
     uint32_t k_ = 0;
@@ -192,6 +236,9 @@ private:
     std::string csv_file_;
     bool config_ = false;
     std::string config_file_;
+    std::string points_file_;
+    std::string output_file_;
+    std::string init_centroids_;
 };
 
 template <typename PointT, typename LabelT, typename MassT, bool ColMajor = true>
@@ -201,10 +248,194 @@ public:
         auto bm_config = config.get_benchmark_configuration();
         auto km_config = config.get_kmeans_configuration();
 
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true> points;
+        // Reduced points are widened to PointT on load, and narrowed
+        // again by the pipeline for device memory
+        Clustering::PointStorage const point_storage =
+            Clustering::PointStorageHelper::parse(km_config.point_type);
+        Clustering::BinaryFormat::DataType stored_dtype =
+            (sizeof(PointT) == sizeof(double))
+            ? Clustering::BinaryFormat::DataType::Float64
+            : Clustering::BinaryFormat::DataType::Float32
+            ;
+        if (point_storage == Clustering::PointStorage::Half) {
+            stored_dtype = Clustering::BinaryFormat::DataType::Float16;
+        }
+        else if (point_storage == Clustering::PointStorage::BFloat16) {
+            stored_dtype = Clustering::BinaryFormat::DataType::BFloat16;
+        }
+
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> points;
+
+        // CSV and TSV files are detected by extension,
+        // all other files must be in BinaryFormat
+        std::string const input_extension =
+            boost::filesystem::path(options.input_file())
+            .extension().string();
+        bool const text_input =
+            input_extension == ".csv" or input_extension == ".tsv";
 
         Clustering::BinaryFormat binformat;
-        binformat.read(options.input_file().c_str(), points);
+        Clustering::BinaryFormat::Header input_header = {};
+        std::vector<Clustering::BinaryFormat::ChunkInfo> input_chunks;
+        uint64_t load_bytes = 0;
+        Timer::Timer load_timer;
+        load_timer.start();
+        if (text_input) {
+            cle::CSV csv;
+            if (input_extension == ".tsv") {
+                csv.set_delimiter('\t');
+            }
+            if (csv.read_csv_parallel(options.input_file().c_str(), points)
+                    < 0) {
+                return -1;
+            }
+        }
+        else if (binformat.read(options.input_file().c_str(), points) < 0) {
+            return -1;
+        }
+        uint64_t load_time = load_timer.stop<std::chrono::nanoseconds>();
+
+        if (text_input) {
+            load_bytes = boost::filesystem::file_size(options.input_file());
+        }
+        else {
+            if (Clustering::BinaryFormat::read_header(
+                        options.input_file().c_str(),
+                        input_header,
+                        input_chunks
+                        ) < 0)
+            {
+                return -1;
+            }
+            load_bytes =
+                (uint64_t) points.rows() * points.cols()
+                * Clustering::BinaryFormat::dtype_size(input_header.dtype);
+        }
+
+        // Buffered pipelines can stream pre-partitioned input files,
+        // which hold column-major chunks in the storage format
+        bool const stream_input =
+            ColMajor
+            and point_storage != Clustering::PointStorage::Int8
+            and not text_input
+            and options.points_file().empty()
+            and input_header.layout
+            == Clustering::BinaryFormat::Layout::Partitioned
+            and input_header.dtype == stored_dtype;
+
+        bool auto_pipeline = km_config.pipeline == "auto";
+        if (auto_pipeline) {
+            // Only the fused buffered pipeline stores reduced points
+            km_config.pipeline =
+                (point_storage != Clustering::PointStorage::Native)
+                ? "single_stage_buffered"
+                : select_pipeline(
+                    config,
+                    points.rows(),
+                    points.cols(),
+                    km_config.clusters
+                    );
+        }
+
+        if (
+                point_storage != Clustering::PointStorage::Native
+                and km_config.pipeline != "single_stage_buffered"
+           )
+        {
+            std::cerr
+                << "Point type " << km_config.point_type
+                << " requires the single_stage_buffered pipeline"
+                << std::endl;
+            return -1;
+        }
+
+        if (km_config.append_points != 0) {
+            if (
+                    km_config.pipeline != "three_stage_buffered"
+                    and km_config.pipeline != "single_stage_buffered"
+               )
+            {
+                std::cerr
+                    << "Appending points requires a buffered pipeline"
+                    << std::endl;
+                return -1;
+            }
+            if (km_config.append_points + km_config.clusters > points.rows())
+            {
+                std::cerr
+                    << "Appending " << km_config.append_points
+                    << " points leaves fewer points than clusters"
+                    << std::endl;
+                return -1;
+            }
+            if (stream_input) {
+                std::cerr
+                    << "Appending points requires points in memory,"
+                    << " convert the input file or set a points file"
+                    << std::endl;
+                return -1;
+            }
+        }
+
+        // Each buffer's labels must fit into a buffer of points
+        if (
+                Clustering::PointStorageHelper::value_size(
+                    point_storage,
+                    sizeof(PointT)
+                    ) * points.cols() < sizeof(LabelT)
+           )
+        {
+            std::cerr
+                << "Point type " << km_config.point_type
+                << " requires at least " << sizeof(LabelT)
+                << " features"
+                << std::endl;
+            return -1;
+        }
+
+        // Quantize with the range of the loaded points
+        Clustering::Quantization quantization;
+        if (point_storage == Clustering::PointStorage::Int8) {
+            quantization = Clustering::Quantization::fit(
+                    points.data(),
+                    points.rows(),
+                    points.cols(),
+                    ColMajor
+                    );
+        }
+
+        using Centroids = cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>;
+        std::function<void(Centroids const&, Centroids&)> init_centroids =
+            Clustering::KmeansInitializer<PointT, ColMajor>::first_x;
+
+        // Warm start from given centroids in every run
+        if (not options.init_centroids().empty()) {
+            auto initial = std::make_shared<Centroids>();
+            if (Clustering::BinaryFormat::read_centroids(
+                        options.init_centroids().c_str(),
+                        *initial
+                        ) < 0)
+            {
+                return -1;
+            }
+            if (
+                    initial->rows() != km_config.clusters
+                    or initial->cols() != points.cols()
+               )
+            {
+                std::cerr
+                    << "Initial centroids have " << initial->rows()
+                    << " clusters and " << initial->cols()
+                    << " features, expected " << km_config.clusters
+                    << " and " << points.cols()
+                    << std::endl;
+                return -1;
+            }
+
+            init_centroids = [initial](Centroids const&, Centroids& c) {
+                c = *initial;
+            };
+        }
 
         Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor> bm(
                 bm_config.runs,
@@ -215,9 +446,9 @@ public:
         bm.initialize(
                 km_config.clusters,
                 points.cols(),
-                Clustering::KmeansInitializer<PointT>::first_x);
+                init_centroids);
 
-        Clustering::KmeansNaive<PointT, LabelT, MassT> kmeans_naive;
+        Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor> kmeans_naive;
         kmeans_naive.initialize();
 
         if (options.verify() || bm_config.verify) {
@@ -243,6 +474,19 @@ public:
             bc::command_queue ll_queue, mu_queue, cu_queue;
             bc::context ll_context, mu_context, cu_context;
 
+            // Only the unbuffered pipeline tracks all dependencies
+            // with events
+            cl_command_queue_properties queue_properties =
+                bc::command_queue::enable_profiling;
+            if (
+                    km_config.out_of_order
+                    and km_config.pipeline == "three_stage"
+               )
+            {
+                queue_properties |=
+                    bc::command_queue::enable_out_of_order_execution;
+            }
+
             {
                 bc::device ll_dev =
                     bc::system::platforms()[ll_config.platform]
@@ -252,7 +496,7 @@ public:
                 ll_queue = bc::command_queue(
                         ll_context,
                         ll_dev,
-                        bc::command_queue::enable_profiling
+                        queue_properties
                         );
             }
 
@@ -272,7 +516,7 @@ public:
                 mu_queue = bc::command_queue(
                         mu_context,
                         mu_dev,
-                        bc::command_queue::enable_profiling
+                        queue_properties
                         );
             }
 
@@ -299,7 +543,7 @@ public:
                 cu_queue = bc::command_queue(
                         cu_context,
                         cu_dev,
-                        bc::command_queue::enable_profiling
+                        queue_properties
                         );
             }
 
@@ -350,7 +594,46 @@ public:
                 threestagebuffered.set_labeler(ll_config);
                 threestagebuffered.set_mass_updater(mu_config);
                 threestagebuffered.set_centroid_updater(cu_config);
-                kmeans = threestagebuffered;
+                if (not options.points_file().empty()) {
+                    threestagebuffered.set_points_file(
+                            options.points_file()
+                            );
+                }
+                if (km_config.buffer_size == "auto") {
+                    threestagebuffered.set_buffer_size(0);
+                }
+                else if (not km_config.buffer_size.empty()) {
+                    threestagebuffered.set_buffer_size(
+                            std::stoul(km_config.buffer_size)
+                            );
+                }
+                // Buffer size is determined by the file's chunk size
+                if (stream_input) {
+                    threestagebuffered.set_partitioned_points_file(
+                            options.input_file(),
+                            input_header.points_offset,
+                            input_header.chunk_size
+                            );
+                }
+                if (
+                        not km_config.checkpoint.empty()
+                        and km_config.checkpoint_interval != 0
+                        )
+                {
+                    threestagebuffered.set_checkpoint(
+                            km_config.checkpoint,
+                            km_config.checkpoint_interval
+                            );
+                }
+                kmeans = (km_config.append_points != 0)
+                    ? append_update(
+                            threestagebuffered,
+                            km_config.append_points,
+                            km_config.append_incremental_iterations,
+                            km_config.append_full_iterations
+                            )
+                    : threestagebuffered
+                    ;
             }
         }
         else if (
@@ -360,6 +643,8 @@ public:
         {
             auto fu_config =
                 config.get_fused_configuration();
+            fu_config.point_storage = point_storage;
+            fu_config.quantization = quantization;
 
             bc::device device =
                 bc::system::platforms()[fu_config.platform]
@@ -400,7 +685,46 @@ public:
                 singlestagebuffered.set_queue(queue);
                 singlestagebuffered.set_context(context);
                 singlestagebuffered.set_fused(fu_config);
-                kmeans = singlestagebuffered;
+                if (not options.points_file().empty()) {
+                    singlestagebuffered.set_points_file(
+                            options.points_file()
+                            );
+                }
+                if (km_config.buffer_size == "auto") {
+                    singlestagebuffered.set_buffer_size(0);
+                }
+                else if (not km_config.buffer_size.empty()) {
+                    singlestagebuffered.set_buffer_size(
+                            std::stoul(km_config.buffer_size)
+                            );
+                }
+                // Buffer size is determined by the file's chunk size
+                if (stream_input) {
+                    singlestagebuffered.set_partitioned_points_file(
+                            options.input_file(),
+                            input_header.points_offset,
+                            input_header.chunk_size
+                            );
+                }
+                if (
+                        not km_config.checkpoint.empty()
+                        and km_config.checkpoint_interval != 0
+                        )
+                {
+                    singlestagebuffered.set_checkpoint(
+                            km_config.checkpoint,
+                            km_config.checkpoint_interval
+                            );
+                }
+                kmeans = (km_config.append_points != 0)
+                    ? append_update(
+                            singlestagebuffered,
+                            km_config.append_points,
+                            km_config.append_incremental_iterations,
+                            km_config.append_full_iterations
+                            )
+                    : singlestagebuffered
+                    ;
             }
         }
 
@@ -411,6 +735,27 @@ public:
             bs = bm.run(kmeans);
         }
 
+        for (auto& m : bs.measurements) {
+            m->set_parameter(
+                    "Pipeline",
+                    km_config.pipeline
+                    );
+            m->set_parameter(
+                    "PipelineSelection",
+                    (auto_pipeline) ? "auto" : "manual"
+                    );
+            m->set_parameter(
+                    "LoadTime",
+                    std::to_string(load_time)
+                    );
+            m->set_parameter(
+                    "LoadThroughputMBs",
+                    std::to_string(
+                        load_bytes * 1000 / std::max(load_time, uint64_t(1))
+                        )
+                    );
+        }
+
         if (options.verbose()) {
             std::cout << "Pipeline: " << km_config.pipeline << " ";
             std::cout << "Types: "
@@ -427,7 +772,9 @@ public:
                     bm.print_result();
                 }
                 else {
-                    std::cout << verify_res << " incorrect labels";
+                    std::cout << verify_res << " incorrect labels ("
+                        << 100.0 * bm.incorrect_label_fraction()
+                        << "%)";
                     std::cout << std::endl;
                     bm.print_result();
                 }
@@ -445,11 +792,227 @@ public:
                     );
         }
 
+        if (not options.output_file().empty()) {
+            // Result files store column-major centroids
+            Centroids const& centroids = bm.centroids();
+            std::vector<PointT> result_centroids(centroids.get_data());
+            if (not ColMajor) {
+                for (size_t f = 0; f < centroids.cols(); ++f) {
+                    for (size_t c = 0; c < centroids.rows(); ++c) {
+                        result_centroids[f * centroids.rows() + c] =
+                            centroids(c, f);
+                    }
+                }
+            }
+
+            if (Clustering::BinaryFormat::write_result(
+                        options.output_file().c_str(),
+                        centroids.cols(),
+                        centroids.rows(),
+                        result_centroids,
+                        bm.masses(),
+                        bm.labels()
+                        ) < 0)
+            {
+                return -1;
+            }
+        }
+
         kmeans_naive.finalize();
         bm.finalize();
 
         return 1;
     }
+
+private:
+    using ClClusteringFunction = typename Clustering::ClusteringBenchmark<
+        PointT,
+        LabelT,
+        MassT,
+        ColMajor>::ClClusteringFunction;
+
+    /*
+     * Cluster all but the last num_appended points, then append them to
+     * the buffered pipeline and update the result. Labels of all points
+     * are returned, such that verification compares with clustering all
+     * points at once. The update is recorded in the run's measurement.
+     */
+    template <typename Pipeline>
+    static ClClusteringFunction append_update(
+            Pipeline pipeline,
+            size_t num_appended,
+            uint32_t incremental_iterations,
+            uint32_t full_iterations
+            )
+    {
+        auto kmeans = std::make_shared<Pipeline>(std::move(pipeline));
+
+        return [=](
+                size_t max_iterations,
+                size_t num_features,
+                std::shared_ptr<const std::vector<PointT>> points,
+                std::shared_ptr<std::vector<PointT>> centroids,
+                std::shared_ptr<std::vector<MassT>> masses,
+                std::shared_ptr<std::vector<LabelT>> labels
+                )
+        {
+            size_t const num_points = points->size() / num_features;
+            size_t const num_initial = num_points - num_appended;
+
+            auto initial_points = std::make_shared<std::vector<PointT>>();
+            auto appended_points = std::make_shared<std::vector<PointT>>();
+            initial_points->reserve(num_initial * num_features);
+            appended_points->reserve(num_appended * num_features);
+            if (ColMajor) {
+                for (size_t f = 0; f < num_features; ++f) {
+                    auto column = points->begin() + f * num_points;
+                    initial_points->insert(
+                            initial_points->end(),
+                            column,
+                            column + num_initial);
+                    appended_points->insert(
+                            appended_points->end(),
+                            column + num_initial,
+                            column + num_points);
+                }
+            }
+            else {
+                auto split = points->begin() + num_initial * num_features;
+                initial_points->assign(points->begin(), split);
+                appended_points->assign(split, points->end());
+            }
+
+            auto initial_labels =
+                std::make_shared<std::vector<LabelT>>(num_initial);
+            auto appended_labels = std::make_shared<std::vector<LabelT>>();
+
+            auto measurement = (*kmeans)(
+                    max_iterations,
+                    num_features,
+                    initial_points,
+                    centroids,
+                    masses,
+                    initial_labels
+                    );
+
+            kmeans->set_measurement(measurement);
+            kmeans->append(appended_points, appended_labels);
+            kmeans->update(incremental_iterations, full_iterations);
+            kmeans->set_measurement(
+                    std::make_shared<Measurement::Measurement>());
+
+            std::copy(
+                    initial_labels->begin(),
+                    initial_labels->end(),
+                    labels->begin());
+            std::copy(
+                    appended_labels->begin(),
+                    appended_labels->end(),
+                    labels->begin() + num_initial);
+
+            return measurement;
+        };
+    }
+
+    /*
+     * Select the resident pipeline if points, labels and scratch space
+     * fit into the memory of each device, and the buffered pipeline
+     * otherwise. The single stage family is chosen if a fused strategy
+     * is configured, the three stage family if not.
+     *
+     * Scratch space is estimated from the cluster merge strategies,
+     * which need the most: one set of centroids and masses per thread.
+     */
+    static std::string select_pipeline(
+            Clustering::ConfigurationParser& config,
+            size_t num_points,
+            size_t num_features,
+            size_t num_clusters
+            )
+    {
+        size_t const points_bytes =
+            num_points * num_features * sizeof(PointT);
+        size_t const labels_bytes = num_points * sizeof(LabelT);
+        size_t const centroids_bytes =
+            num_clusters * num_features * sizeof(PointT);
+        size_t const masses_bytes = num_clusters * sizeof(MassT);
+
+        // key: device id, value: required bytes
+        std::map<cl_device_id, size_t> required;
+        std::map<cl_device_id, bc::device> devices;
+        auto require = [&](size_t platform, size_t device, size_t bytes) {
+            bc::device dev = bc::system::platforms()[platform]
+                .devices()[device];
+            devices[dev.id()] = dev;
+            required[dev.id()] += bytes;
+            return dev.id();
+        };
+
+        std::string family;
+        auto fu_config = config.get_fused_configuration();
+        if (not fu_config.strategy.empty()) {
+            family = "single_stage";
+            require(
+                    fu_config.platform,
+                    fu_config.device,
+                    points_bytes
+                    + labels_bytes
+                    + 3 * centroids_bytes
+                    + masses_bytes
+                    + fu_config.global_size[0]
+                    * (centroids_bytes + masses_bytes)
+                    );
+        }
+        else {
+            family = "three_stage";
+            auto ll_config = config.get_labeling_configuration();
+            auto mu_config = config.get_mass_update_configuration();
+            auto cu_config = config.get_centroid_update_configuration();
+
+            // Stages on the same device share points and labels
+            cl_device_id ll_id = require(
+                    ll_config.platform,
+                    ll_config.device,
+                    points_bytes + labels_bytes + 2 * centroids_bytes
+                    );
+            cl_device_id mu_id = require(
+                    mu_config.platform,
+                    mu_config.device,
+                    masses_bytes
+                    + mu_config.global_size[0] * masses_bytes
+                    );
+            if (mu_id != ll_id) {
+                required[mu_id] += labels_bytes;
+            }
+            cl_device_id cu_id = require(
+                    cu_config.platform,
+                    cu_config.device,
+                    centroids_bytes
+                    + masses_bytes
+                    + cu_config.global_size[0] * centroids_bytes
+                    );
+            if (cu_id != ll_id) {
+                required[cu_id] += points_bytes;
+                if (cu_id != mu_id) {
+                    required[cu_id] += labels_bytes;
+                }
+            }
+        }
+
+        bool fits = true;
+        for (auto const& r : required) {
+            bc::device const& dev = devices[r.first];
+            if (
+                    points_bytes > dev.max_memory_alloc_size()
+                    or r.second > dev.global_memory_size()
+               )
+            {
+                fits = false;
+            }
+        }
+
+        return (fits) ? family : family + "_buffered";
+    }
 };
 
 int main(int argc, char **argv) {
@@ -466,34 +1029,63 @@ int main(int argc, char **argv) {
     config.parse_file(options.config_file());
     auto km_config = config.get_kmeans_configuration();
 
+    if (km_config.layout != "col_major" and km_config.layout != "row_major") {
+        throw std::invalid_argument("Invalid layout");
+    }
+
     if (
             km_config.point_type == "double" &&
             km_config.label_type == "uint64" &&
             km_config.mass_type == "uint64"
             ) {
-        Bench<
-            double,
-            uint64_t,
-            uint64_t,
-            true
-                > bench;
-        ret = bench.run(options, config);
+        if (km_config.layout == "row_major") {
+            Bench<
+                double,
+                uint64_t,
+                uint64_t,
+                false
+                    > bench;
+            ret = bench.run(options, config);
+        }
+        else {
+            Bench<
+                double,
+                uint64_t,
+                uint64_t,
+                true
+                    > bench;
+            ret = bench.run(options, config);
+        }
         if (ret < 0) {
             return ret;
         }
     }
     else if (
-            km_config.point_type == "float" &&
+            (km_config.point_type == "float"
+             || km_config.point_type == "half"
+             || km_config.point_type == "bfloat16"
+             || km_config.point_type == "int8") &&
             km_config.label_type == "uint32" &&
             km_config.mass_type == "uint32"
             ) {
-        Bench<
-            float,
-            uint32_t,
-            uint32_t,
-            true
-                > bench;
-        ret = bench.run(options, config);
+        if (km_config.layout == "row_major") {
+            Bench<
+                float,
+                uint32_t,
+                uint32_t,
+                false
+                    > bench;
+            ret = bench.run(options, config);
+        }
+        else {
+            Bench<
+                float,
+                uint32_t,
+                uint32_t,
+                true
+                    > bench;
+            ret = bench.run(options, config);
+        }
         if (ret < 0) {
             return ret;
         }
@@ -4,50 +4,1002 @@
  * obtain one at http://mozilla.org/MPL/2.0/.
  * 
  * 
- * Copyright (c) 2016, Lutz, Clemens <lutzcle@cml.li>
+ * Copyright (c) 2016-2018, Lutz, Clemens <lutzcle@cml.li>
  */
 
 #include "binary_format.hpp"
 
 #include "matrix.hpp"
+#include "point_storage.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 #include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
 #include <cassert>
 
-template <typename FP, typename AllocFP, typename INT>
-int Clustering::BinaryFormat::read(char const* file_name, cle::Matrix<FP, AllocFP, INT>& matrix) {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-    std::ifstream fh(file_name, std::fstream::binary);
+namespace {
+    // Don't spawn threads for less than this many bytes each
+    constexpr size_t min_thread_bytes = 64 * 1024 * 1024;
+
+    // Copy column-major values into matrix of either layout
+    template <typename SrcT, typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+    void copy_col_major(
+            SrcT const *src,
+            cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& dst
+            )
+    {
+        if (COL_MAJOR) {
+            std::copy(src, src + dst.rows() * dst.cols(), dst.data());
+            return;
+        }
+
+        for (INT c = 0; c < dst.cols(); ++c) {
+            for (INT r = 0; r < dst.rows(); ++r) {
+                dst(r, c) = src[c * dst.rows() + r];
+            }
+        }
+    }
+}
+
+constexpr char const *Clustering::BinaryFormat::magic;
+constexpr char const *Clustering::BinaryFormat::result_magic;
+
+static_assert(
+        sizeof(Clustering::BinaryFormat::Header) == 96,
+        "BinaryFormat::Header must not contain padding"
+        );
+static_assert(
+        sizeof(Clustering::BinaryFormat::ChunkInfo) == 24,
+        "BinaryFormat::ChunkInfo must not contain padding"
+        );
+static_assert(
+        sizeof(Clustering::BinaryFormat::ResultHeader) == 72,
+        "BinaryFormat::ResultHeader must not contain padding"
+        );
 
-    uint64_t num_features;
-    uint64_t num_clusters;
-    uint64_t num_points;
+template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+int Clustering::BinaryFormat::read(char const* file_name, cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix) {
 
-    fh.read((char*)&num_features, sizeof(num_features));
-    fh.read((char*)&num_clusters, sizeof(num_clusters));
-    fh.read((char*)&num_points, sizeof(num_points));
+    int fd = ::open(file_name, O_RDONLY);
+    if (fd < 0) {
+        std::cerr
+            << "BinaryFormat: cannot open " << file_name
+            << ": " << std::strerror(errno)
+            << std::endl;
+        return -1;
+    }
 
-    // Importing ground-truth centroids not supported yet
-    assert(num_clusters == 0);
+    char file_magic[8];
+    struct stat file_stat;
+    if (
+            fstat(fd, &file_stat) != 0
+            or pread(fd, file_magic, sizeof(file_magic), 0)
+            != sizeof(file_magic)
+       )
+    {
+        std::cerr
+            << "BinaryFormat: cannot read header of " << file_name
+            << std::endl;
+        ::close(fd);
+        return -1;
+    }
+
+    int ret = 0;
+    if (std::memcmp(file_magic, magic, sizeof(file_magic)) == 0) {
+        ret = read_v2(fd, file_name, file_stat.st_size, matrix);
+    }
+    else {
+        ret = read_v1(fd, file_name, file_stat.st_size, matrix);
+    }
+
+    ::close(fd);
+
+    return ret;
+}
+
+template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+int Clustering::BinaryFormat::read_v1(
+        int fd,
+        char const *file_name,
+        size_t file_size,
+        cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix
+        )
+{
+    uint64_t header[3];
+    if (pread(fd, header, sizeof(header), 0) != sizeof(header)) {
+        std::cerr
+            << "BinaryFormat: cannot read header of " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    uint64_t num_features = header[0];
+    uint64_t num_clusters = header[1];
+    uint64_t num_points = header[2];
+
+    // Skip ground-truth centroids, see read_centroids
+    size_t const header_bytes =
+        sizeof(header) + num_clusters * num_features * sizeof(float);
+    size_t const num_values = num_points * num_features;
+    size_t const data_bytes = num_values * sizeof(float);
+    if (header_bytes + data_bytes > file_size) {
+        std::cerr
+            << "BinaryFormat: " << file_name << " is truncated"
+            << std::endl;
+        return -1;
+    }
 
     matrix.resize(num_points, num_features);
 
-    for (uint64_t f = 0; f < num_features; ++f) {
-        for (uint64_t p = 0; p < num_points; ++p) {
-            float point;
-            fh.read((char*)&point, sizeof(point));
-            matrix(p, f) = point;
+    if (COL_MAJOR and std::is_same<FP, float>::value) {
+        // File layout matches the matrix, read straight into it
+        return read_parallel(
+                fd,
+                (char*) matrix.data(),
+                data_bytes,
+                header_bytes
+                );
+    }
+
+    size_t const map_bytes = header_bytes + data_bytes;
+    void *map = mmap(nullptr, map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr
+            << "BinaryFormat: cannot map " << file_name
+            << ": " << std::strerror(errno)
+            << std::endl;
+        return -1;
+    }
+    madvise(map, map_bytes, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    float const *src = (float const*) ((char const*) map + header_bytes);
+    if (COL_MAJOR) {
+        convert_parallel(src, matrix.data(), num_values);
+    }
+    else {
+        copy_col_major(src, matrix);
+    }
+
+    munmap(map, map_bytes);
+
+    return 1;
+}
+
+template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+int Clustering::BinaryFormat::read_v2(
+        int fd,
+        char const *file_name,
+        size_t file_size,
+        cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix
+        )
+{
+    Header header;
+    std::vector<ChunkInfo> chunks;
+    if (read_header(file_name, header, chunks) < 0) {
+        return -1;
+    }
+
+    size_t const value_size = dtype_size(header.dtype);
+    size_t const num_values = header.num_points * header.num_features;
+    size_t const data_bytes = num_values * value_size;
+    if (
+            value_size == 0
+            or header.points_offset + data_bytes > file_size
+       )
+    {
+        std::cerr
+            << "BinaryFormat: " << file_name
+            << " is truncated or has unknown type"
+            << std::endl;
+        return -1;
+    }
+
+    matrix.resize(header.num_points, header.num_features);
+
+    bool const native =
+        header.layout == (COL_MAJOR ? Layout::ColMajor : Layout::RowMajor)
+        and (
+                (header.dtype == DataType::Float32
+                 and std::is_same<FP, float>::value)
+                or (header.dtype == DataType::Float64
+                    and std::is_same<FP, double>::value)
+            );
+
+    size_t const map_bytes = header.points_offset + data_bytes;
+    char const *map = nullptr;
+    if (native) {
+        // File layout matches the matrix, read straight into it
+        if (read_parallel(
+                    fd,
+                    (char*) matrix.data(),
+                    data_bytes,
+                    header.points_offset
+                    ) < 0)
+        {
+            return -1;
+        }
+    }
+    else {
+        void *addr = mmap(nullptr, map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr
+                << "BinaryFormat: cannot map " << file_name
+                << ": " << std::strerror(errno)
+                << std::endl;
+            return -1;
+        }
+        madvise(addr, map_bytes, MADV_SEQUENTIAL | MADV_WILLNEED);
+        map = (char const*) addr;
+    }
+
+    // Copy (if necessary) and verify chunks in parallel
+    size_t const threads = std::min(
+            num_threads(data_bytes),
+            (size_t) header.num_chunks
+            );
+    std::vector<int> results(threads, 1);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (uint64_t c = t; c < header.num_chunks; c += threads) {
+                int ret = 1;
+                if (native) {
+                    char const *chunk_data =
+                        (char const*) matrix.data()
+                        + (chunks[c].offset - header.points_offset);
+                    ret = (checksum(chunk_data, chunks[c].length)
+                            == chunks[c].checksum) ? 1 : -1;
+                }
+                else if (header.dtype == DataType::Float32) {
+                    ret = copy_chunk<float>(
+                            header,
+                            chunks[c],
+                            c,
+                            map,
+                            COL_MAJOR,
+                            matrix.data()
+                            );
+                }
+                else if (header.dtype == DataType::Float64) {
+                    ret = copy_chunk<double>(
+                            header,
+                            chunks[c],
+                            c,
+                            map,
+                            COL_MAJOR,
+                            matrix.data()
+                            );
+                }
+                else if (header.dtype == DataType::Float16) {
+                    ret = copy_chunk<Half>(
+                            header,
+                            chunks[c],
+                            c,
+                            map,
+                            COL_MAJOR,
+                            matrix.data()
+                            );
+                }
+                else {
+                    ret = copy_chunk<BFloat16>(
+                            header,
+                            chunks[c],
+                            c,
+                            map,
+                            COL_MAJOR,
+                            matrix.data()
+                            );
+                }
+
+                if (ret < 0) {
+                    results[t] = -1;
+                }
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (map) {
+        munmap((void*) map, map_bytes);
+    }
+
+    if (std::find(results.begin(), results.end(), -1) != results.end()) {
+        std::cerr
+            << "BinaryFormat: checksum mismatch in " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    return 1;
+}
+
+template <typename SrcT, typename FP>
+int Clustering::BinaryFormat::copy_chunk(
+        Header const& header,
+        ChunkInfo const& chunk,
+        uint64_t chunk_id,
+        char const *map,
+        bool col_major,
+        FP *dst
+        )
+{
+    SrcT const *src = (SrcT const*) &map[chunk.offset];
+    uint64_t const num_features = header.num_features;
+    uint64_t const num_points = header.num_points;
+
+    if (checksum(src, chunk.length) != chunk.checksum) {
+        return -1;
+    }
+
+    switch (header.layout) {
+    case Layout::ColMajor:
+        if (col_major) {
+            std::copy(
+                    src,
+                    src + num_points,
+                    &dst[chunk_id * num_points]
+                    );
+        }
+        else {
+            for (uint64_t p = 0; p < num_points; ++p) {
+                dst[p * num_features + chunk_id] = src[p];
+            }
         }
+        break;
+    case Layout::RowMajor:
+        if (col_major) {
+            for (uint64_t p = 0; p < num_points; ++p) {
+                for (uint64_t f = 0; f < num_features; ++f) {
+                    dst[f * num_points + p] = src[p * num_features + f];
+                }
+            }
+        }
+        else {
+            std::copy(
+                    src,
+                    src + num_points * num_features,
+                    dst
+                    );
+        }
+        break;
+    case Layout::Partitioned:
+        {
+            uint64_t const chunk_points =
+                header.chunk_size / sizeof(SrcT) / num_features;
+            uint64_t const real_chunk_points =
+                chunk.length / sizeof(SrcT) / num_features;
+            uint64_t const first_point = chunk_id * chunk_points;
+
+            for (uint64_t f = 0; f < num_features; ++f) {
+                if (col_major) {
+                    std::copy(
+                            &src[f * real_chunk_points],
+                            &src[(f + 1) * real_chunk_points],
+                            &dst[f * num_points + first_point]
+                            );
+                }
+                else {
+                    for (uint64_t p = 0; p < real_chunk_points; ++p) {
+                        dst[(first_point + p) * num_features + f] =
+                            src[f * real_chunk_points + p];
+                    }
+                }
+            }
+        }
+        break;
     }
 
     return 1;
 }
 
+int Clustering::BinaryFormat::read_header(
+        char const *file_name,
+        Header& header,
+        std::vector<ChunkInfo>& chunks
+        )
+{
+    std::ifstream fh(file_name, std::fstream::binary);
+    if (not fh.good()) {
+        std::cerr
+            << "BinaryFormat: cannot open " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    fh.read((char*) &header, sizeof(header));
+    if (not fh.good()) {
+        std::cerr
+            << "BinaryFormat: cannot read header of " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0) {
+        uint64_t v1_header[3];
+        std::memcpy(v1_header, &header, sizeof(v1_header));
+
+        header = make_header(
+                DataType::Float32,
+                Layout::ColMajor,
+                v1_header[0],
+                v1_header[2],
+                v1_header[1],
+                0,
+                (v1_header[1] != 0) ? uint32_t(HasCentroids) : 0u
+                );
+        header.version = 1;
+        header.num_chunks = 0;
+        header.chunk_index_offset = 0;
+        header.centroids_offset = sizeof(v1_header);
+        header.labels_offset = 0;
+        header.points_offset = sizeof(v1_header)
+            + v1_header[1] * v1_header[0] * sizeof(float);
+
+        // Version 1 files don't have checksums
+        chunks.clear();
+        return 1;
+    }
+
+    if (header.version != version) {
+        std::cerr
+            << "BinaryFormat: " << file_name
+            << " has unsupported version " << header.version
+            << std::endl;
+        return -1;
+    }
+
+    // Validate the header before trusting its sizes, such that a corrupt
+    // file cannot cause reads beyond the file or writes beyond the matrix
+    fh.seekg(0, std::ios::end);
+    uint64_t const file_size = fh.tellg();
+    uint64_t const value_size = dtype_size(header.dtype);
+
+    bool valid =
+        value_size != 0
+        and header.layout <= Layout::Partitioned
+        and header.num_features != 0
+        and header.num_points != 0
+        and header.num_points
+        <= file_size / header.num_features / value_size
+        ;
+
+    uint64_t const point_bytes = header.num_features * value_size;
+    if (valid and header.layout == Layout::Partitioned) {
+        valid =
+            header.chunk_size != 0
+            and header.chunk_size % point_bytes == 0;
+    }
+
+    uint64_t const data_bytes = header.num_points * point_bytes;
+    if (valid) {
+        // Number of chunks is implied by the layout
+        Header const expected = make_header(
+                header.dtype,
+                header.layout,
+                header.num_features,
+                header.num_points,
+                header.num_clusters,
+                header.chunk_size,
+                header.flags
+                );
+
+        valid =
+            header.num_chunks == expected.num_chunks
+            and header.chunk_index_offset >= sizeof(Header)
+            and header.chunk_index_offset <= file_size
+            and header.num_chunks
+            <= (file_size - header.chunk_index_offset) / sizeof(ChunkInfo)
+            and header.points_offset
+            >= header.chunk_index_offset
+            + header.num_chunks * sizeof(ChunkInfo)
+            and header.points_offset <= file_size - data_bytes
+            ;
+    }
+
+    if (not valid) {
+        std::cerr
+            << "BinaryFormat: " << file_name
+            << " has a corrupt header"
+            << std::endl;
+        return -1;
+    }
+
+    chunks.resize(header.num_chunks);
+    fh.clear();
+    fh.seekg(header.chunk_index_offset);
+    fh.read((char*) chunks.data(), chunks.size() * sizeof(ChunkInfo));
+    if (not fh.good()) {
+        std::cerr
+            << "BinaryFormat: cannot read chunk index of " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    // Readers locate chunks by their ID, thus chunks must be laid out
+    // back-to-back from points_offset as created by make_chunk_index
+    auto const expected_chunks = make_chunk_index(header);
+    for (uint64_t c = 0; c < header.num_chunks; ++c) {
+        if (
+                chunks[c].offset != expected_chunks[c].offset
+                or chunks[c].length != expected_chunks[c].length
+           )
+        {
+            std::cerr
+                << "BinaryFormat: " << file_name
+                << " has a corrupt chunk index"
+                << std::endl;
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+Clustering::BinaryFormat::Header Clustering::BinaryFormat::make_header(
+        DataType dtype,
+        Layout layout,
+        uint64_t num_features,
+        uint64_t num_points,
+        uint64_t num_clusters,
+        uint64_t chunk_size,
+        uint32_t flags
+        )
+{
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.dtype = dtype;
+    header.layout = layout;
+    header.flags = flags;
+    header.num_features = num_features;
+    header.num_points = num_points;
+    header.num_clusters = (flags & HasCentroids) ? num_clusters : 0;
+    header.chunk_size = (layout == Layout::Partitioned) ? chunk_size : 0;
+
+    uint64_t const data_bytes =
+        num_points * num_features * dtype_size(dtype);
+    switch (layout) {
+    case Layout::ColMajor:
+        header.num_chunks = num_features;
+        break;
+    case Layout::RowMajor:
+        header.num_chunks = 1;
+        break;
+    case Layout::Partitioned:
+        header.num_chunks = (data_bytes + chunk_size - 1) / chunk_size;
+        break;
+    }
+
+    header.chunk_index_offset = sizeof(Header);
+    header.centroids_offset =
+        header.chunk_index_offset
+        + header.num_chunks * sizeof(ChunkInfo);
+    header.labels_offset =
+        header.centroids_offset
+        + header.num_clusters * num_features * dtype_size(dtype);
+    uint64_t const labels_end =
+        header.labels_offset
+        + ((flags & HasLabels) ? num_points * sizeof(uint32_t) : 0);
+    header.points_offset =
+        (labels_end + alignment - 1) / alignment * alignment;
+
+    return header;
+}
+
+std::vector<Clustering::BinaryFormat::ChunkInfo>
+Clustering::BinaryFormat::make_chunk_index(Header const& header)
+{
+    std::vector<ChunkInfo> chunks(header.num_chunks);
+    uint64_t const data_bytes =
+        header.num_points * header.num_features * dtype_size(header.dtype);
+    uint64_t const nominal_length =
+        (header.layout == Layout::Partitioned)
+        ? header.chunk_size
+        : data_bytes / header.num_chunks
+        ;
+
+    uint64_t offset = header.points_offset;
+    uint64_t const end = header.points_offset + data_bytes;
+    for (auto& chunk : chunks) {
+        chunk.offset = offset;
+        chunk.length = std::min(nominal_length, end - offset);
+        chunk.checksum = checksum_init;
+        offset += chunk.length;
+    }
+
+    return chunks;
+}
+
+uint64_t Clustering::BinaryFormat::checksum(
+        void const *data,
+        size_t length,
+        uint64_t hash
+        )
+{
+    uint32_t const *words = (uint32_t const*) data;
+    size_t const num_words = length / sizeof(uint32_t);
+
+    for (size_t i = 0; i < num_words; ++i) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ul;
+    }
+
+    // Chunks of 16-bit types may end in half a word
+    unsigned char const *tail = (unsigned char const*) &words[num_words];
+    for (size_t i = 0; i < length % sizeof(uint32_t); ++i) {
+        hash ^= tail[i];
+        hash *= 0x100000001b3ul;
+    }
+
+    return hash;
+}
+
+size_t Clustering::BinaryFormat::dtype_size(DataType dtype)
+{
+    switch (dtype) {
+    case DataType::Float32:
+        return sizeof(float);
+    case DataType::Float64:
+        return sizeof(double);
+    case DataType::Float16:
+        return sizeof(Half);
+    case DataType::BFloat16:
+        return sizeof(BFloat16);
+    }
+
+    return 0;
+}
+
+template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+int Clustering::BinaryFormat::read_centroids(
+        char const *file_name,
+        cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& centroids
+        )
+{
+    std::ifstream fh(file_name, std::fstream::binary);
+    char file_magic[8];
+    fh.read(file_magic, sizeof(file_magic));
+    if (not fh.good()) {
+        std::cerr
+            << "BinaryFormat: cannot read header of " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    DataType dtype = DataType::Float32;
+    uint64_t num_features = 0, num_clusters = 0, offset = 0;
+    if (std::memcmp(file_magic, result_magic, sizeof(file_magic)) == 0) {
+        ResultHeader header;
+        fh.seekg(0);
+        fh.read((char*) &header, sizeof(header));
+        if (not fh.good()) {
+            std::cerr
+                << "BinaryFormat: cannot read header of " << file_name
+                << std::endl;
+            return -1;
+        }
+        if (header.version != result_version) {
+            std::cerr
+                << "BinaryFormat: " << file_name
+                << " has unsupported version " << header.version
+                << std::endl;
+            return -1;
+        }
+        dtype = header.dtype;
+        num_features = header.num_features;
+        num_clusters = header.num_clusters;
+        offset = header.centroids_offset;
+    }
+    else {
+        Header header;
+        std::vector<ChunkInfo> chunks;
+        if (read_header(file_name, header, chunks) < 0) {
+            return -1;
+        }
+        if (not (header.flags & HasCentroids)) {
+            std::cerr
+                << "BinaryFormat: " << file_name << " has no centroids"
+                << std::endl;
+            return -1;
+        }
+        dtype = header.dtype;
+        num_features = header.num_features;
+        num_clusters = header.num_clusters;
+        offset = header.centroids_offset;
+    }
+
+    if (dtype_size(dtype) == 0) {
+        std::cerr
+            << "BinaryFormat: " << file_name << " has unknown type"
+            << std::endl;
+        return -1;
+    }
+
+    fh.seekg(0, std::ios::end);
+    uint64_t const file_size = fh.tellg();
+    if (
+            num_features != 0
+            and num_clusters > file_size / num_features / dtype_size(dtype)
+       )
+    {
+        std::cerr
+            << "BinaryFormat: " << file_name << " is truncated"
+            << std::endl;
+        return -1;
+    }
+
+    size_t const num_values = num_clusters * num_features;
+    std::vector<char> buffer(num_values * dtype_size(dtype));
+    fh.seekg(offset);
+    fh.read(buffer.data(), buffer.size());
+    if (not fh.good()) {
+        std::cerr
+            << "BinaryFormat: cannot read centroids of " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    // Centroids are column major in all formats
+    centroids.resize(num_clusters, num_features);
+    if (dtype == DataType::Float64) {
+        copy_col_major((double const*) buffer.data(), centroids);
+    }
+    else if (dtype == DataType::Float16) {
+        copy_col_major((Half const*) buffer.data(), centroids);
+    }
+    else if (dtype == DataType::BFloat16) {
+        copy_col_major((BFloat16 const*) buffer.data(), centroids);
+    }
+    else {
+        copy_col_major((float const*) buffer.data(), centroids);
+    }
+
+    return 1;
+}
+
+template <typename FP, typename MassT, typename LabelT>
+int Clustering::BinaryFormat::write_result(
+        char const *file_name,
+        uint64_t num_features,
+        uint64_t num_clusters,
+        std::vector<FP> const& centroids,
+        std::vector<MassT> const& masses,
+        std::vector<LabelT> const& labels
+        )
+{
+    auto align = [](uint64_t offset) { return (offset + 7) / 8 * 8; };
+
+    ResultHeader header = {};
+    std::memcpy(header.magic, result_magic, sizeof(header.magic));
+    header.version = result_version;
+    header.dtype = (sizeof(FP) == sizeof(double))
+        ? DataType::Float64
+        : DataType::Float32
+        ;
+    header.label_size = label_size(num_clusters);
+    header.mass_size = sizeof(uint64_t);
+    header.num_features = num_features;
+    header.num_points = labels.size();
+    header.num_clusters = num_clusters;
+    header.centroids_offset = align(sizeof(header));
+    header.masses_offset = align(
+            header.centroids_offset
+            + num_clusters * num_features * sizeof(FP)
+            );
+    header.labels_offset = align(
+            header.masses_offset
+            + num_clusters * header.mass_size
+            );
+    uint64_t const file_size =
+        header.labels_offset + header.num_points * header.label_size;
+
+    if (centroids.size() < num_clusters * num_features
+            or masses.size() < num_clusters)
+    {
+        std::cerr << "BinaryFormat: result dimension mismatch" << std::endl;
+        return -1;
+    }
+
+    int fd = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "BinaryFormat: cannot open " << file_name
+            << ": " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    // Allocate all blocks up front, as running out of space while
+    // writing through the mapping raises SIGBUS instead of an error
+    int const alloc_error = posix_fallocate(fd, 0, file_size);
+    if (alloc_error != 0) {
+        std::cerr << "BinaryFormat: cannot allocate " << file_name
+            << ": " << std::strerror(alloc_error) << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    char *map = (char*) mmap(
+            nullptr,
+            file_size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED,
+            fd,
+            0
+            );
+    if (map == MAP_FAILED) {
+        std::cerr << "BinaryFormat: cannot map " << file_name
+            << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    std::memcpy(map, &header, sizeof(header));
+    std::memcpy(
+            &map[header.centroids_offset],
+            centroids.data(),
+            num_clusters * num_features * sizeof(FP)
+            );
+    std::copy(
+            masses.begin(),
+            masses.begin() + num_clusters,
+            (uint64_t*) &map[header.masses_offset]
+            );
+
+    char *labels_map = &map[header.labels_offset];
+    switch (header.label_size) {
+    case sizeof(uint8_t):
+        convert_parallel(labels.data(), (uint8_t*) labels_map, labels.size());
+        break;
+    case sizeof(uint16_t):
+        convert_parallel(labels.data(), (uint16_t*) labels_map, labels.size());
+        break;
+    case sizeof(uint32_t):
+        convert_parallel(labels.data(), (uint32_t*) labels_map, labels.size());
+        break;
+    default:
+        convert_parallel(labels.data(), (uint64_t*) labels_map, labels.size());
+        break;
+    }
+
+    // munmap doesn't report writeback errors, e.g. a full disk
+    int ret = 1;
+    if (msync(map, file_size, MS_SYNC) < 0) {
+        std::cerr << "BinaryFormat: cannot write " << file_name
+            << ": " << std::strerror(errno) << std::endl;
+        ret = -1;
+    }
+
+    munmap(map, file_size);
+    close(fd);
+
+    return ret;
+}
+
+uint32_t Clustering::BinaryFormat::label_size(uint64_t num_clusters)
+{
+    if (num_clusters <= (uint64_t(1) << 8)) {
+        return sizeof(uint8_t);
+    }
+    else if (num_clusters <= (uint64_t(1) << 16)) {
+        return sizeof(uint16_t);
+    }
+    else if (num_clusters <= (uint64_t(1) << 32)) {
+        return sizeof(uint32_t);
+    }
+
+    return sizeof(uint64_t);
+}
+
+int Clustering::BinaryFormat::read_parallel(
+        int fd,
+        char *dst,
+        size_t length,
+        size_t offset
+        )
+{
+    size_t const threads = num_threads(length);
+    size_t const thread_length = (length + threads - 1) / threads;
+    std::vector<int> results(threads, 1);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        size_t const begin = std::min(t * thread_length, length);
+        size_t const end = std::min(begin + thread_length, length);
+
+        workers.emplace_back([=, &results]() {
+            size_t done = begin;
+            while (done < end) {
+                ssize_t ret = pread(
+                        fd,
+                        &dst[done],
+                        end - done,
+                        offset + done
+                        );
+                if (ret < 0 and errno == EINTR) {
+                    continue;
+                }
+                if (ret <= 0) {
+                    results[t] = -1;
+                    return;
+                }
+                done += ret;
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (std::find(results.begin(), results.end(), -1) != results.end()) {
+        std::cerr << "BinaryFormat: read error" << std::endl;
+        return -1;
+    }
+
+    return 1;
+}
+
+template <typename SrcT, typename FP>
+void Clustering::BinaryFormat::convert_parallel(
+        SrcT const *src,
+        FP *dst,
+        size_t length
+        )
+{
+    size_t const threads = num_threads(length * sizeof(SrcT));
+    size_t const thread_length = (length + threads - 1) / threads;
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        size_t const begin = std::min(t * thread_length, length);
+        size_t const end = std::min(begin + thread_length, length);
+
+        workers.emplace_back([=]() {
+            std::copy(&src[begin], &src[end], &dst[begin]);
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t Clustering::BinaryFormat::num_threads(size_t length)
+{
+    size_t const max_threads =
+        std::max(1u, std::thread::hardware_concurrency());
+
+    return std::max(
+            size_t(1),
+            std::min(max_threads, length / min_thread_bytes)
+            );
+}
+
 template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, uint32_t>&);
 template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, size_t>&);
 template int Clustering::BinaryFormat::read(char const*, cle::Matrix<double, std::allocator<double>, size_t>&);
+template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<float, std::allocator<float>, size_t>&);
+template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<double, std::allocator<double>, size_t>&);
+template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, size_t, false>&);
+template int Clustering::BinaryFormat::read(char const*, cle::Matrix<double, std::allocator<double>, size_t, false>&);
+template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<float, std::allocator<float>, size_t, false>&);
+template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<double, std::allocator<double>, size_t, false>&);
+template int Clustering::BinaryFormat::write_result(char const*, uint64_t, uint64_t, std::vector<float> const&, std::vector<uint32_t> const&, std::vector<uint32_t> const&);
+template int Clustering::BinaryFormat::write_result(char const*, uint64_t, uint64_t, std::vector<double> const&, std::vector<uint64_t> const&, std::vector<uint64_t> const&);
 
 #ifdef USE_ALIGNED_ALLOCATOR
 template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, boost::alignment::aligned_allocator<float, 32>, uint32_t>&);
@@ -2,9 +2,9 @@
  * This Source Code Form is subject to the terms of the Mozilla Public License,
  * v. 2.0. If a copy of the MPL was not distributed with this file, You can
  * obtain one at http://mozilla.org/MPL/2.0/.
- * 
- * 
- * Copyright (c) 2016, Lutz, Clemens <lutzcle@cml.li>
+ *
+ *
+ * Copyright (c) 2016-2018, Lutz, Clemens <lutzcle@cml.li>
  */
 
 #ifndef BINARY_FORMAT_HPP
@@ -12,12 +12,258 @@
 
 #include "matrix.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace Clustering {
 
+/*
+ * Version 1 file format:
+ *
+ * uint64_t num_features
+ * uint64_t num_clusters
+ * uint64_t num_points
+ * float centroids[0 ... num_clusters-1], column major
+ * float points[0 ... num_points-1], column major
+ *
+ * Version 2 file format:
+ *
+ * Header header
+ * ChunkInfo chunk_index[0 ... num_chunks-1]
+ * dtype centroids[0 ... num_clusters-1], column major (optional)
+ * uint32_t labels[0 ... num_points-1] (optional), num_clusters for noise
+ * padding up to points_offset, aligned to BinaryFormat::alignment
+ * dtype points[0 ... num_points-1], in layout
+ *
+ * Layouts:
+ *
+ * ColMajor: One chunk per feature column.
+ * RowMajor: A single chunk.
+ * Partitioned: Chunks of chunk_size bytes, laid out as produced by
+ *   BufferHelper::partition_matrix. Each chunk holds the points'
+ *   features column major. Buffered pipelines with a buffer size of
+ *   chunk_size can stream chunks straight into their cache.
+ *
+ * Chunks are stored back-to-back from points_offset on. Each chunk has
+ * a checksum, which is verified on read.
+ *
+ * Result file format:
+ *
+ * ResultHeader header
+ * dtype centroids[0 ... num_clusters-1], column major
+ * uint64_t masses[0 ... num_clusters-1]
+ * uintN_t labels[0 ... num_points-1], N = 8 * label_size
+ *
+ * Labels are narrowed to the smallest unsigned type that holds all
+ * cluster IDs. Sections are aligned to 8 bytes.
+ *
+ * Float16 and BFloat16 files are widened when read into a matrix.
+ * Pipelines with 16-bit point storage stream their chunks unconverted.
+ */
 class BinaryFormat {
 public:
-    template <typename FP, typename AllocFP, typename INT>
-    int read(char const* file_name, cle::Matrix<FP, AllocFP, INT>& matrix);
+    enum class DataType : uint32_t {
+        Float32 = 0,
+        Float64 = 1,
+        Float16 = 2,
+        BFloat16 = 3
+    };
+
+    enum class Layout : uint32_t {
+        ColMajor = 0,
+        RowMajor = 1,
+        Partitioned = 2
+    };
+
+    enum Flags : uint32_t {
+        HasCentroids = 1,
+        HasLabels = 2
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        DataType dtype;
+        Layout layout;
+        uint32_t flags;
+        uint64_t num_features;
+        uint64_t num_points;
+        uint64_t num_clusters;
+        uint64_t chunk_size;
+        uint64_t num_chunks;
+        uint64_t chunk_index_offset;
+        uint64_t centroids_offset;
+        uint64_t labels_offset;
+        uint64_t points_offset;
+    };
+
+    struct ChunkInfo {
+        uint64_t offset;
+        uint64_t length;
+        uint64_t checksum;
+    };
+
+    struct ResultHeader {
+        char magic[8];
+        uint32_t version;
+        DataType dtype;
+        uint32_t label_size;
+        uint32_t mass_size;
+        uint64_t num_features;
+        uint64_t num_points;
+        uint64_t num_clusters;
+        uint64_t centroids_offset;
+        uint64_t masses_offset;
+        uint64_t labels_offset;
+    };
+
+    static constexpr char const *magic = "CLKMEANS";
+    static constexpr char const *result_magic = "CLKMRSLT";
+    static constexpr uint32_t version = 2;
+    static constexpr uint32_t result_version = 1;
+    static constexpr size_t alignment = 4096;
+    static constexpr uint64_t checksum_init = 0xcbf29ce484222325ul;
+
+    /*
+     * Read points from file into column-major or row-major matrix.
+     * Reads version 1 and version 2 files.
+     *
+     * If the file's type and layout match the matrix, points are read in
+     * bulk straight into the matrix. Otherwise, the file is mapped and
+     * converted in parallel.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+    int read(char const* file_name, cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix);
+
+    /*
+     * Read centroids from file into num_clusters x num_features matrix.
+     * Reads the ground-truth centroids of version 1 and version 2 files,
+     * and the centroids of result files.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+    static int read_centroids(
+            char const *file_name,
+            cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& centroids
+            );
+
+    /*
+     * Read header and chunk index of file. For version 1 files, a
+     * version 2 header describing the file is returned.
+     *
+     * Version 2 headers are validated against the file size, and the
+     * chunk index must match make_chunk_index.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    static int read_header(
+            char const *file_name,
+            Header& header,
+            std::vector<ChunkInfo>& chunks
+            );
+
+    /*
+     * Create header with offsets for a version 2 file.
+     * chunk_size is only used in Partitioned layout. It must be a
+     * multiple of num_features times the dtype size.
+     */
+    static Header make_header(
+            DataType dtype,
+            Layout layout,
+            uint64_t num_features,
+            uint64_t num_points,
+            uint64_t num_clusters,
+            uint64_t chunk_size,
+            uint32_t flags
+            );
+
+    /*
+     * Create chunk index with offsets and lengths for header.
+     * Checksums are initialized to checksum_init.
+     */
+    static std::vector<ChunkInfo> make_chunk_index(Header const& header);
+
+    /*
+     * FNV-1a hash over 32-bit words, followed by the remaining bytes.
+     * Can be computed incrementally by passing the previous hash, if
+     * all but the last piece are a multiple of 4 bytes long.
+     */
+    static uint64_t checksum(
+            void const *data,
+            size_t length,
+            uint64_t hash = checksum_init
+            );
+
+    static size_t dtype_size(DataType dtype);
+
+    /*
+     * Write clustering result to file. The file is mapped and filled in
+     * parallel, narrowing labels to label_size(num_clusters) bytes.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    template <typename FP, typename MassT, typename LabelT>
+    static int write_result(
+            char const *file_name,
+            uint64_t num_features,
+            uint64_t num_clusters,
+            std::vector<FP> const& centroids,
+            std::vector<MassT> const& masses,
+            std::vector<LabelT> const& labels
+            );
+
+    /*
+     * Smallest label size in bytes that holds cluster IDs
+     * 0 ... num_clusters-1.
+     */
+    static uint32_t label_size(uint64_t num_clusters);
+
+private:
+    template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+    int read_v1(
+            int fd,
+            char const *file_name,
+            size_t file_size,
+            cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix
+            );
+
+    template <typename FP, typename AllocFP, typename INT, bool COL_MAJOR>
+    int read_v2(
+            int fd,
+            char const *file_name,
+            size_t file_size,
+            cle::Matrix<FP, AllocFP, INT, COL_MAJOR>& matrix
+            );
+
+    template <typename SrcT, typename FP>
+    static int copy_chunk(
+            Header const& header,
+            ChunkInfo const& chunk,
+            uint64_t chunk_id,
+            char const *map,
+            bool col_major,
+            FP *dst
+            );
+
+    static int read_parallel(
+            int fd,
+            char *dst,
+            size_t length,
+            size_t offset
+            );
+
+    template <typename SrcT, typename FP>
+    static void convert_parallel(
+            SrcT const *src,
+            FP *dst,
+            size_t length
+            );
+
+    static size_t num_threads(size_t length);
 };
 
 }
@@ -25,5 +271,13 @@ public:
 extern template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, uint32_t>&);
 extern template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, size_t>&);
 extern template int Clustering::BinaryFormat::read(char const*, cle::Matrix<double, std::allocator<double>, size_t>&);
+extern template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<float, std::allocator<float>, size_t>&);
+extern template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<double, std::allocator<double>, size_t>&);
+extern template int Clustering::BinaryFormat::read(char const*, cle::Matrix<float, std::allocator<float>, size_t, false>&);
+extern template int Clustering::BinaryFormat::read(char const*, cle::Matrix<double, std::allocator<double>, size_t, false>&);
+extern template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<float, std::allocator<float>, size_t, false>&);
+extern template int Clustering::BinaryFormat::read_centroids(char const*, cle::Matrix<double, std::allocator<double>, size_t, false>&);
+extern template int Clustering::BinaryFormat::write_result(char const*, uint64_t, uint64_t, std::vector<float> const&, std::vector<uint32_t> const&, std::vector<uint32_t> const&);
+extern template int Clustering::BinaryFormat::write_result(char const*, uint64_t, uint64_t, std::vector<double> const&, std::vector<uint64_t> const&, std::vector<uint64_t> const&);
 
 #endif /* BINARY_FORMAT_HPP */
@@ -96,6 +96,26 @@ public:
      */
     virtual uint32_t add_object(void *data_object, size_t length, ObjectMode mode = ObjectMode::ReadOnly) = 0;
 
+    /*
+     * Add data object backed by a file for buffer cache to manage.
+     * Buffers are streamed from the file at offset instead of from host
+     * memory. The object must be laid out exactly as an in-memory
+     * object would be.
+     *
+     * Returns new object id (oid), or 0 if unsuccessful.
+     */
+    virtual uint32_t add_file_object(char const *file_name, size_t offset, size_t length, ObjectMode mode = ObjectMode::ReadOnly) = 0;
+
+    /*
+     * Add column-major matrix with num_dims columns for buffer cache to
+     * manage. Buffers are gathered from the columns on access, such that
+     * each buffer is laid out as produced by BufferHelper::partition_matrix.
+     * Avoids a partitioned copy of the matrix in host memory.
+     *
+     * Returns new object id (oid), or 0 if unsuccessful.
+     */
+    virtual uint32_t add_strided_object(void *data_object, size_t length, size_t num_dims, ObjectMode mode = ObjectMode::ReadOnly) = 0;
+
     /*
      * Get pointer to previously added data object.
      * Does not transfer ownership of object.
@@ -10,8 +10,11 @@
 #include "buffer_helper.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 int Clustering::BufferHelper::partition_matrix(
         void const *src,
@@ -86,3 +89,173 @@ int Clustering::BufferHelper::partition_matrix(
     return num_bufs;
 }
 
+
+int Clustering::BufferHelper::write_partitioned_matrix(
+        void const *src,
+        char const *file_name,
+        size_t size,
+        size_t num_dims,
+        size_t buffer_size
+        )
+{
+    if (size % num_dims != 0 or buffer_size % num_dims != 0) {
+        std::cerr
+            << "BufferHelper::write_partitioned_matrix:"
+            << " dimension mismatch"
+            << std::endl;
+        return -1;
+    }
+
+    size_t dim_size = size / num_dims;
+    size_t buf_dim_size = buffer_size / num_dims;
+    size_t num_bufs = (size + buffer_size - 1) / buffer_size;
+    char const *c_src = (char const*) src;
+
+    std::ofstream fs(
+            file_name,
+            std::fstream::out | std::fstream::binary | std::fstream::trunc
+            );
+    if (not fs.good()) {
+        std::cerr
+            << "BufferHelper::write_partitioned_matrix:"
+            << " cannot open " << file_name
+            << std::endl;
+        return -1;
+    }
+
+    std::vector<char> header_block(partitioned_header_size, 0);
+    PartitionedHeader header = {
+        partitioned_magic,
+        size,
+        num_dims,
+        buffer_size,
+        checksum(src, size)
+    };
+    std::memcpy(header_block.data(), &header, sizeof(header));
+    fs.write(header_block.data(), header_block.size());
+
+    for (size_t b = 0; b < num_bufs; ++b) {
+        for (size_t v = 0; v < num_dims; ++v) {
+
+            size_t real_buf_dim_size =
+                (buf_dim_size * (b + 1) > dim_size)
+                ? dim_size - b * buf_dim_size
+                : buf_dim_size
+                ;
+
+            fs.write(
+                    &c_src[v * dim_size + b * buf_dim_size],
+                    real_buf_dim_size
+                    );
+        }
+    }
+
+    fs.flush();
+    if (not fs.good()) {
+        std::cerr
+            << "BufferHelper::write_partitioned_matrix:"
+            << " write error"
+            << std::endl;
+        return -1;
+    }
+
+    return num_bufs;
+}
+
+int Clustering::BufferHelper::check_partitioned_matrix(
+        void const *src,
+        char const *file_name,
+        size_t size,
+        size_t num_dims,
+        size_t buffer_size
+        )
+{
+    std::ifstream fs(file_name, std::fstream::in | std::fstream::binary);
+    if (not fs.good()) {
+        return -1;
+    }
+
+    PartitionedHeader header;
+    fs.read((char*)&header, sizeof(header));
+    if (not fs.good()) {
+        return -1;
+    }
+
+    fs.seekg(0, std::ios::end);
+    size_t file_size = fs.tellg();
+
+    bool matches =
+        header.magic == partitioned_magic
+        and header.size == size
+        and header.num_dims == num_dims
+        and header.buffer_size == buffer_size
+        and file_size == partitioned_header_size + size
+        and header.checksum == checksum(src, size)
+        ;
+
+    return (matches) ? 1 : -1;
+}
+
+uint64_t Clustering::BufferHelper::checksum(void const *src, size_t size)
+{
+    uint64_t const *words = (uint64_t const*) src;
+    size_t const num_words = size / sizeof(uint64_t);
+    uint64_t hash = 0xcbf29ce484222325ul;
+
+    for (size_t i = 0; i < num_words; ++i) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ul;
+    }
+
+    unsigned char const *tail = (unsigned char const*) &words[num_words];
+    for (size_t i = 0; i < size % sizeof(uint64_t); ++i) {
+        hash ^= tail[i];
+        hash *= 0x100000001b3ul;
+    }
+
+    return hash;
+}
+
+size_t Clustering::BufferHelper::round_buffer_size(
+        size_t buffer_size,
+        size_t num_dims,
+        size_t element_size
+        )
+{
+    size_t granularity = num_dims * element_size;
+
+    return buffer_size / granularity * granularity;
+}
+
+std::vector<size_t> Clustering::BufferHelper::buffer_size_candidates(
+        size_t size,
+        size_t num_dims,
+        size_t element_size,
+        size_t max_buffer_size
+        )
+{
+    std::vector<size_t> candidates;
+
+    for (
+            size_t buffer_size = 1024 * 1024;
+            buffer_size <= max_buffer_size;
+            buffer_size *= 2
+        )
+    {
+        size_t rounded = round_buffer_size(
+                buffer_size,
+                num_dims,
+                element_size
+                );
+        if (rounded == 0) {
+            continue;
+        }
+
+        candidates.push_back(rounded);
+        if (rounded >= size) {
+            break;
+        }
+    }
+
+    return candidates;
+}
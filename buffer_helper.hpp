@@ -11,11 +11,31 @@
 #define BUFFER_HELPER_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace Clustering {
 
 class BufferHelper {
 public:
+    /*
+     * Header of files written by write_partitioned_matrix. The layout
+     * depends on the buffer size, thus a file can only be reused with
+     * the same buffer size and data. The header is padded to
+     * partitioned_header_size, such that the data remains aligned for
+     * direct reads.
+     */
+    struct PartitionedHeader {
+        uint64_t magic;
+        uint64_t size;
+        uint64_t num_dims;
+        uint64_t buffer_size;
+        uint64_t checksum;
+    };
+
+    static constexpr uint64_t partitioned_magic = 0x54524150534d4c43ul;
+    static constexpr size_t partitioned_header_size = 4096;
+
     static int partition_matrix(
             void const *src,
             void *dst,
@@ -23,6 +43,66 @@ public:
             size_t num_dims,
             size_t buffer_size
             );
+
+    /*
+     * Write the layout produced by partition_matrix directly to a file,
+     * one buffer at a time, without a full partitioned copy in memory.
+     * The data starts after a PartitionedHeader at
+     * partitioned_header_size. Overwrites the file.
+     *
+     * Returns the number of buffers, or a negative value on error.
+     */
+    static int write_partitioned_matrix(
+            void const *src,
+            char const *file_name,
+            size_t size,
+            size_t num_dims,
+            size_t buffer_size
+            );
+
+    /*
+     * Check if file was written by write_partitioned_matrix with the
+     * same arguments, i.e. its header matches and its checksum equals
+     * that of src.
+     *
+     * Returns 1 if the file matches, negative value otherwise.
+     */
+    static int check_partitioned_matrix(
+            void const *src,
+            char const *file_name,
+            size_t size,
+            size_t num_dims,
+            size_t buffer_size
+            );
+
+    /*
+     * 64-bit FNV-1a hash over size bytes, which identifies the data of
+     * a partitioned file.
+     */
+    static uint64_t checksum(void const *src, size_t size);
+
+    /*
+     * Round buffer_size down to a multiple of num_dims * element_size,
+     * so that each dimension of a buffer holds whole elements.
+     */
+    static size_t round_buffer_size(
+            size_t buffer_size,
+            size_t num_dims,
+            size_t element_size
+            );
+
+    /*
+     * Candidate buffer sizes for adaptive buffer size selection.
+     * Powers of two from 1 MiB up to max_buffer_size, each rounded with
+     * round_buffer_size. Stops at the first candidate that holds the
+     * whole object of size bytes, as larger buffers behave the same.
+     */
+    static std::vector<size_t> buffer_size_candidates(
+            size_t size,
+            size_t num_dims,
+            size_t element_size,
+            size_t max_buffer_size
+            );
 };
 
 }
@@ -16,6 +16,7 @@
 
 #include "cl_kernels/centroid_update_feature_sum.hpp"
 #include "cl_kernels/centroid_update_feature_sum_pardim.hpp"
+#include "cl_kernels/centroid_update_feature_sum_tiled.hpp"
 #include "cl_kernels/centroid_update_cluster_merge.hpp"
 
 #include <functional>
@@ -108,6 +109,21 @@ public:
             strategy.prepare(context, config);
             return strategy;
         }
+        else if (config.strategy == "feature_sum_tiled") {
+            measurement.set_parameter(
+                    "CentroidUpdateTileFeatures",
+                    std::to_string(config.tile_features)
+                    );
+
+            CentroidUpdateFeatureSumTiled<
+                PointT,
+                LabelT,
+                MassT,
+                ColMajor>
+                    strategy;
+            strategy.prepare(context, config);
+            return strategy;
+        }
         else if (config.strategy == "cluster_merge") {
             CentroidUpdateClusterMerge<
                 PointT,
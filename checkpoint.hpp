@@ -0,0 +1,353 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "measurement/measurement.hpp"
+#include "timer.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/compute/command_queue.hpp>
+#include <boost/compute/container/vector.hpp>
+#include <boost/compute/event.hpp>
+
+namespace Clustering {
+
+/*
+ * Periodically saves centroids and masses of a running pipeline, such
+ * that a restarted job can resume from the latest saved iteration.
+ *
+ * File format:
+ *
+ * Header header
+ * PointT centroids[0 ... num_clusters-1], in the pipeline's layout
+ * MassT masses[0 ... num_clusters-1]
+ *
+ * Saving copies the device buffers asynchronously to host memory and
+ * writes the file in a background thread, once the copies complete.
+ * The file is written under a temporary name, synced and then renamed,
+ * so the latest checkpoint stays intact if the job is killed or the
+ * machine crashes while writing.
+ *
+ * The header identifies the points by their number and checksum, so
+ * that a checkpoint only resumes the same clustering problem. A
+ * completed run removes its checkpoint.
+ */
+template <typename PointT, typename MassT>
+class Checkpoint {
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t iteration;
+        uint64_t num_features;
+        uint64_t num_clusters;
+        uint32_t point_size;
+        uint32_t mass_size;
+        uint64_t num_points;
+        uint64_t points_checksum;
+    };
+
+    static constexpr uint32_t format_version = 2;
+
+    static constexpr char const *magic = "CLKMCKPT";
+
+    Checkpoint() {}
+    Checkpoint(Checkpoint const&) = delete;
+    Checkpoint& operator=(Checkpoint const&) = delete;
+
+    ~Checkpoint() {
+        wait();
+    }
+
+    /*
+     * Save every interval iterations to file_name.
+     * An interval of 0 disables checkpointing.
+     */
+    void set_file(std::string file_name, uint32_t interval) {
+        file_name_ = file_name;
+        interval_ = interval;
+    }
+
+    /*
+     * Identify the points of the current run. Checkpoints of other
+     * points are rejected by load.
+     */
+    void set_points(uint64_t num_points, uint64_t points_checksum) {
+        num_points_ = num_points;
+        points_checksum_ = points_checksum;
+    }
+
+    bool enabled() const {
+        return interval_ != 0 and not file_name_.empty();
+    }
+
+    /*
+     * Returns true if iteration should be saved.
+     */
+    bool due(uint32_t iteration) const {
+        return enabled() and (iteration + 1) % interval_ == 0;
+    }
+
+    /*
+     * Enqueue copies of centroids and masses after the commands already
+     * in queue and write them in the background. Waits for the previous
+     * checkpoint to be written first.
+     */
+    void save(
+            boost::compute::command_queue& queue,
+            uint32_t iteration,
+            uint64_t num_features,
+            uint64_t num_clusters,
+            boost::compute::vector<PointT> const& centroids,
+            boost::compute::vector<MassT> const& masses,
+            Measurement::DataPoint& datapoint
+            ) {
+        wait();
+
+        datapoint.set_name("Checkpoint");
+
+        host_centroids_.resize(num_features * num_clusters);
+        host_masses_.resize(num_clusters);
+
+        boost::compute::event centroids_event =
+            queue.enqueue_read_buffer_async(
+                    centroids.get_buffer(),
+                    0,
+                    host_centroids_.size() * sizeof(PointT),
+                    host_centroids_.data()
+                    );
+        boost::compute::event masses_event =
+            queue.enqueue_read_buffer_async(
+                    masses.get_buffer(),
+                    0,
+                    host_masses_.size() * sizeof(MassT),
+                    host_masses_.data()
+                    );
+        datapoint.add_event() = centroids_event;
+        datapoint.add_event() = masses_event;
+
+        Header header = {};
+        std::memcpy(header.magic, magic, sizeof(header.magic));
+        header.version = format_version;
+        header.iteration = iteration;
+        header.num_features = num_features;
+        header.num_clusters = num_clusters;
+        header.point_size = sizeof(PointT);
+        header.mass_size = sizeof(MassT);
+        header.num_points = num_points_;
+        header.points_checksum = points_checksum_;
+
+        writer_ = std::thread(
+                [this, header, centroids_event, masses_event, &datapoint]() {
+                    centroids_event.wait();
+                    masses_event.wait();
+
+                    Timer::Timer write_timer;
+                    write_timer.start();
+                    write(header);
+                    datapoint.add_value() = write_timer
+                        .stop<std::chrono::nanoseconds>();
+                });
+    }
+
+    /*
+     * Wait for the checkpoint in progress to be written.
+     */
+    void wait() {
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+    }
+
+    /*
+     * Wait for the checkpoint in progress and delete the file, such that
+     * the next run starts from its initial centroids.
+     */
+    void remove() {
+        wait();
+        if (enabled()) {
+            std::remove(file_name_.c_str());
+        }
+    }
+
+    /*
+     * Load latest checkpoint, if one exists with matching dimensions
+     * and points.
+     *
+     * Returns 1 if successful, 0 if there is no checkpoint, negative
+     * value if the checkpoint cannot be used.
+     */
+    int load(
+            uint64_t num_features,
+            uint64_t num_clusters,
+            uint32_t& iteration,
+            std::vector<PointT>& centroids,
+            std::vector<MassT>& masses
+            ) const {
+
+        std::ifstream fh(file_name_, std::fstream::binary);
+        if (not fh.good()) {
+            return 0;
+        }
+
+        Header header;
+        fh.read((char*) &header, sizeof(header));
+        if (
+                not fh.good()
+                or std::memcmp(header.magic, magic, sizeof(header.magic)) != 0
+                or header.version != format_version
+           )
+        {
+            std::cerr << "Checkpoint: " << file_name_ << " is invalid"
+                << std::endl;
+            return -1;
+        }
+
+        if (
+                header.num_features != num_features
+                or header.num_clusters != num_clusters
+                or header.point_size != sizeof(PointT)
+                or header.mass_size != sizeof(MassT)
+           )
+        {
+            std::cerr << "Checkpoint: " << file_name_
+                << " does not match the problem dimensions"
+                << std::endl;
+            return -1;
+        }
+
+        if (
+                header.num_points != num_points_
+                or header.points_checksum != points_checksum_
+           )
+        {
+            std::cerr << "Checkpoint: " << file_name_
+                << " belongs to different points"
+                << std::endl;
+            return -1;
+        }
+
+        centroids.resize(num_features * num_clusters);
+        masses.resize(num_clusters);
+        fh.read((char*) centroids.data(), centroids.size() * sizeof(PointT));
+        fh.read((char*) masses.data(), masses.size() * sizeof(MassT));
+        if (not fh.good()) {
+            std::cerr << "Checkpoint: " << file_name_ << " is truncated"
+                << std::endl;
+            return -1;
+        }
+
+        iteration = header.iteration;
+
+        return 1;
+    }
+
+private:
+    void write(Header const& header) {
+        std::string const tmp_name = file_name_ + ".tmp";
+
+        int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Checkpoint: cannot open " << tmp_name
+                << ": " << std::strerror(errno) << std::endl;
+            return;
+        }
+        // Sync the data before the rename, such that a crash leaves
+        // either the previous or the complete new checkpoint
+        if (not write_all(fd, &header, sizeof(header))
+                or not write_all(
+                    fd,
+                    host_centroids_.data(),
+                    host_centroids_.size() * sizeof(PointT))
+                or not write_all(
+                    fd,
+                    host_masses_.data(),
+                    host_masses_.size() * sizeof(MassT))
+                or fsync(fd) != 0)
+        {
+            std::cerr << "Checkpoint: cannot write " << tmp_name
+                << ": " << std::strerror(errno) << std::endl;
+            close(fd);
+            return;
+        }
+        close(fd);
+
+        if (std::rename(tmp_name.c_str(), file_name_.c_str()) != 0) {
+            std::cerr << "Checkpoint: cannot rename " << tmp_name
+                << std::endl;
+            return;
+        }
+
+        // Sync the directory to persist the rename
+        size_t const slash = file_name_.rfind('/');
+        std::string const dir_name =
+            (slash == std::string::npos) ? "."
+            : (slash == 0) ? "/"
+            : file_name_.substr(0, slash);
+        int dir_fd = open(dir_name.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd < 0 or fsync(dir_fd) != 0) {
+            std::cerr << "Checkpoint: cannot sync " << dir_name
+                << ": " << std::strerror(errno) << std::endl;
+        }
+        if (dir_fd >= 0) {
+            close(dir_fd);
+        }
+    }
+
+    /*
+     * Write size bytes of data to fd, continuing after partial writes.
+     */
+    static bool write_all(int fd, void const* data, size_t size) {
+        char const* bytes = (char const*) data;
+        while (size > 0) {
+            ssize_t const written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    std::string file_name_;
+    uint32_t interval_ = 0;
+    uint64_t num_points_ = 0;
+    uint64_t points_checksum_ = 0;
+    std::vector<PointT> host_centroids_;
+    std::vector<MassT> host_masses_;
+    std::thread writer_;
+};
+
+template <typename PointT, typename MassT>
+constexpr char const *Checkpoint<PointT, MassT>::magic;
+
+template <typename PointT, typename MassT>
+constexpr uint32_t Checkpoint<PointT, MassT>::format_version;
+
+}
+
+#endif /* CHECKPOINT_HPP */
@@ -11,6 +11,7 @@
 #define CENTROID_UPDATE_FEATURE_SUM_HPP
 
 #include "kernel_path.hpp"
+#include "program_cache.hpp"
 
 #include "reduce_vector_parcol.hpp"
 #include "matrix_binary_op.hpp"
@@ -69,12 +70,14 @@ public:
         defines += boost::compute::type_name<LabelT>();
         defines += " -DCL_MASS=";
         defines += boost::compute::type_name<MassT>();
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
+        }
 
-        Program program = Program::create_with_source_file(
+        Program program = ProgramCache::build(
+                context,
                 PROGRAM_FILE,
-                context);
-
-        program.build(defines);
+                defines);
 
         this->kernel = program.create_kernel(KERNEL_NAME);
 
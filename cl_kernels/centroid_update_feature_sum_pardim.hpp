@@ -11,6 +11,7 @@
 #define CENTROID_UPDATE_FEATURE_SUM_PARDIM_HPP
 
 #include "kernel_path.hpp"
+#include "specialized_kernels.hpp"
 
 #include "reduce_vector_parcol.hpp"
 #include "matrix_binary_op.hpp"
@@ -74,42 +75,12 @@ public:
         defines += std::to_string(config.thread_features);
         defines += " -DVEC_LEN=";
         defines += std::to_string(this->config.vector_length);
-
-        std::string l_stride_defines = " -DLOCAL_STRIDE";
-        std::string g_mem_defines = " -DGLOBAL_MEM";
-
-        Program g_stride_g_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            g_stride_g_mem_program.build(defines + g_mem_defines);
-        }
-        catch (std::exception e) {
-            std::cerr << g_stride_g_mem_program.build_log() << std::endl;
-        }
-        g_stride_g_mem_kernel = g_stride_g_mem_program.create_kernel(KERNEL_NAME);
-
-        Program g_stride_l_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            g_stride_l_mem_program.build(defines);
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
         }
-        catch (std::exception e) {
-            std::cerr << g_stride_l_mem_program.build_log() << std::endl;
-        }
-        g_stride_l_mem_kernel = g_stride_l_mem_program.create_kernel(KERNEL_NAME);
 
-        Program l_stride_g_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-        l_stride_g_mem_program.build(defines + l_stride_defines + g_mem_defines);
-        }
-        catch (std::exception e) {
-            std::cerr << l_stride_g_mem_program.build_log() << std::endl;
-        }
-        l_stride_g_mem_kernel = l_stride_g_mem_program.create_kernel(KERNEL_NAME);
+        // Kernels are compiled on first use of their variant
+        this->kernels.prepare(context, PROGRAM_FILE, KERNEL_NAME, defines);
 
         reduce.prepare(context);
         matrix_add.prepare(context, matrix_add.Add);
@@ -235,12 +206,14 @@ public:
             device.local_memory_size() >
             local_centroids_size * sizeof(PointT)
             ;
-        Kernel& kernel = (use_local_stride)
-            ? l_stride_g_mem_kernel
-            : (use_local_memory)
-            ? g_stride_l_mem_kernel
-            : g_stride_g_mem_kernel
-            ;
+        Kernel& kernel = this->kernels.get(
+                (use_local_stride)
+                ? SpecializedKernels::LocalStrideGlobalMem
+                : (use_local_memory)
+                ? SpecializedKernels::GlobalStrideLocalMem
+                : SpecializedKernels::GlobalStrideGlobalMem,
+                datapoint
+                );
 
         if (use_local_memory) {
             kernel.set_args(
@@ -310,9 +283,7 @@ private:
     static constexpr const char* PROGRAM_FILE = CL_KERNEL_FILE_PATH("lloyd_feature_sum_pardim.cl");
     static constexpr const char* KERNEL_NAME = "lloyd_feature_sum_pardim";
 
-    Kernel g_stride_g_mem_kernel;
-    Kernel g_stride_l_mem_kernel;
-    Kernel l_stride_g_mem_kernel;
+    SpecializedKernels kernels;
     Vector<PointT> tmp_centroids;
     LocalBuffer<PointT> local_centroids;
     CentroidUpdateConfiguration config;
@@ -11,6 +11,7 @@
 #define FUSED_CLUSTER_MERGE_HPP
 
 #include "kernel_path.hpp"
+#include "specialized_kernels.hpp"
 
 #include "reduce_vector_parcol.hpp"
 #include "matrix_binary_op.hpp"
@@ -50,9 +51,6 @@ public:
     using LocalBuffer = boost::compute::local_buffer<T>;
 
     FusedClusterMerge() :
-        g_stride_g_mem_kernel(Utility::log2(MAX_FEATURES)),
-        g_stride_l_mem_kernel(Utility::log2(MAX_FEATURES)),
-        l_stride_g_mem_kernel(Utility::log2(MAX_FEATURES)),
         local_points(1),
         local_new_centroids(1),
         local_masses(1)
@@ -96,61 +94,20 @@ public:
         defines += boost::compute::type_name<MassT>();
         defines += " -DVEC_LEN=";
         defines += std::to_string(this->config.vector_length);
-
-        std::string l_stride_defines = " -DLOCAL_STRIDE";
-        std::string g_mem_defines = " -DGLOBAL_MEM";
-
-        for (size_t d = 2; d <= MAX_FEATURES; d = d * 2) {
-
-            std::string features =
-                " -DNUM_FEATURES="
-                + std::to_string(d);
-
-            Program g_stride_g_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-
-            Program g_stride_l_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-
-            Program l_stride_g_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-
-            size_t kernel_index = Utility::log2(d) - 1;
-
-            try {
-                g_stride_g_mem_program.build(defines + features + g_mem_defines);
-                g_stride_g_mem_kernel[kernel_index] =
-                    g_stride_g_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cerr << g_stride_g_mem_program.build_log() << std::endl;
-                throw e;
-            }
-
-            try {
-                g_stride_l_mem_program.build(defines + features);
-                g_stride_l_mem_kernel[kernel_index] =
-                    g_stride_l_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cerr << g_stride_l_mem_program.build_log() << std::endl;
-                throw e;
-            }
-
-            try {
-                l_stride_g_mem_program.build(defines + features + l_stride_defines + g_mem_defines);
-                l_stride_g_mem_kernel[kernel_index] =
-                    l_stride_g_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cerr << l_stride_g_mem_program.build_log() << std::endl;
-                throw e;
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
+        }
+        if (this->config.point_storage != PointStorage::Native) {
+            if (not std::is_same<float, PointT>::value) {
+                throw std::invalid_argument(
+                        "Reduced point storage requires float points");
             }
+            defines += PointStorageHelper::defines(this->config.point_storage);
         }
 
+        // Kernels are specialized for num_features on first use
+        this->kernels.prepare(context, PROGRAM_FILE, KERNEL_NAME, defines);
+
         reduce_centroids.prepare(context);
         reduce_masses.prepare(context);
         matrix_add_centroids.prepare(context, matrix_add_centroids.Add);
@@ -296,7 +253,30 @@ public:
                 queue
                 );
 
-        size_t kernel_index = Utility::log2(num_features) - 1;
+        // Scales followed by offsets of quantized points
+        if (
+                this->config.point_storage == PointStorage::Int8
+                and this->quantization.size() != 2 * num_features
+           )
+        {
+            assert(this->config.quantization.scale.size() == num_features);
+            std::vector<PointT> quantization(
+                    this->config.quantization.scale.begin(),
+                    this->config.quantization.scale.end()
+                    );
+            quantization.insert(
+                    quantization.end(),
+                    this->config.quantization.offset.begin(),
+                    this->config.quantization.offset.end()
+                    );
+            this->quantization = std::move(
+                    Vector<PointT>(
+                        quantization.begin(),
+                        quantization.end(),
+                        queue
+                        ));
+        }
+
         boost::compute::device device = queue.get_device();
         bool use_local_stride =
             device.type() == device.cpu ||
@@ -311,14 +291,15 @@ public:
              local_masses.size() * sizeof(MassT)
             )
             ;
-        auto& kernel = (use_local_stride)
-            ? l_stride_g_mem_kernel[kernel_index]
-            : (
-                    use_local_memory
-              )
-            ? g_stride_l_mem_kernel[kernel_index]
-            : g_stride_g_mem_kernel[kernel_index]
-            ;
+        Kernel& kernel = this->kernels.get(
+                num_features,
+                (use_local_stride)
+                ? SpecializedKernels::LocalStrideGlobalMem
+                : (use_local_memory)
+                ? SpecializedKernels::GlobalStrideLocalMem
+                : SpecializedKernels::GlobalStrideGlobalMem,
+                datapoint
+                );
 
         if (use_local_memory) {
             kernel.set_args(
@@ -344,6 +325,10 @@ public:
                     (cl_uint)num_clusters);
         }
 
+        if (this->config.point_storage == PointStorage::Int8) {
+            kernel.set_arg(kernel.arity() - 1, this->quantization);
+        }
+
         size_t work_offset[3] = {0, 0, 0};
 
         Event event;
@@ -419,12 +404,11 @@ private:
     static constexpr const char* KERNEL_NAME = "lloyd_fused_cluster_merge";
     static constexpr const size_t MAX_FEATURES = 1024;
 
-    std::vector<Kernel> g_stride_g_mem_kernel;
-    std::vector<Kernel> g_stride_l_mem_kernel;
-    std::vector<Kernel> l_stride_g_mem_kernel;
+    SpecializedKernels kernels;
     Vector<PointT> tmp_new_centroids;
     Vector<MassT> new_masses;
     ReadonlyVector<PointT> ro_centroids;
+    Vector<PointT> quantization;
     LocalBuffer<PointT> local_points;
     LocalBuffer<PointT> local_new_centroids;
     LocalBuffer<MassT> local_masses;
@@ -0,0 +1,198 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef LABELING_TILED_ASYNC_HPP
+#define LABELING_TILED_ASYNC_HPP
+
+#include "kernel_path.hpp"
+#include "program_cache.hpp"
+
+#include "../labeling_configuration.hpp"
+#include "../measurement/measurement.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <boost/compute/core.hpp>
+#include <boost/compute/container/vector.hpp>
+#include <boost/compute/memory/local_buffer.hpp>
+#include <boost/compute/allocator/pinned_allocator.hpp>
+
+namespace Clustering {
+
+/*
+ * Labeling for many clusters
+ *
+ * As LabelingTiled, but double-buffers centroid tiles in local memory.
+ * The next tile is copied asynchronously while the current tile is
+ * compared to the points.
+ */
+template <typename PointT, typename LabelT, bool ColMajor>
+class LabelingTiledAsync {
+public:
+    using Event = boost::compute::event;
+    using Context = boost::compute::context;
+    using Kernel = boost::compute::kernel;
+    using Program = boost::compute::program;
+    template <typename T>
+    using LocalBuffer = boost::compute::local_buffer<T>;
+    template <typename T>
+    using Vector = boost::compute::vector<T>;
+    template <typename T>
+    using PinnedAllocator = boost::compute::pinned_allocator<T>;
+    template <typename T>
+    using PinnedVector = boost::compute::vector<T, PinnedAllocator<T>>;
+
+    LabelingTiledAsync() :
+        local_centroids(1)
+    {}
+
+    void prepare(Context context, LabelingConfiguration config) {
+        assert(config.tile_features > 0);
+        assert(config.tile_clusters > 0);
+
+        this->config = config;
+
+        std::string defines;
+        defines += " -DCL_INT=uint";
+        defines += " -DCL_POINT=";
+        defines += boost::compute::type_name<PointT>();
+        defines += " -DCL_LABEL=";
+        defines += boost::compute::type_name<LabelT>();
+        if (std::is_same<float, PointT>::value) {
+            defines += " -DCL_POINT_MAX=FLT_MAX";
+        }
+        else if (std::is_same<double, PointT>::value) {
+            defines += " -DCL_POINT_MAX=DBL_MAX";
+        }
+        else {
+            assert(false);
+        }
+        defines += " -DTILE_FEATURES="
+            + std::to_string(this->config.tile_features);
+        defines += " -DTILE_CLUSTERS="
+            + std::to_string(this->config.tile_clusters);
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
+        }
+
+        Program program = ProgramCache::build(
+                context,
+                PROGRAM_FILE,
+                defines);
+
+        this->kernel = program.create_kernel(KERNEL_NAME);
+
+        // Two tiles for double buffering
+        this->local_centroids = std::move(
+                LocalBuffer<PointT>(
+                    2
+                    * this->config.tile_clusters
+                    * this->config.tile_features
+                    ));
+    }
+
+    Event operator() (
+            boost::compute::command_queue queue,
+            size_t num_features,
+            size_t num_points,
+            size_t num_clusters,
+            Vector<PointT>& points,
+            Vector<PointT>& centroids,
+            PinnedVector<LabelT>& labels,
+            Measurement::DataPoint& datapoint,
+            boost::compute::wait_list const& events
+            )
+    {
+        return (*this)(
+                queue,
+                num_features,
+                num_points,
+                num_clusters,
+                points.begin(),
+                points.end(),
+                centroids.begin(),
+                centroids.end(),
+                labels.begin(),
+                labels.end(),
+                datapoint,
+                events
+                );
+    }
+
+    Event operator() (
+            boost::compute::command_queue queue,
+            size_t num_features,
+            size_t num_points,
+            size_t num_clusters,
+            boost::compute::buffer_iterator<PointT> points_begin,
+            boost::compute::buffer_iterator<PointT> points_end,
+            boost::compute::buffer_iterator<PointT> centroids_begin,
+            boost::compute::buffer_iterator<PointT> centroids_end,
+            boost::compute::buffer_iterator<LabelT> labels_begin,
+            boost::compute::buffer_iterator<LabelT> labels_end,
+            Measurement::DataPoint& datapoint,
+            boost::compute::wait_list const& events
+            )
+    {
+
+        assert(points_end - points_begin == (long) (num_points * num_features));
+        assert(centroids_end - centroids_begin == (long) (num_clusters * num_features));
+        assert(labels_end - labels_begin == (long) num_points);
+        assert(points_begin.get_index() == 0u);
+        assert(centroids_begin.get_index() == 0u);
+        assert(labels_begin.get_index() == 0u);
+        if (queue.get_device().local_memory_size()
+                < this->local_centroids.size() * sizeof(PointT))
+        {
+            throw std::invalid_argument(
+                    "LabelingTiledAsync: centroid tiles exceed local memory");
+        }
+
+        datapoint.set_name("LabelingTiledAsync");
+
+        this->kernel.set_args(
+                points_begin.get_buffer(),
+                centroids_begin.get_buffer(),
+                labels_begin.get_buffer(),
+                this->local_centroids,
+                (cl_uint) num_features,
+                (cl_uint) num_points,
+                (cl_uint) num_clusters);
+
+        size_t work_offset[3] = {0, 0, 0};
+
+        Event event;
+        event = queue.enqueue_nd_range_kernel(
+                this->kernel,
+                1,
+                work_offset,
+                this->config.global_size,
+                this->config.local_size,
+                events);
+
+        datapoint.add_event() = event;
+        return event;
+    }
+
+private:
+    static constexpr const char* PROGRAM_FILE = CL_KERNEL_FILE_PATH("lloyd_labeling_tiled.cl");
+    static constexpr const char* KERNEL_NAME = "lloyd_labeling_tiled_async";
+
+    Kernel kernel;
+    LocalBuffer<PointT> local_centroids;
+    LabelingConfiguration config;
+
+};
+
+}
+
+#endif /* LABELING_TILED_ASYNC_HPP */
@@ -11,6 +11,7 @@
 #define LABELING_UNROLL_VECTOR_HPP
 
 #include "kernel_path.hpp"
+#include "specialized_kernels.hpp"
 
 #include "../utility.hpp"
 #include "../labeling_configuration.hpp"
@@ -51,9 +52,6 @@ public:
     using PinnedVector = boost::compute::vector<T, PinnedAllocator<T>>;
 
     LabelingUnrollVector() :
-        g_stride_g_mem_kernel(Utility::log2(MAX_FEATURES)),
-        g_stride_l_mem_kernel(Utility::log2(MAX_FEATURES)),
-        l_stride_g_mem_kernel(Utility::log2(MAX_FEATURES)),
         local_points(1)
     {}
 
@@ -80,61 +78,12 @@ public:
 
         defines += " -DVEC_LEN="
             + std::to_string(this->config.vector_length);
-
-        std::string l_stride_defines = " -DLOCAL_STRIDE";
-        std::string g_mem_defines = " -DGLOBAL_MEM";
-
-        for (uint32_t d = 2; d <= MAX_FEATURES; d = d * 2) {
-
-            std::string features =
-                " -DNUM_FEATURES="
-                + std::to_string(d);
-
-            Program g_stride_g_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-            Program g_stride_l_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-            Program l_stride_g_mem_program = Program::create_with_source_file(
-                    PROGRAM_FILE,
-                    context);
-
-            size_t kernel_index = Utility::log2(d) - 1;
-
-            try {
-                g_stride_g_mem_program.build(defines + features + g_mem_defines);
-                g_stride_g_mem_kernel[kernel_index] =
-                    g_stride_g_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cout << g_stride_g_mem_program.build_log() << std::endl;
-                throw e;
-            }
-
-            try {
-                g_stride_l_mem_program.build(defines + features);
-                g_stride_l_mem_kernel[kernel_index] =
-                    g_stride_l_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cout << g_stride_l_mem_program.build_log() << std::endl;
-                throw e;
-            }
-
-            try {
-                l_stride_g_mem_program.build(
-                        defines + features + l_stride_defines + g_mem_defines
-                        );
-                l_stride_g_mem_kernel[kernel_index] =
-                    l_stride_g_mem_program.create_kernel(KERNEL_NAME);
-            }
-            catch (std::exception e) {
-                std::cout << l_stride_g_mem_program.build_log() << std::endl;
-                throw e;
-            }
-
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
         }
+
+        // Kernels are specialized for num_features on first use
+        this->kernels.prepare(context, PROGRAM_FILE, KERNEL_NAME, defines);
     }
 
     Event operator() (
@@ -211,12 +160,16 @@ public:
                         queue.get_context()
                         ));
         }
-        boost::compute::copy(
-                centroids_begin,
-                centroids_begin + num_clusters * num_features,
-                this->ro_centroids.begin(),
-                queue
+        // Copy asynchronously to respect events on out-of-order queues
+        Event centroids_copy_event = queue.enqueue_copy_buffer(
+                centroids_begin.get_buffer(),
+                this->ro_centroids.get_buffer(),
+                centroids_begin.get_index() * sizeof(PointT),
+                0,
+                num_clusters * num_features * sizeof(PointT),
+                events
                 );
+        boost::compute::wait_list kernel_wait_list(centroids_copy_event);
 
         boost::compute::device device = queue.get_device();
         bool use_local_stride =
@@ -228,18 +181,18 @@ public:
             device.local_memory_size() >
             local_points_size * sizeof(PointT)
             ;
-        auto& kernel = (use_local_stride)
-            ? this->l_stride_g_mem_kernel
-            : (
-                    use_local_memory
-              )
-            ? this->g_stride_l_mem_kernel
-            : this->g_stride_g_mem_kernel
-            ;
-        size_t kernel_index = Utility::log2(num_features) - 1;
+        Kernel& kernel = this->kernels.get(
+                num_features,
+                (use_local_stride)
+                ? SpecializedKernels::LocalStrideGlobalMem
+                : (use_local_memory)
+                ? SpecializedKernels::GlobalStrideLocalMem
+                : SpecializedKernels::GlobalStrideGlobalMem,
+                datapoint
+                );
 
         if (use_local_memory) {
-            kernel[kernel_index].set_args(
+            kernel.set_args(
                     points_begin.get_buffer(),
                     this->ro_centroids,
                     labels_begin.get_buffer(),
@@ -248,7 +201,7 @@ public:
                     (cl_uint) num_clusters);
         }
         else {
-            kernel[kernel_index].set_args(
+            kernel.set_args(
                     points_begin.get_buffer(),
                     this->ro_centroids,
                     labels_begin.get_buffer(),
@@ -260,12 +213,12 @@ public:
 
         Event event;
         event = queue.enqueue_nd_range_kernel(
-                kernel[kernel_index],
+                kernel,
                 1,
                 work_offset,
                 this->config.global_size,
                 this->config.local_size,
-                events);
+                kernel_wait_list);
 
         datapoint.add_event() = event;
         return event;
@@ -276,9 +229,7 @@ private:
     static constexpr const char* KERNEL_NAME = "lloyd_labeling_vp_clcp";
     static constexpr const size_t MAX_FEATURES = 1024;
 
-    std::vector<Kernel> g_stride_g_mem_kernel;
-    std::vector<Kernel> g_stride_l_mem_kernel;
-    std::vector<Kernel> l_stride_g_mem_kernel;
+    SpecializedKernels kernels;
     ReadonlyVector<PointT> ro_centroids;
     LocalBuffer<PointT> local_points;
     LabelingConfiguration config;
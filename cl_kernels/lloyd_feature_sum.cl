@@ -33,6 +33,19 @@ CL_INT ccoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
     return dim * col + row;
 }
 
+CL_INT rcoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
+    return dim * row + col;
+}
+
+// Define ROW_MAJOR for row major points and centroids
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#endif
+
 __kernel
 void lloyd_feature_sum_sequential(
         __global CL_POINT const *const restrict g_points,
@@ -56,16 +69,9 @@ void lloyd_feature_sum_sequential(
     CL_INT const point_offset = num_local_points * point_block;
     CL_INT const centroid_offset =
         NUM_CLUSTERS * NUM_FEATURES * point_block;
-    CL_INT const feature_offset =
-        centroid_offset + NUM_CLUSTERS * feature;
 
-    for (
-            CL_INT i = feature_offset;
-            i < feature_offset + NUM_CLUSTERS;
-            ++i
-        )
-    {
-        g_centroids[i] = 0;
+    for (CL_INT c = 0; c < NUM_CLUSTERS; ++c) {
+        g_centroids[centroid_offset + CENTROID_IND(c, feature)] = 0;
     }
 
     for (
@@ -76,14 +82,16 @@ void lloyd_feature_sum_sequential(
     {
 
         CL_LABEL label = g_labels[p];
-        CL_POINT point = g_points[ccoord2ind(NUM_POINTS, p, feature)];
+        CL_POINT point = g_points[POINT_IND(p, feature)];
 
         g_centroids[
-            centroid_offset + ccoord2ind(NUM_CLUSTERS, label, feature)
+            centroid_offset + CENTROID_IND(label, feature)
         ] += point;
     }
 }
 
+// Column major only
+#ifndef ROW_MAJOR
 __kernel
 void lloyd_feature_sum_sequential_v(
         __global CL_POINT const *const restrict g_points,
@@ -173,3 +181,94 @@ void lloyd_feature_sum_sequential_v(
     //     }
     // }
 }
+#endif
+
+/*
+ * Feature sum for points with many features
+ *
+ * Each work group sums a tile of TILE_FEATURES features over a block of
+ * points, with one column of TILE_FEATURES x NUM_CLUSTERS partial sums
+ * in local memory. Threads own distinct features of the tile, thus need
+ * no synchronization.
+ *
+ * Work groups cycle through all (point block, feature tile) pairs, such
+ * that any number of features fits into any global size.
+ */
+__kernel
+void lloyd_feature_sum_tiled(
+        __global CL_POINT const *const restrict g_points,
+        __global CL_POINT *const restrict g_centroids,
+        __global CL_LABEL const *const restrict g_labels,
+        __local CL_POINT *const restrict l_centroids,
+        const CL_INT NUM_FEATURES,
+        const CL_INT NUM_POINTS,
+        const CL_INT NUM_CLUSTERS,
+        const CL_INT TILE_FEATURES,
+        const CL_INT NUM_POINT_BLOCKS
+        )
+{
+    CL_INT const num_tiles =
+        (NUM_FEATURES + TILE_FEATURES - 1) / TILE_FEATURES;
+    CL_INT const num_block_points =
+        (NUM_POINTS + NUM_POINT_BLOCKS - 1) / NUM_POINT_BLOCKS;
+
+    for (
+            CL_INT slot = get_group_id(0);
+            slot < NUM_POINT_BLOCKS * num_tiles;
+            slot += get_num_groups(0)
+        )
+    {
+        CL_INT const point_block = slot / num_tiles;
+        CL_INT const feature_offset = (slot % num_tiles) * TILE_FEATURES;
+        CL_INT const num_tile_features =
+            min(TILE_FEATURES, NUM_FEATURES - feature_offset);
+        CL_INT const point_offset = num_block_points * point_block;
+        CL_INT const num_real_block_points =
+            min(num_block_points, sub_sat(NUM_POINTS, point_offset));
+        CL_INT const centroid_offset =
+            NUM_CLUSTERS * NUM_FEATURES * point_block;
+
+        for (
+                CL_INT f = get_local_id(0);
+                f < num_tile_features;
+                f += get_local_size(0)
+            )
+        {
+            for (CL_INT c = 0; c < NUM_CLUSTERS; ++c) {
+                l_centroids[ccoord2ind(TILE_FEATURES, f, c)] = 0;
+            }
+        }
+
+        for (
+                CL_INT p = point_offset;
+                p < point_offset + num_real_block_points;
+                ++p
+            )
+        {
+            CL_LABEL const label = g_labels[p];
+
+            for (
+                    CL_INT f = get_local_id(0);
+                    f < num_tile_features;
+                    f += get_local_size(0)
+                )
+            {
+                l_centroids[ccoord2ind(TILE_FEATURES, f, label)] +=
+                    g_points[POINT_IND(p, feature_offset + f)];
+            }
+        }
+
+        for (
+                CL_INT f = get_local_id(0);
+                f < num_tile_features;
+                f += get_local_size(0)
+            )
+        {
+            for (CL_INT c = 0; c < NUM_CLUSTERS; ++c) {
+                g_centroids[
+                    centroid_offset + CENTROID_IND(c, feature_offset + f)
+                ] = l_centroids[ccoord2ind(TILE_FEATURES, f, c)];
+            }
+        }
+    }
+}
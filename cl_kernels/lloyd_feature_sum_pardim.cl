@@ -12,6 +12,9 @@
 //
 // #define GLOBAL_MEM
 // Default: local memory cache
+//
+// #define ROW_MAJOR
+// Default: column major points and centroids
 
 #ifndef CL_INT
 #define CL_INT ulong
@@ -33,6 +36,7 @@
 #define VEC_TYPE(TYPE) TYPE
 #define VLOAD(P) (*(P))
 #define VSTORE(DATA, P) do { *(P) = DATA; } while (false)
+#define VGATHER(P, S) (*(P))
 
 #else
 #define VEC_TYPE_JUMP(TYPE, LEN) TYPE##LEN
@@ -46,6 +50,22 @@
 #define VSTORE_JUMP(DATA, P, LEN) vstore##LEN(DATA, 0, P)
 #define VSTORE_JUMP_2(DATA, P, LEN) VSTORE_JUMP(DATA, P, LEN)
 #define VSTORE(DATA, P) VSTORE_JUMP_2(DATA, P, VEC_LEN)
+
+// Gather vector from elements that are S apart
+#define VGATHER_2(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 2))((P)[0], (P)[S]))
+#define VGATHER_4(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 4))(                                    \
+        VGATHER_2(P, S), VGATHER_2((P) + 2 * (S), S)))
+#define VGATHER_8(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 8))(                                    \
+        VGATHER_4(P, S), VGATHER_4((P) + 4 * (S), S)))
+#define VGATHER_16(P, S)                                                \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 16))(                                   \
+        VGATHER_8(P, S), VGATHER_8((P) + 8 * (S), S)))
+#define VGATHER_JUMP(P, S, LEN) VGATHER_ ## LEN(P, S)
+#define VGATHER_JUMP_2(P, S, LEN) VGATHER_JUMP(P, S, LEN)
+#define VGATHER(P, S) VGATHER_JUMP_2(P, S, VEC_LEN)
 #endif
 
 CL_INT ccoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
@@ -63,6 +83,19 @@ CL_INT rcoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
     return dim * row + col;
 }
 
+// Global points and centroids indexing
+// Row major points are vector loaded by gathering features of
+// consecutive points
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#define POINT_VLOAD(P, F) VGATHER(&g_points[POINT_IND(P, F)], NUM_FEATURES)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#define POINT_VLOAD(P, F) VLOAD(&g_points[POINT_IND(P, F)])
+#endif
+
 CL_INT div_round_up(CL_INT dividend, CL_INT divisor) {
     return (dividend + divisor - 1) / divisor;
 }
@@ -95,7 +128,7 @@ void lloyd_feature_sum_pardim(
         for (CL_INT c = 0; c < NUM_CLUSTERS; ++c) {
             g_centroids[
                 g_cluster_offset +
-                    ccoord2ind(NUM_CLUSTERS, c, g_feature_base + f)
+                    CENTROID_IND(c, g_feature_base + f)
             ] = 0.0;
         }
     }
@@ -157,16 +190,13 @@ void lloyd_feature_sum_pardim(
 
         for (CL_INT f = 0; f < NUM_THREAD_FEATURES; ++f) {
             VEC_TYPE(CL_POINT) point =
-                VLOAD(&g_points[
-                        ccoord2ind(NUM_POINTS, r, g_feature_base + f)
-                ]);
+                POINT_VLOAD(r, g_feature_base + f);
 #if VEC_LEN > 1
 #ifdef GLOBAL_MEM
 #define BASE_STEP(NUM)                                                  \
             g_centroids[                                                \
             g_cluster_offset +                                          \
-                ccoord2ind(                                             \
-                        NUM_CLUSTERS,                                   \
+                CENTROID_IND(                                           \
                         label.s ## NUM,                                 \
                         g_feature_base + f                              \
                         )                                               \
@@ -195,7 +225,7 @@ void lloyd_feature_sum_pardim(
 #ifdef GLOBAL_MEM
             g_centroids[
                 g_cluster_offset +
-                    ccoord2ind(NUM_CLUSTERS, label, g_feature_base + f)
+                    CENTROID_IND(label, g_feature_base + f)
             ] += point;
 #else
             l_centroids[
@@ -214,7 +244,7 @@ void lloyd_feature_sum_pardim(
                 ccoord2abc(NUM_CLUSTERS, c, f)
             ];
             g_centroids[
-                g_cluster_offset + ccoord2ind(NUM_CLUSTERS, c, g_feature_base + f)
+                g_cluster_offset + CENTROID_IND(c, g_feature_base + f)
             ] = centroid;
         }
     }
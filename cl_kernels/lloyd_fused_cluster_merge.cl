@@ -12,6 +12,14 @@
 //
 // #define GLOBAL_MEM
 // Default: local memory cache
+//
+// #define ROW_MAJOR
+// Default: column major points and centroids
+//
+// #define POINT_HALF
+// #define POINT_BFLOAT16
+// #define POINT_INT8
+// Default: points stored as CL_POINT
 
 #ifndef CL_INT
 #define CL_INT uint
@@ -46,6 +54,7 @@
 #define VEC_TYPE(TYPE) TYPE
 #define VLOAD(P) (*(P))
 #define VSTORE(DATA, P) do { *(P) = DATA; } while (false)
+#define VGATHER(P, S) POINT_ELEM(P, 0)
 
 #else
 #define VEC_TYPE_JUMP(TYPE, LEN) TYPE##LEN
@@ -59,6 +68,65 @@
 #define VSTORE_JUMP(DATA, P, LEN) vstore##LEN(DATA, 0, P)
 #define VSTORE_JUMP_2(DATA, P, LEN) VSTORE_JUMP(DATA, P, LEN)
 #define VSTORE(DATA, P) VSTORE_JUMP_2(DATA, P, VEC_LEN)
+
+// Gather vector from elements that are S apart
+#define VGATHER_2(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 2))(POINT_ELEM(P, 0), POINT_ELEM(P, S)))
+#define VGATHER_4(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 4))(                                    \
+        VGATHER_2(P, S), VGATHER_2((P) + 2 * (S), S)))
+#define VGATHER_8(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 8))(                                    \
+        VGATHER_4(P, S), VGATHER_4((P) + 4 * (S), S)))
+#define VGATHER_16(P, S)                                                \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 16))(                                   \
+        VGATHER_8(P, S), VGATHER_8((P) + 8 * (S), S)))
+#define VGATHER_JUMP(P, S, LEN) VGATHER_ ## LEN(P, S)
+#define VGATHER_JUMP_2(P, S, LEN) VGATHER_JUMP(P, S, LEN)
+#define VGATHER(P, S) VGATHER_JUMP_2(P, S, VEC_LEN)
+#endif
+
+// Points in global memory are stored as CL_POINT_STORE and widened to
+// CL_POINT on load. Reduced points require CL_POINT float.
+#define CONVERT_JUMP(TYPE, X) convert_##TYPE(X)
+#define CONVERT_JUMP_2(TYPE, X) CONVERT_JUMP(TYPE, X)
+
+#if defined(POINT_HALF)
+#define CL_POINT_STORE half
+#define POINT_ELEM(P, I) vload_half(I, P)
+#if VEC_LEN == 1
+#define POINT_VLOAD_CONT(P) vload_half(0, P)
+#else
+#define VLOAD_HALF_JUMP(P, LEN) vload_half##LEN(0, P)
+#define VLOAD_HALF_JUMP_2(P, LEN) VLOAD_HALF_JUMP(P, LEN)
+#define POINT_VLOAD_CONT(P) VLOAD_HALF_JUMP_2(P, VEC_LEN)
+#endif
+
+#elif defined(POINT_BFLOAT16)
+// bfloat16 is the upper half of a float
+#define CL_POINT_STORE ushort
+#define POINT_ELEM(P, I) as_float((uint)(P)[I] << 16)
+#define AS_JUMP(TYPE, X) as_##TYPE(X)
+#define AS_JUMP_2(TYPE, X) AS_JUMP(TYPE, X)
+#define POINT_VLOAD_CONT(P)                                             \
+    AS_JUMP_2(VEC_TYPE(float), CONVERT_JUMP_2(VEC_TYPE(uint), VLOAD(P)) << 16)
+
+#elif defined(POINT_INT8)
+// 8-bit codes, dequantized with per-feature scale and offset in
+// g_quant[0 ... NUM_FEATURES-1] and g_quant[NUM_FEATURES ... ]
+#define CL_POINT_STORE uchar
+#define POINT_ELEM(P, I) convert_float((P)[I])
+#define POINT_VLOAD_CONT(P) CONVERT_JUMP_2(VEC_TYPE(float), VLOAD(P))
+#define POINT_DEQUANT(V, F) ((V) * g_quant[F] + g_quant[NUM_FEATURES + (F)])
+
+#else
+#define CL_POINT_STORE CL_POINT
+#define POINT_ELEM(P, I) (P)[I]
+#define POINT_VLOAD_CONT(P) VLOAD(P)
+#endif
+
+#ifndef POINT_DEQUANT
+#define POINT_DEQUANT(V, F) (V)
 #endif
 
 #define REP_STEP_2(BASE_STEP) BASE_STEP(0) BASE_STEP(1)
@@ -78,6 +146,25 @@ CL_INT ccoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
     return dim * col + row;
 }
 
+CL_INT rcoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
+    return dim * row + col;
+}
+
+// Global points and centroids indexing
+// Row major points are vector loaded by gathering features of
+// consecutive points
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#define POINT_VLOAD(P, F)                                               \
+    POINT_DEQUANT(VGATHER(&g_points[POINT_IND(P, F)], NUM_FEATURES), F)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#define POINT_VLOAD(P, F)                                               \
+    POINT_DEQUANT(POINT_VLOAD_CONT(&g_points[POINT_IND(P, F)]), F)
+#endif
+
 // Anti-bank conflict column major indexing
 // Warning: Use only for local memory buffers
 CL_INT ccoord2abc(CL_INT dim, CL_INT row, CL_INT col) {
@@ -87,7 +174,7 @@ CL_INT ccoord2abc(CL_INT dim, CL_INT row, CL_INT col) {
 // Note: Define NUM_FEATURES in preprocessor
 __kernel
 void lloyd_fused_cluster_merge(
-        __global CL_POINT const *const restrict g_points,
+        __global CL_POINT_STORE const *const restrict g_points,
         __constant CL_POINT const *const restrict g_old_centroids,
         __global CL_POINT *const restrict g_new_centroids,
         __global CL_MASS *const restrict g_masses,
@@ -99,6 +186,9 @@ void lloyd_fused_cluster_merge(
 #endif
         CL_INT const NUM_POINTS,
         CL_INT const NUM_CLUSTERS
+#ifdef POINT_INT8
+        , __constant CL_POINT const *const restrict g_quant
+#endif
         )
 {
 
@@ -117,7 +207,7 @@ void lloyd_fused_cluster_merge(
     for (CL_INT c = 0; c < NUM_CLUSTERS; ++c) {
         for (CL_INT f = 0; f < NUM_FEATURES; ++f) {
             g_new_centroids[
-                g_cluster_offset + ccoord2ind(NUM_CLUSTERS, c, f)
+                g_cluster_offset + CENTROID_IND(c, f)
             ] = 0;
         }
     }
@@ -176,7 +266,7 @@ void lloyd_fused_cluster_merge(
         for (CL_INT f = 0; f < NUM_FEATURES; ++f) {
             // Read point
             VEC_TYPE(CL_POINT) point
-            = VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+            = POINT_VLOAD(p, f);
 
             // Cache point
             l_points[
@@ -197,7 +287,7 @@ void lloyd_fused_cluster_merge(
                 // Read point
                 VEC_TYPE(CL_POINT) point =
 #ifdef GLOBAL_MEM
-                    VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                    POINT_VLOAD(p, f);
 #else
                     l_points[
                         ccoord2ind(get_local_size(0), get_local_id(0), f)
@@ -207,7 +297,7 @@ void lloyd_fused_cluster_merge(
                 // Calculate distance
                 VEC_TYPE(CL_POINT) difference
                     = point - g_old_centroids[
-                    ccoord2ind(NUM_CLUSTERS, c, f)
+                    CENTROID_IND(c, f)
                     ];
                 dist = fma(difference, difference, dist);
             }
@@ -245,7 +335,7 @@ void lloyd_fused_cluster_merge(
         for (CL_INT f = 0; f < NUM_FEATURES; ++f) {
             VEC_TYPE(CL_POINT) point =
 #ifdef GLOBAL_MEM
-                VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                POINT_VLOAD(p, f);
 #else
                 l_points[
                     ccoord2ind(get_local_size(0), get_local_id(0), f)
@@ -256,7 +346,7 @@ void lloyd_fused_cluster_merge(
 #ifdef GLOBAL_MEM
 #define CENTROID_UPDATE_BASE(NUM)                                              \
             g_new_centroids[                                                   \
-                g_cluster_offset + ccoord2ind(NUM_CLUSTERS, label.s ## NUM, f) \
+                g_cluster_offset + CENTROID_IND(label.s ## NUM, f)             \
             ] += point.s ## NUM;
 #else
 #define CENTROID_UPDATE_BASE(NUM)                               \
@@ -269,7 +359,7 @@ void lloyd_fused_cluster_merge(
 #else
 #ifdef GLOBAL_MEM
             g_new_centroids[
-                g_cluster_offset + ccoord2ind(NUM_CLUSTERS, label, f)
+                g_cluster_offset + CENTROID_IND(label, f)
             ] += point;
 #else
             l_new_centroids[
@@ -296,7 +386,7 @@ void lloyd_fused_cluster_merge(
                 ccoord2abc(NUM_CLUSTERS, c, f)
             ];
             g_new_centroids[
-                g_cluster_offset + ccoord2ind(NUM_CLUSTERS, c, f)
+                g_cluster_offset + CENTROID_IND(c, f)
             ] = centroid;
         }
     }
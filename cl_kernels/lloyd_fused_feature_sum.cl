@@ -12,6 +12,14 @@
 //
 // #define GLOBAL_MEM
 // Default: local memory cache
+//
+// #define ROW_MAJOR
+// Default: column major points and centroids
+//
+// #define POINT_HALF
+// #define POINT_BFLOAT16
+// #define POINT_INT8
+// Default: points stored as CL_POINT
 
 #ifndef CL_INT
 #define CL_INT uint
@@ -46,6 +54,7 @@
 #define VEC_TYPE(TYPE) TYPE
 #define VLOAD(P) (*(P))
 #define VSTORE(DATA, P) do { *(P) = DATA; } while (false)
+#define VGATHER(P, S) POINT_ELEM(P, 0)
 
 #else
 #define VEC_TYPE_JUMP(TYPE, LEN) TYPE##LEN
@@ -59,6 +68,65 @@
 #define VSTORE_JUMP(DATA, P, LEN) vstore##LEN(DATA, 0, P)
 #define VSTORE_JUMP_2(DATA, P, LEN) VSTORE_JUMP(DATA, P, LEN)
 #define VSTORE(DATA, P) VSTORE_JUMP_2(DATA, P, VEC_LEN)
+
+// Gather vector from elements that are S apart
+#define VGATHER_2(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 2))(POINT_ELEM(P, 0), POINT_ELEM(P, S)))
+#define VGATHER_4(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 4))(                                    \
+        VGATHER_2(P, S), VGATHER_2((P) + 2 * (S), S)))
+#define VGATHER_8(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 8))(                                    \
+        VGATHER_4(P, S), VGATHER_4((P) + 4 * (S), S)))
+#define VGATHER_16(P, S)                                                \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 16))(                                   \
+        VGATHER_8(P, S), VGATHER_8((P) + 8 * (S), S)))
+#define VGATHER_JUMP(P, S, LEN) VGATHER_ ## LEN(P, S)
+#define VGATHER_JUMP_2(P, S, LEN) VGATHER_JUMP(P, S, LEN)
+#define VGATHER(P, S) VGATHER_JUMP_2(P, S, VEC_LEN)
+#endif
+
+// Points in global memory are stored as CL_POINT_STORE and widened to
+// CL_POINT on load. Reduced points require CL_POINT float.
+#define CONVERT_JUMP(TYPE, X) convert_##TYPE(X)
+#define CONVERT_JUMP_2(TYPE, X) CONVERT_JUMP(TYPE, X)
+
+#if defined(POINT_HALF)
+#define CL_POINT_STORE half
+#define POINT_ELEM(P, I) vload_half(I, P)
+#if VEC_LEN == 1
+#define POINT_VLOAD_CONT(P) vload_half(0, P)
+#else
+#define VLOAD_HALF_JUMP(P, LEN) vload_half##LEN(0, P)
+#define VLOAD_HALF_JUMP_2(P, LEN) VLOAD_HALF_JUMP(P, LEN)
+#define POINT_VLOAD_CONT(P) VLOAD_HALF_JUMP_2(P, VEC_LEN)
+#endif
+
+#elif defined(POINT_BFLOAT16)
+// bfloat16 is the upper half of a float
+#define CL_POINT_STORE ushort
+#define POINT_ELEM(P, I) as_float((uint)(P)[I] << 16)
+#define AS_JUMP(TYPE, X) as_##TYPE(X)
+#define AS_JUMP_2(TYPE, X) AS_JUMP(TYPE, X)
+#define POINT_VLOAD_CONT(P)                                             \
+    AS_JUMP_2(VEC_TYPE(float), CONVERT_JUMP_2(VEC_TYPE(uint), VLOAD(P)) << 16)
+
+#elif defined(POINT_INT8)
+// 8-bit codes, dequantized with per-feature scale and offset in
+// g_quant[0 ... NUM_FEATURES-1] and g_quant[NUM_FEATURES ... ]
+#define CL_POINT_STORE uchar
+#define POINT_ELEM(P, I) convert_float((P)[I])
+#define POINT_VLOAD_CONT(P) CONVERT_JUMP_2(VEC_TYPE(float), VLOAD(P))
+#define POINT_DEQUANT(V, F) ((V) * g_quant[F] + g_quant[NUM_FEATURES + (F)])
+
+#else
+#define CL_POINT_STORE CL_POINT
+#define POINT_ELEM(P, I) (P)[I]
+#define POINT_VLOAD_CONT(P) VLOAD(P)
+#endif
+
+#ifndef POINT_DEQUANT
+#define POINT_DEQUANT(V, F) (V)
 #endif
 
 #define REP_STEP_2(BASE_STEP) BASE_STEP(0) BASE_STEP(1)
@@ -78,10 +146,29 @@ CL_INT ccoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
     return dim * col + row;
 }
 
+CL_INT rcoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
+    return dim * row + col;
+}
+
+// Global points and centroids indexing
+// Row major points are vector loaded by gathering features of
+// consecutive points
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#define POINT_VLOAD(P, F)                                               \
+    POINT_DEQUANT(VGATHER(&g_points[POINT_IND(P, F)], NUM_FEATURES), F)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#define POINT_VLOAD(P, F)                                               \
+    POINT_DEQUANT(POINT_VLOAD_CONT(&g_points[POINT_IND(P, F)]), F)
+#endif
+
 // Note: Define NUM_FEATURES with preprocessor
 __kernel
 void lloyd_fused_feature_sum(
-        __global CL_POINT const *const restrict g_points,
+        __global CL_POINT_STORE const *const restrict g_points,
         __constant CL_POINT const *const restrict g_old_centroids,
         __global CL_POINT *const restrict g_new_centroids,
         __global CL_MASS *const restrict g_masses,
@@ -95,18 +182,26 @@ void lloyd_fused_feature_sum(
         CL_INT const NUM_POINTS,
         CL_INT const NUM_CLUSTERS,
         CL_INT const NUM_THREAD_FEATURES
+#ifdef POINT_INT8
+        , __constant CL_POINT const *const restrict g_quant
+#endif
         )
 {
 
     // Calculate centroids indices
-    CL_INT const block_size = NUM_FEATURES / NUM_THREAD_FEATURES;
+    //
+    // If NUM_FEATURES is not a multiple of NUM_THREAD_FEATURES or the
+    // block size not a divisor of the local size, the remaining threads
+    // form no block and skip the centroids update phase
+    CL_INT const block_size =
+        (NUM_FEATURES + NUM_THREAD_FEATURES - 1) / NUM_THREAD_FEATURES;
     CL_INT const block =
         get_local_id(0) / block_size;
     CL_INT const num_local_points = get_local_size(0);
     CL_INT const num_blocks =
         get_local_size(0) / block_size;
     CL_INT const num_block_points =
-        num_local_points / num_blocks;
+        (num_local_points + num_blocks - 1) / num_blocks;
     CL_INT const block_points_offset = block * num_block_points;
     CL_INT const block_offset = NUM_CLUSTERS * NUM_FEATURES * block;
     CL_INT const l_feature = get_local_id(0) % block_size;
@@ -123,7 +218,7 @@ void lloyd_fused_feature_sum(
     // Zero new centroids in global memory
     for (
             CL_INT i = l_feature;
-            i < NUM_FEATURES * NUM_CLUSTERS;
+            block < num_blocks && i < NUM_FEATURES * NUM_CLUSTERS;
             i += block_size
         )
     {
@@ -197,7 +292,7 @@ void lloyd_fused_feature_sum(
             for (CL_INT f = 0; f < NUM_FEATURES; ++f) {
                 // Read point
                 VEC_TYPE(CL_POINT) point
-                    = VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                    = POINT_VLOAD(p, f);
 
                 // Cache point
                 l_points[
@@ -218,7 +313,7 @@ void lloyd_fused_feature_sum(
                     // Read point
                     VEC_TYPE(CL_POINT) point =
 #ifdef GLOBAL_MEM
-                        VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                        POINT_VLOAD(p, f);
 #else
                         l_points[
                         ccoord2ind(get_local_size(0), get_local_id(0), f)
@@ -228,7 +323,7 @@ void lloyd_fused_feature_sum(
                     // Calculate distance
                     VEC_TYPE(CL_POINT) difference
                         = point - g_old_centroids[
-                        ccoord2ind(NUM_CLUSTERS, c, f)
+                        CENTROID_IND(c, f)
                         ];
                     dist = fma(difference, difference, dist);
                 }
@@ -285,6 +380,10 @@ void lloyd_fused_feature_sum(
             )
             ? sub_sat(NUM_POINTS, (g_block_points_offset)) / VEC_LEN
             : num_block_points;
+        num_real_block_points = min(
+                num_real_block_points,
+                sub_sat(num_local_points, block_points_offset)
+                );
 
         // Centroids update phase
         for (
@@ -302,7 +401,7 @@ void lloyd_fused_feature_sum(
             {
                 VEC_TYPE(CL_POINT) point =
 #ifdef GLOBAL_MEM
-                    VLOAD(&g_points[ccoord2ind(NUM_POINTS, group_offset + bp, f)]);
+                    POINT_VLOAD(group_offset + bp, f);
 #else
                     l_points[
                     ccoord2ind(num_local_points, bp, f)
@@ -314,7 +413,7 @@ void lloyd_fused_feature_sum(
 #define CENTROID_UPDATE_BASE(NUM)                                        \
                 g_new_centroids[                                         \
                         tile_offset                                      \
-                        + ccoord2ind(NUM_CLUSTERS, label.s ## NUM, f)    \
+                        + CENTROID_IND(label.s ## NUM, f)                \
                 ] += point.s ## NUM;
 #else
 #define CENTROID_UPDATE_BASE(NUM)                                        \
@@ -329,7 +428,7 @@ void lloyd_fused_feature_sum(
 #else
 #ifdef GLOBAL_MEM
                 g_new_centroids[
-                    tile_offset + ccoord2ind(NUM_CLUSTERS, label, f)
+                    tile_offset + CENTROID_IND(label, f)
                 ] += point;
 #else
                 l_new_centroids[ccoord2ind(
@@ -355,7 +454,7 @@ void lloyd_fused_feature_sum(
         // Write back centroids
         for (
                 CL_INT f = l_feature;
-                f < NUM_FEATURES;
+                block < num_blocks && f < NUM_FEATURES;
                 f += block_size
             )
         {
@@ -365,7 +464,7 @@ void lloyd_fused_feature_sum(
                     c
                     )];
             g_new_centroids[
-                tile_offset + ccoord2ind(NUM_CLUSTERS, c, f)
+                tile_offset + CENTROID_IND(c, f)
             ] = centroid;
         }
     }
@@ -0,0 +1,348 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+// #define ROW_MAJOR
+// Default: column major points and centroids
+
+#ifndef CL_INT
+#define CL_INT uint
+#endif
+
+#ifndef CL_POINT
+#define CL_POINT float
+#endif
+
+#ifndef CL_LABEL
+#define CL_LABEL uint
+#endif
+
+#ifndef CL_POINT_MAX
+#define CL_POINT_MAX FLT_MAX
+#endif
+
+// Number of features per centroids tile in local memory
+#ifndef TILE_FEATURES
+#define TILE_FEATURES 256
+#endif
+
+// Number of clusters per centroids tile, and partial distances per thread
+#ifndef TILE_CLUSTERS
+#define TILE_CLUSTERS 8
+#endif
+
+CL_INT ccoord2ind(CL_INT rdim, CL_INT row, CL_INT col) {
+    return rdim * col + row;
+}
+
+CL_INT rcoord2ind(CL_INT cdim, CL_INT row, CL_INT col) {
+    return cdim * row + col;
+}
+
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#endif
+
+/*
+ * Label points with many features
+ *
+ * Centroids are streamed through local memory in tiles of
+ * TILE_CLUSTERS x TILE_FEATURES. Each thread labels one point and
+ * accumulates partial distances to the clusters of the current tile.
+ * Thus, neither a point nor all centroids need to fit into private,
+ * local or constant memory.
+ *
+ * All threads of a work group must participate in loading tiles, and
+ * therefore iterate equally often.
+ */
+__kernel
+void lloyd_labeling_tiled(
+        __global CL_POINT const *const restrict g_points,
+        __global CL_POINT const *const restrict g_centroids,
+        __global CL_LABEL *const restrict g_labels,
+        __local CL_POINT *const restrict l_centroids,
+        CL_INT const NUM_FEATURES,
+        CL_INT const NUM_POINTS,
+        CL_INT const NUM_CLUSTERS
+        )
+{
+    for (
+            CL_INT group_offset = get_group_id(0) * get_local_size(0);
+            group_offset < NUM_POINTS;
+            group_offset += get_global_size(0)
+        )
+    {
+        CL_INT const p = group_offset + get_local_id(0);
+        bool const is_point = p < NUM_POINTS;
+
+        CL_LABEL min_c = 0;
+        CL_POINT min_dist = CL_POINT_MAX;
+
+        for (
+                CL_INT cluster_offset = 0;
+                cluster_offset < NUM_CLUSTERS;
+                cluster_offset += TILE_CLUSTERS
+            )
+        {
+            CL_POINT dist[TILE_CLUSTERS];
+            for (CL_INT c = 0; c < TILE_CLUSTERS; ++c) {
+                dist[c] = 0;
+            }
+
+            for (
+                    CL_INT feature_offset = 0;
+                    feature_offset < NUM_FEATURES;
+                    feature_offset += TILE_FEATURES
+                )
+            {
+                // Wait until the previous tile is consumed
+                barrier(CLK_LOCAL_MEM_FENCE);
+
+                // Load centroids tile, zero-padded at the edges
+                for (
+                        CL_INT i = get_local_id(0);
+                        i < TILE_CLUSTERS * TILE_FEATURES;
+                        i += get_local_size(0)
+                    )
+                {
+#ifdef ROW_MAJOR
+                    CL_INT const c = i / TILE_FEATURES;
+                    CL_INT const f = i % TILE_FEATURES;
+#else
+                    CL_INT const c = i % TILE_CLUSTERS;
+                    CL_INT const f = i / TILE_CLUSTERS;
+#endif
+                    CL_INT const g_c = cluster_offset + c;
+                    CL_INT const g_f = feature_offset + f;
+
+                    l_centroids[ccoord2ind(TILE_FEATURES, f, c)] =
+                        (g_c < NUM_CLUSTERS && g_f < NUM_FEATURES)
+                        ? g_centroids[CENTROID_IND(g_c, g_f)]
+                        : 0;
+                }
+
+                barrier(CLK_LOCAL_MEM_FENCE);
+
+                if (is_point) {
+                    CL_INT const num_tile_features =
+                        min(
+                                (CL_INT) TILE_FEATURES,
+                                NUM_FEATURES - feature_offset
+                           );
+
+                    for (CL_INT f = 0; f < num_tile_features; ++f) {
+                        CL_POINT const point =
+                            g_points[POINT_IND(p, feature_offset + f)];
+
+                        for (CL_INT c = 0; c < TILE_CLUSTERS; ++c) {
+                            CL_POINT const difference = point
+                                - l_centroids[ccoord2ind(TILE_FEATURES, f, c)];
+                            dist[c] = fma(difference, difference, dist[c]);
+                        }
+                    }
+                }
+            }
+
+            CL_INT const num_tile_clusters =
+                min(
+                        (CL_INT) TILE_CLUSTERS,
+                        NUM_CLUSTERS - cluster_offset
+                   );
+
+            for (CL_INT c = 0; c < num_tile_clusters; ++c) {
+                if (isless(dist[c], min_dist)) {
+                    min_dist = dist[c];
+                    min_c = cluster_offset + c;
+                }
+            }
+        }
+
+        if (is_point) {
+            g_labels[p] = min_c;
+        }
+    }
+}
+
+/*
+ * Copy a tile of centroids into local memory, such that each feature's
+ * TILE_CLUSTERS centroids are contiguous
+ *
+ * Tiles are enumerated feature tile first, as in lloyd_labeling_tiled.
+ * Must be called by all threads of the work group.
+ */
+event_t async_load_tile(
+        __global CL_POINT const *const restrict g_centroids,
+        __local CL_POINT *const restrict l_tile,
+        CL_INT const tile,
+        CL_INT const num_feature_tiles,
+        CL_INT const NUM_FEATURES,
+        CL_INT const NUM_CLUSTERS
+        )
+{
+    CL_INT const cluster_offset =
+        (tile / num_feature_tiles) * TILE_CLUSTERS;
+    CL_INT const feature_offset =
+        (tile % num_feature_tiles) * TILE_FEATURES;
+    CL_INT const num_tile_clusters =
+        min((CL_INT) TILE_CLUSTERS, NUM_CLUSTERS - cluster_offset);
+    CL_INT const num_tile_features =
+        min((CL_INT) TILE_FEATURES, NUM_FEATURES - feature_offset);
+
+    event_t event = 0;
+    for (CL_INT f = 0; f < num_tile_features; ++f) {
+#ifdef ROW_MAJOR
+        event = async_work_group_strided_copy(
+                &l_tile[f * TILE_CLUSTERS],
+                &g_centroids[CENTROID_IND(cluster_offset, feature_offset + f)],
+                num_tile_clusters,
+                NUM_FEATURES,
+                event
+                );
+#else
+        event = async_work_group_copy(
+                &l_tile[f * TILE_CLUSTERS],
+                &g_centroids[CENTROID_IND(cluster_offset, feature_offset + f)],
+                num_tile_clusters,
+                event
+                );
+#endif
+    }
+
+    return event;
+}
+
+/*
+ * Label points with many clusters
+ *
+ * As lloyd_labeling_tiled, but centroid tiles are double-buffered in
+ * local memory. While the threads compare their points to one tile, the
+ * next tile is copied with async_work_group_copy. Thus, loading
+ * centroids overlaps with computing distances.
+ *
+ * l_centroids holds two tiles of TILE_CLUSTERS x TILE_FEATURES.
+ * Clusters beyond the last tile's edge hold stale values, and are
+ * ignored when selecting the nearest cluster.
+ */
+__kernel
+void lloyd_labeling_tiled_async(
+        __global CL_POINT const *const restrict g_points,
+        __global CL_POINT const *const restrict g_centroids,
+        __global CL_LABEL *const restrict g_labels,
+        __local CL_POINT *const restrict l_centroids,
+        CL_INT const NUM_FEATURES,
+        CL_INT const NUM_POINTS,
+        CL_INT const NUM_CLUSTERS
+        )
+{
+    CL_INT const tile_size = TILE_CLUSTERS * TILE_FEATURES;
+    CL_INT const num_feature_tiles =
+        (NUM_FEATURES + TILE_FEATURES - 1) / TILE_FEATURES;
+    CL_INT const num_cluster_tiles =
+        (NUM_CLUSTERS + TILE_CLUSTERS - 1) / TILE_CLUSTERS;
+    CL_INT const num_tiles = num_feature_tiles * num_cluster_tiles;
+
+    for (
+            CL_INT group_offset = get_group_id(0) * get_local_size(0);
+            group_offset < NUM_POINTS;
+            group_offset += get_global_size(0)
+        )
+    {
+        CL_INT const p = group_offset + get_local_id(0);
+        bool const is_point = p < NUM_POINTS;
+
+        CL_LABEL min_c = 0;
+        CL_POINT min_dist = CL_POINT_MAX;
+        CL_POINT dist[TILE_CLUSTERS];
+
+        // Wait until the previous points' last tile is consumed
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        event_t tile_event = async_load_tile(
+                g_centroids,
+                l_centroids,
+                0,
+                num_feature_tiles,
+                NUM_FEATURES,
+                NUM_CLUSTERS
+                );
+
+        for (CL_INT t = 0; t < num_tiles; ++t) {
+            CL_INT const cluster_offset =
+                (t / num_feature_tiles) * TILE_CLUSTERS;
+            CL_INT const feature_offset =
+                (t % num_feature_tiles) * TILE_FEATURES;
+            __local CL_POINT const *const l_tile =
+                &l_centroids[(t % 2) * tile_size];
+
+            wait_group_events(1, &tile_event);
+
+            // Tile t is complete, and tile t - 1 is consumed
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            if (t + 1 < num_tiles) {
+                tile_event = async_load_tile(
+                        g_centroids,
+                        &l_centroids[((t + 1) % 2) * tile_size],
+                        t + 1,
+                        num_feature_tiles,
+                        NUM_FEATURES,
+                        NUM_CLUSTERS
+                        );
+            }
+
+            if (feature_offset == 0) {
+                for (CL_INT c = 0; c < TILE_CLUSTERS; ++c) {
+                    dist[c] = 0;
+                }
+            }
+
+            if (is_point) {
+                CL_INT const num_tile_features =
+                    min(
+                            (CL_INT) TILE_FEATURES,
+                            NUM_FEATURES - feature_offset
+                       );
+
+                for (CL_INT f = 0; f < num_tile_features; ++f) {
+                    CL_POINT const point =
+                        g_points[POINT_IND(p, feature_offset + f)];
+
+                    for (CL_INT c = 0; c < TILE_CLUSTERS; ++c) {
+                        CL_POINT const difference = point
+                            - l_tile[f * TILE_CLUSTERS + c];
+                        dist[c] = fma(difference, difference, dist[c]);
+                    }
+                }
+            }
+
+            // Distances are complete after the last feature tile
+            if (feature_offset + TILE_FEATURES >= NUM_FEATURES) {
+                CL_INT const num_tile_clusters =
+                    min(
+                            (CL_INT) TILE_CLUSTERS,
+                            NUM_CLUSTERS - cluster_offset
+                       );
+
+                for (CL_INT c = 0; c < num_tile_clusters; ++c) {
+                    if (isless(dist[c], min_dist)) {
+                        min_dist = dist[c];
+                        min_c = cluster_offset + c;
+                    }
+                }
+            }
+        }
+
+        if (is_point) {
+            g_labels[p] = min_c;
+        }
+    }
+}
@@ -12,6 +12,9 @@
 //
 // #define GLOBAL_MEM
 // Default: local memory cache
+//
+// #define ROW_MAJOR
+// Default: column major points and centroids
 
 #ifndef CL_INT
 #define CL_INT uint
@@ -42,6 +45,7 @@
 #define VEC_TYPE(TYPE) TYPE
 #define VLOAD(P) (*(P))
 #define VSTORE(DATA, P) do { *(P) = DATA; } while (false)
+#define VGATHER(P, S) (*(P))
 
 #else
 #define VEC_TYPE_JUMP(TYPE, LEN) TYPE##LEN
@@ -55,6 +59,22 @@
 #define VSTORE_JUMP(DATA, P, LEN) vstore##LEN(DATA, 0, P)
 #define VSTORE_JUMP_2(DATA, P, LEN) VSTORE_JUMP(DATA, P, LEN)
 #define VSTORE(DATA, P) VSTORE_JUMP_2(DATA, P, VEC_LEN)
+
+// Gather vector from elements that are S apart
+#define VGATHER_2(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 2))((P)[0], (P)[S]))
+#define VGATHER_4(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 4))(                                    \
+        VGATHER_2(P, S), VGATHER_2((P) + 2 * (S), S)))
+#define VGATHER_8(P, S)                                                 \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 8))(                                    \
+        VGATHER_4(P, S), VGATHER_4((P) + 4 * (S), S)))
+#define VGATHER_16(P, S)                                                \
+    ((VEC_TYPE_JUMP_2(CL_POINT, 16))(                                   \
+        VGATHER_8(P, S), VGATHER_8((P) + 8 * (S), S)))
+#define VGATHER_JUMP(P, S, LEN) VGATHER_ ## LEN(P, S)
+#define VGATHER_JUMP_2(P, S, LEN) VGATHER_JUMP(P, S, LEN)
+#define VGATHER(P, S) VGATHER_JUMP_2(P, S, VEC_LEN)
 #endif
 
 CL_INT ccoord2ind(CL_INT rdim, CL_INT row, CL_INT col) {
@@ -65,6 +85,19 @@ CL_INT rcoord2ind(CL_INT cdim, CL_INT row, CL_INT col) {
     return cdim * row + col;
 }
 
+// Global points and centroids indexing
+// Row major points are vector loaded by gathering features of
+// consecutive points
+#ifdef ROW_MAJOR
+#define POINT_IND(P, F) rcoord2ind(NUM_FEATURES, P, F)
+#define CENTROID_IND(C, F) rcoord2ind(NUM_FEATURES, C, F)
+#define POINT_VLOAD(P, F) VGATHER(&g_points[POINT_IND(P, F)], NUM_FEATURES)
+#else
+#define POINT_IND(P, F) ccoord2ind(NUM_POINTS, P, F)
+#define CENTROID_IND(C, F) ccoord2ind(NUM_CLUSTERS, C, F)
+#define POINT_VLOAD(P, F) VLOAD(&g_points[POINT_IND(P, F)])
+#endif
+
 // Note: Define NUM_FEATURES with preprocessor
 __kernel
 void lloyd_labeling_vp_clcp(
@@ -110,7 +143,7 @@ void lloyd_labeling_vp_clcp(
         // Cache points in local memory
         for (CL_INT f = 0; f < NUM_FEATURES; ++f) {
             VEC_TYPE(CL_POINT) point =
-                VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                POINT_VLOAD(p, f);
 
             l_points[ccoord2ind(
                     get_local_size(0),
@@ -130,7 +163,7 @@ void lloyd_labeling_vp_clcp(
 
                 VEC_TYPE(CL_POINT) point =
 #ifdef GLOBAL_MEM
-                    VLOAD(&g_points[ccoord2ind(NUM_POINTS, p, f)]);
+                    POINT_VLOAD(p, f);
 #else
                     l_points[ccoord2ind(
                             get_local_size(0),
@@ -140,7 +173,7 @@ void lloyd_labeling_vp_clcp(
 #endif
 
                 VEC_TYPE(CL_POINT) difference =
-                    point - g_centroids[ccoord2ind(NUM_CLUSTERS, c, f)];
+                    point - g_centroids[CENTROID_IND(c, f)];
 
                 dist = fma(difference, difference, dist);
             }
@@ -11,6 +11,7 @@
 #define MASS_UPDATE_GLOBAL_ATOMIC_HPP
 
 #include "kernel_path.hpp"
+#include "specialized_kernels.hpp"
 
 #include "../mass_update_configuration.hpp"
 #include "../measurement/measurement.hpp"
@@ -58,30 +59,8 @@ public:
             assert(false);
         }
 
-        Program gs_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            gs_program.build(defines);
-            this->global_stride_kernel = gs_program.create_kernel(KERNEL_NAME);
-        }
-        catch (std::exception e) {
-          std::cerr << gs_program.build_log() << std::endl;
-          throw e;
-        }
-
-        defines += " -DLOCAL_STRIDE";
-        Program ls_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            ls_program.build(defines);
-            this->local_stride_kernel = ls_program.create_kernel(KERNEL_NAME);
-        }
-        catch (std::exception e) {
-          std::cerr << ls_program.build_log() << std::endl;
-          throw e;
-        }
+        // Kernels are compiled on first use of their variant
+        this->kernels.prepare(context, PROGRAM_FILE, KERNEL_NAME, defines);
     }
 
     Event operator() (
@@ -127,13 +106,15 @@ public:
         datapoint.set_name("MassUpdateGlobalAtomic");
 
         boost::compute::device device = queue.get_device();
-        Kernel& kernel = (
-                device.type() == device.cpu ||
-                device.type() == device.accelerator
+        Kernel& kernel = this->kernels.get(
+                (
+                    device.type() == device.cpu ||
+                    device.type() == device.accelerator
                 )
-            ? this->local_stride_kernel
-            : this->global_stride_kernel
-            ;
+                ? SpecializedKernels::LocalStrideLocalMem
+                : SpecializedKernels::GlobalStrideLocalMem,
+                datapoint
+                );
 
         kernel.set_args(
                 labels_begin.get_buffer(),
@@ -159,8 +140,7 @@ private:
     static constexpr const char* PROGRAM_FILE = CL_KERNEL_FILE_PATH("histogram_global.cl");
     static constexpr const char* KERNEL_NAME = "histogram_global";
 
-    Kernel global_stride_kernel;
-    Kernel local_stride_kernel;
+    SpecializedKernels kernels;
     MassUpdateConfiguration config;
 };
 
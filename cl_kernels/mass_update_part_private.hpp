@@ -11,6 +11,7 @@
 #define MASS_UPDATE_PART_PRIVATE_HPP
 
 #include "kernel_path.hpp"
+#include "specialized_kernels.hpp"
 
 #include "reduce_vector_parcol.hpp"
 #include "matrix_binary_op.hpp"
@@ -66,47 +67,8 @@ public:
         defines += " -DVEC_LEN=";
         defines += std::to_string(this->config.vector_length);
 
-        std::string l_stride_defines = " -DLOCAL_STRIDE";
-        std::string g_mem_defines = " -DGLOBAL_MEM";
-
-        Program g_stride_g_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            g_stride_g_mem_program.build(defines + g_mem_defines);
-            g_stride_g_mem_kernel =
-                g_stride_g_mem_program.create_kernel(KERNEL_NAME);
-        }
-        catch (std::exception e) {
-            std::cerr << g_stride_g_mem_program.build_log() << std::endl;
-            throw e;
-        }
-
-        Program g_stride_l_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            g_stride_l_mem_program.build(defines);
-            g_stride_l_mem_kernel =
-                g_stride_l_mem_program.create_kernel(KERNEL_NAME);
-        }
-        catch (std::exception e) {
-            std::cerr << g_stride_l_mem_program.build_log() << std::endl;
-            throw e;
-        }
-
-        Program l_stride_g_mem_program = Program::create_with_source_file(
-                PROGRAM_FILE,
-                context);
-        try {
-            l_stride_g_mem_program.build(defines + l_stride_defines + g_mem_defines);
-            l_stride_g_mem_kernel =
-                l_stride_g_mem_program.create_kernel(KERNEL_NAME);
-        }
-        catch (std::exception e) {
-            std::cerr << l_stride_g_mem_program.build_log() << std::endl;
-            throw e;
-        }
+        // Kernels are compiled on first use of their variant
+        this->kernels.prepare(context, PROGRAM_FILE, KERNEL_NAME, defines);
 
         reduce.prepare(context);
         matrix_add.prepare(context, matrix_add.Add);
@@ -186,12 +148,14 @@ public:
             device.type() == device.gpu &&
             device.local_memory_size() > local_masses_size * sizeof(MassT)
             ;
-        auto& kernel = (use_local_stride)
-            ? l_stride_g_mem_kernel
-            : (use_local_memory)
-            ? g_stride_l_mem_kernel
-            : g_stride_g_mem_kernel
-            ;
+        Kernel& kernel = this->kernels.get(
+                (use_local_stride)
+                ? SpecializedKernels::LocalStrideGlobalMem
+                : (use_local_memory)
+                ? SpecializedKernels::GlobalStrideLocalMem
+                : SpecializedKernels::GlobalStrideGlobalMem,
+                datapoint
+                );
 
         if (use_local_memory) {
             kernel.set_args(
@@ -252,9 +216,7 @@ private:
     static constexpr const char* PROGRAM_FILE = CL_KERNEL_FILE_PATH("histogram_part_private.cl");
     static constexpr const char* KERNEL_NAME = "histogram_part_private";
 
-    Kernel g_stride_g_mem_kernel;
-    Kernel g_stride_l_mem_kernel;
-    Kernel l_stride_g_mem_kernel;
+    SpecializedKernels kernels;
     Vector<MassT> tmp_masses;
     LocalBuffer<MassT> local_masses;
     MassUpdateConfiguration config;
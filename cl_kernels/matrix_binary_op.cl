@@ -10,6 +10,11 @@
 CL_INT ccoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
     return dim * col + row;
 }
+
+CL_INT rcoord2ind(CL_INT dim, CL_INT row, CL_INT col) {
+    return dim * row + col;
+}
+
 __kernel
 void matrix_scalar(
         __global CL_TYPE_1 *const restrict matrix,
@@ -28,10 +33,17 @@ void matrix_row_vector(
         CL_INT const NUM_ROWS
         )
 {
+#ifdef ROW_MAJOR
+    CL_INT m_ind = rcoord2ind(
+            NUM_COLS,
+            get_global_id(0),
+            get_global_id(1));
+#else
     CL_INT m_ind = ccoord2ind(
             NUM_ROWS,
             get_global_id(0),
             get_global_id(1));
+#endif
 
     CL_TYPE_2 v = vector[get_global_id(0)];
 
@@ -11,6 +11,7 @@
 #define MATRIX_BINARY_OP_HPP
 
 #include "kernel_path.hpp"
+#include "program_cache.hpp"
 
 #include "../measurement/measurement.hpp"
 
@@ -24,7 +25,11 @@
 
 namespace Clustering {
 
-template <typename T1, typename T2>
+/*
+ * ColMajor selects the matrix layout of row(). Other operations are
+ * independent of the layout.
+ */
+template <typename T1, typename T2, bool ColMajor = true>
 class MatrixBinaryOp {
 public:
     enum BinaryOp { Add, Subtract, Multiply, Divide };
@@ -50,12 +55,14 @@ public:
         defines += boost::compute::type_name<T2>();
         defines += " -DBINARY_OP=";
         defines += op_to_str(op);
+        if (not ColMajor) {
+            defines += " -DROW_MAJOR";
+        }
 
-        Program program = Program::create_with_source_file(
+        Program program = ProgramCache::build(
+                context,
                 PROGRAM_FILE,
-                context);
-
-        program.build(defines);
+                defines);
 
         this->scalar_kernel = program.create_kernel(SCALAR_KERNEL_NAME);
         this->row_kernel = program.create_kernel(ROW_KERNEL_NAME);
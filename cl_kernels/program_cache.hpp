@@ -0,0 +1,228 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/compute/core.hpp>
+#include <boost/filesystem.hpp>
+
+namespace Clustering {
+
+/*
+ * Persistent cache of OpenCL program binaries
+ *
+ * Programs are stored by a hash of their source, build options, device
+ * and driver version. Thus, a changed kernel or driver update results in
+ * a rebuild, and subsequent runs skip compilation.
+ *
+ * The cache directory is $CL_KMEANS_CACHE_DIR, or otherwise
+ * $XDG_CACHE_HOME/cl-kmeans or $HOME/.cache/cl-kmeans.
+ * Set CL_KMEANS_CACHE_DIR to an empty string to disable the cache.
+ */
+class ProgramCache {
+public:
+    using Context = boost::compute::context;
+    using Device = boost::compute::device;
+    using Program = boost::compute::program;
+
+    /*
+     * Build program from source file with options, or load a binary
+     * previously built for the same source, options and device.
+     *
+     * Prints the build log on failure and rethrows the build error.
+     */
+    static Program build(
+            Context context,
+            std::string const& program_file,
+            std::string const& options
+            )
+    {
+        std::vector<unsigned char> source_bytes = read_file(program_file);
+        std::string source(source_bytes.begin(), source_bytes.end());
+
+        boost::filesystem::path cache_file;
+        if (context.get_devices().size() == 1) {
+            boost::filesystem::path dir = directory();
+            if (not dir.empty()) {
+                cache_file = dir / (
+                        key(source, options, context.get_device())
+                        + ".bin"
+                        );
+            }
+        }
+
+        if (not cache_file.empty()) {
+            std::vector<unsigned char> binary = read_file(cache_file);
+            if (not binary.empty()) {
+                try {
+                    Program program =
+                        Program::create_with_binary(binary, context);
+                    program.build(options);
+                    return program;
+                }
+                catch (std::exception const&) {
+                    // Binary is stale or corrupt, rebuild from source
+                }
+            }
+        }
+
+        Program program = Program::create_with_source(source, context);
+        try {
+            program.build(options);
+        }
+        catch (std::exception e) {
+            std::cerr << program.build_log() << std::endl;
+            throw e;
+        }
+
+        if (not cache_file.empty()) {
+            write_file(cache_file, program.binary());
+        }
+
+        return program;
+    }
+
+    /*
+     * Cache directory, or empty path if disabled
+     */
+    static boost::filesystem::path directory() {
+        char const *cache_dir = std::getenv("CL_KMEANS_CACHE_DIR");
+        if (cache_dir) {
+            return boost::filesystem::path(cache_dir);
+        }
+
+        char const *xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+        if (xdg_cache_home && *xdg_cache_home) {
+            return boost::filesystem::path(xdg_cache_home) / "cl-kmeans";
+        }
+
+        char const *home = std::getenv("HOME");
+        if (home && *home) {
+            return boost::filesystem::path(home) / ".cache" / "cl-kmeans";
+        }
+
+        return boost::filesystem::path();
+    }
+
+private:
+    /*
+     * 64-bit FNV-1a hash, which is stable across runs and platforms
+     * in contrast to std::hash
+     */
+    static uint64_t hash(std::string const& data, uint64_t h) {
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static std::string key(
+            std::string const& source,
+            std::string const& options,
+            Device device
+            )
+    {
+        uint64_t h = 14695981039346656037ull;
+        // Separate fields such that their concatenation is unambiguous
+        for (std::string const& field : {
+                source,
+                options,
+                device.platform().name(),
+                device.platform().version(),
+                device.name(),
+                device.version(),
+                device.driver_version()
+                })
+        {
+            h = hash(field, h);
+            h = hash(std::string(1, '\0'), h);
+        }
+
+        std::ostringstream ss;
+        ss << std::hex << h;
+        return ss.str();
+    }
+
+    static std::vector<unsigned char> read_file(
+            boost::filesystem::path const& path
+            )
+    {
+        std::ifstream file(path.string(), std::ios::binary);
+        if (not file) {
+            return std::vector<unsigned char>();
+        }
+
+        return std::vector<unsigned char>(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>()
+                );
+    }
+
+    /*
+     * Write binary to a temporary file and move it into place, such that
+     * concurrent processes never read partial binaries.
+     *
+     * Failures leave the cache untouched, as the cache is optional.
+     */
+    static void write_file(
+            boost::filesystem::path const& path,
+            std::vector<unsigned char> const& binary
+            )
+    {
+        if (binary.empty()) {
+            return;
+        }
+
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(path.parent_path(), ec);
+        if (ec) {
+            return;
+        }
+
+        boost::filesystem::path tmp_path = path;
+        tmp_path += "." + std::to_string(getpid()) + ".tmp";
+
+        {
+            std::ofstream file(tmp_path.string(), std::ios::binary);
+            file.write(
+                    reinterpret_cast<char const *>(binary.data()),
+                    binary.size()
+                    );
+            if (not file) {
+                file.close();
+                boost::filesystem::remove(tmp_path, ec);
+                return;
+            }
+        }
+
+        boost::filesystem::rename(tmp_path, path, ec);
+        if (ec) {
+            boost::filesystem::remove(tmp_path, ec);
+        }
+    }
+};
+
+}
+
+#endif /* PROGRAM_CACHE_HPP */
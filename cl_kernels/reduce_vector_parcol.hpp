@@ -11,8 +11,10 @@
 #define REDUCE_VECTOR_PARCOL_HPP
 
 #include "kernel_path.hpp"
+#include "program_cache.hpp"
 
 #include "../measurement/measurement.hpp"
+#include "../utility.hpp"
 
 #include <cassert>
 #include <string>
@@ -49,11 +51,10 @@ public:
         defines += " -DWORKGROUP_SIZE=";
         defines += std::to_string(WORKGROUP_SIZE);
 
-        Program program = Program::create_with_source_file(
+        Program program = ProgramCache::build(
+                context,
                 PROGRAM_FILE,
-                context);
-
-        program.build(defines);
+                defines);
 
         this->kernel_compact = program
             .create_kernel(COMPACT_KERNEL_NAME);
@@ -101,6 +102,39 @@ public:
         boost::compute::wait_list wait_list = events;
         size_t work_offset = 0;
         uint32_t round = 0;
+
+        // Sizes that are not powers of two, e.g. due to an odd number of
+        // features or clusters, are halved column-wise down to one column
+        if (
+                not Utility::is_power_of_two(data_size)
+                || not Utility::is_power_of_two(result_rows)
+           )
+        {
+            size_t cols = num_cols;
+            while (cols > 1) {
+                size_t const half_cols = (cols + 1) / 2;
+
+                this->kernel_compact.set_args(
+                        data_begin.get_buffer(),
+                        (cl_uint) (cols * result_rows));
+
+                event = queue.enqueue_1d_range_kernel(
+                        this->kernel_compact,
+                        work_offset,
+                        half_cols * result_rows,
+                        0,
+                        wait_list);
+                datapoint.add_event() = event;
+
+                wait_list.clear();
+                wait_list.insert(event);
+
+                cols = half_cols;
+            }
+
+            return event;
+        }
+
         size_t global_size = data_size / 2;
 
         while (
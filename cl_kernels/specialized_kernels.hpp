@@ -0,0 +1,171 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef SPECIALIZED_KERNELS_HPP
+#define SPECIALIZED_KERNELS_HPP
+
+#include "program_cache.hpp"
+#include "../measurement/measurement.hpp"
+#include "../timer.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <boost/compute/core.hpp>
+
+namespace Clustering {
+
+/*
+ * Kernels of a program in each stride and memory variant, optionally
+ * specialized with -DNUM_FEATURES for the actual number of features.
+ *
+ * Each kernel is compiled on first use of its variant and feature count,
+ * such that a run only compiles the kernels it actually launches, and
+ * any feature count runs at its exact size instead of being padded to
+ * the next power of two.
+ *
+ * Copies share compiled kernels, as strategies are copied into
+ * std::function objects by the pipelines.
+ *
+ * As the first launch happens inside the pipeline's timed loop, the
+ * compile time is recorded as a "Compile" child of the launching
+ * strategy's data point, such that it can be told apart from the
+ * clustering time.
+ */
+class SpecializedKernels {
+public:
+    using Context = boost::compute::context;
+    using Kernel = boost::compute::kernel;
+    using Program = boost::compute::program;
+
+    enum Variant {
+        GlobalStrideGlobalMem = 0,
+        GlobalStrideLocalMem = 1,
+        LocalStrideGlobalMem = 2,
+        LocalStrideLocalMem = 3
+    };
+
+    SpecializedKernels() :
+        cache(std::make_shared<Cache>())
+    {}
+
+    /*
+     * Set program and common build options. Clears compiled kernels.
+     */
+    void prepare(
+            Context context,
+            char const *program_file,
+            char const *kernel_name,
+            std::string defines
+            )
+    {
+        this->context = context;
+        this->program_file = program_file;
+        this->kernel_name = kernel_name;
+        this->defines = defines;
+        this->cache = std::make_shared<Cache>();
+    }
+
+    /*
+     * Get kernel of variant specialized for num_features.
+     * Compiles the kernel on first use.
+     */
+    Kernel& get(
+            size_t num_features,
+            Variant variant,
+            Measurement::DataPoint& datapoint
+            )
+    {
+        assert(num_features > 0);
+        return this->get_or_build(num_features, variant, datapoint);
+    }
+
+    /*
+     * Get kernel of variant for programs that take the number of
+     * features as a kernel argument. Compiles the kernel on first use.
+     */
+    Kernel& get(Variant variant, Measurement::DataPoint& datapoint) {
+        return this->get_or_build(0, variant, datapoint);
+    }
+
+private:
+    struct Cache {
+        std::mutex mutex;
+        std::map<std::pair<size_t, Variant>, Kernel> kernels;
+    };
+
+    Kernel& get_or_build(
+            size_t num_features,
+            Variant variant,
+            Measurement::DataPoint& datapoint
+            )
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+
+        auto key = std::make_pair(num_features, variant);
+        auto found = cache->kernels.find(key);
+        if (found == cache->kernels.end()) {
+            Timer::Timer compile_timer;
+            compile_timer.start();
+            found = cache->kernels.emplace(
+                    key,
+                    build(num_features, variant)
+                    ).first;
+            datapoint.create_child()
+                .set_name("Compile")
+                .add_value() = compile_timer
+                .stop<std::chrono::nanoseconds>();
+        }
+
+        return found->second;
+    }
+
+    static std::string variant_defines(Variant variant) {
+        switch (variant) {
+        case GlobalStrideGlobalMem:
+            return " -DGLOBAL_MEM";
+        case LocalStrideGlobalMem:
+            return " -DLOCAL_STRIDE -DGLOBAL_MEM";
+        case LocalStrideLocalMem:
+            return " -DLOCAL_STRIDE";
+        default:
+            return "";
+        }
+    }
+
+    Kernel build(size_t num_features, Variant variant) const {
+        std::string options = defines + variant_defines(variant);
+        if (num_features > 0) {
+            options += " -DNUM_FEATURES=" + std::to_string(num_features);
+        }
+
+        Program program = ProgramCache::build(
+                context,
+                program_file,
+                options
+                );
+
+        return program.create_kernel(kernel_name);
+    }
+
+    Context context;
+    std::string program_file;
+    std::string kernel_name;
+    std::string defines;
+    std::shared_ptr<Cache> cache;
+};
+
+}
+
+#endif /* SPECIALIZED_KERNELS_HPP */
@@ -8,11 +8,79 @@
  */
 
 #include "cluster_generator.hpp"
+#include "point_storage.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
 #include <random>
 #include <fstream>
 #include <cassert>
+#include <thread>
+
+namespace {
+    // Bytes generated by a thread at once
+    constexpr uint64_t slice_bytes = 8 * 1024 * 1024;
+
+    enum Stream : uint32_t {
+        PointStream = 0,
+        CentroidStream = 1,
+        ScaleStream = 2,
+        AnisotropyStream = 3,
+        NoiseStream = 4,
+        OutlierStream = 5,
+        EmbeddingStream = 6,
+        LatentStream = 7
+    };
+
+    /*
+     * Philox4x32-10 counter-based RNG (Salmon et al., SC'11).
+     * Returns four random words for each (key, counter) pair, without
+     * any state shared between draws.
+     */
+    struct Philox {
+        using Result = std::array<uint32_t, 4>;
+
+        static Result generate(uint64_t seed, uint64_t index, uint32_t stream) {
+            Result ctr = {{
+                (uint32_t) index,
+                (uint32_t) (index >> 32),
+                stream,
+                0
+            }};
+            uint32_t key[2] = {(uint32_t) seed, (uint32_t) (seed >> 32)};
+
+            for (int r = 0; r < 10; ++r) {
+                uint64_t const p0 = (uint64_t) 0xD2511F53u * ctr[0];
+                uint64_t const p1 = (uint64_t) 0xCD9E8D57u * ctr[2];
+                ctr = {{
+                    (uint32_t) (p1 >> 32) ^ ctr[1] ^ key[0],
+                    (uint32_t) p1,
+                    (uint32_t) (p0 >> 32) ^ ctr[3] ^ key[1],
+                    (uint32_t) p0
+                }};
+                key[0] += 0x9E3779B9u;
+                key[1] += 0xBB67AE85u;
+            }
+
+            return ctr;
+        }
+
+        // Uniform in [0, 1)
+        static float uniform(Result const& r) {
+            return (float) (r[0] * (1.0 / 4294967296.0));
+        }
+
+        // Standard normal with Box-Muller transform
+        static float gaussian(Result const& r) {
+            double const u1 = (r[0] + 0.5) * (1.0 / 4294967296.0);
+            double const u2 = r[1] * (1.0 / 4294967296.0);
+            return (float) (std::sqrt(-2.0 * std::log(u1))
+                    * std::cos(6.283185307179586 * u2));
+        }
+    };
+}
 
 void cle::ClusterGenerator::num_features(uint64_t features) {
     features_ = features;
@@ -39,6 +107,42 @@ void cle::ClusterGenerator::point_multiple(uint64_t multiple) {
     multiple_ = multiple;
 }
 
+void cle::ClusterGenerator::chunk_size(uint64_t bytes) {
+    chunk_size_ = bytes;
+}
+
+void cle::ClusterGenerator::data_type(Clustering::BinaryFormat::DataType dtype) {
+    dtype_ = dtype;
+}
+
+void cle::ClusterGenerator::num_threads(uint32_t threads) {
+    num_threads_ = threads;
+}
+
+void cle::ClusterGenerator::seed(uint64_t seed) {
+    seed_ = seed;
+}
+
+void cle::ClusterGenerator::zipf_exponent(float exponent) {
+    zipf_exponent_ = exponent;
+}
+
+void cle::ClusterGenerator::radius_spread(float spread) {
+    radius_spread_ = spread;
+}
+
+void cle::ClusterGenerator::anisotropy(float anisotropy) {
+    anisotropy_ = anisotropy;
+}
+
+void cle::ClusterGenerator::noise_fraction(float fraction) {
+    noise_fraction_ = fraction;
+}
+
+void cle::ClusterGenerator::intrinsic_dims(uint64_t dims) {
+    intrinsic_dims_ = dims;
+}
+
 /*
  * Generate binary file
  * File format:
@@ -144,6 +248,435 @@ void cle::ClusterGenerator::generate_csv(char const* file_name) {
     }
 }
 
+/*
+ * Generate version 2 binary file, see BinaryFormat for the format.
+ *
+ * Points are written in Partitioned layout with chunk_size rounded down
+ * to whole points, or in ColMajor layout if chunk_size is 0. Includes
+ * ground-truth centroids and labels.
+ *
+ * The workload shape is set by zipf_exponent, radius_spread,
+ * anisotropy, noise_fraction and intrinsic_dims.
+ *
+ * Each value is drawn from a counter-based RNG keyed by the seed and
+ * its column-major position, so that chunks are generated in parallel
+ * and streamed to the file as they are produced. The output only
+ * depends on the seed, not on the number of threads or the layout.
+ */
+void cle::ClusterGenerator::generate_bin(char const* file_name) {
+
+    using BinaryFormat = Clustering::BinaryFormat;
+
+    uint64_t size = bytes_ / sizeof(float);
+    uint64_t num_points = size / features_;
+    uint64_t points_per_cluster = num_points / clusters_;
+    num_points = points_per_cluster * clusters_;
+    uint64_t remainder = num_points % multiple_;
+    num_points = num_points - remainder;
+
+    Model const model = build_model(num_points, remainder);
+
+    uint64_t const point_bytes =
+        features_ * BinaryFormat::dtype_size(dtype_);
+    uint64_t const chunk_size = chunk_size_ / point_bytes * point_bytes;
+    assert(chunk_size_ == 0 || chunk_size > 0);
+
+    BinaryFormat::Header header = BinaryFormat::make_header(
+            dtype_,
+            (chunk_size == 0)
+            ? BinaryFormat::Layout::ColMajor
+            : BinaryFormat::Layout::Partitioned,
+            features_,
+            num_points,
+            clusters_,
+            chunk_size,
+            BinaryFormat::HasCentroids | BinaryFormat::HasLabels
+            );
+    std::vector<BinaryFormat::ChunkInfo> chunks =
+        BinaryFormat::make_chunk_index(header);
+
+    std::ofstream fh(file_name, std::fstream::binary | std::fstream::trunc);
+
+    fh.write((char*)&header, sizeof(header));
+
+    fh.seekp(header.labels_offset);
+    {
+        std::vector<uint32_t> labels;
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            uint64_t p = model.cluster_offsets[c];
+            while (p < model.cluster_offsets[c + 1]) {
+                uint64_t n = std::min(
+                        slice_bytes / sizeof(uint32_t),
+                        model.cluster_offsets[c + 1] - p
+                        );
+                labels.assign(n, c);
+                if (noise_fraction_ > 0.0f) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        if (is_noise(p + i)) {
+                            labels[i] = clusters_;
+                        }
+                    }
+                }
+                fh.write((char*)labels.data(), n * sizeof(uint32_t));
+                p += n;
+            }
+        }
+    }
+
+    if (dtype_ == BinaryFormat::DataType::Float64) {
+        write_points<double>(fh, header, chunks, model);
+    }
+    else if (dtype_ == BinaryFormat::DataType::Float16) {
+        write_points<Clustering::Half>(fh, header, chunks, model);
+    }
+    else if (dtype_ == BinaryFormat::DataType::BFloat16) {
+        write_points<Clustering::BFloat16>(fh, header, chunks, model);
+    }
+    else {
+        write_points<float>(fh, header, chunks, model);
+    }
+
+    // Chunk index contains checksums, write last
+    fh.seekp(header.chunk_index_offset);
+    fh.write((char*)chunks.data(), chunks.size() * sizeof(chunks[0]));
+}
+
+template <typename T>
+void cle::ClusterGenerator::write_points(
+        std::ofstream& fh,
+        Clustering::BinaryFormat::Header const& header,
+        std::vector<Clustering::BinaryFormat::ChunkInfo>& chunks,
+        Model const& model
+        ) {
+
+    using BinaryFormat = Clustering::BinaryFormat;
+
+    std::vector<T> typed_centroids(
+            model.centroids.begin(),
+            model.centroids.end()
+            );
+    fh.seekp(header.centroids_offset);
+    fh.write(
+            (char*)typed_centroids.data(),
+            typed_centroids.size() * sizeof(T)
+            );
+
+    // Split chunks into slices, the unit of work of a thread
+    struct Slice {
+        uint64_t chunk;
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<Slice> slices;
+    uint64_t const slice_elements = slice_bytes / sizeof(T);
+    for (uint64_t c = 0; c < chunks.size(); ++c) {
+        uint64_t const chunk_elements = chunks[c].length / sizeof(T);
+        for (uint64_t e = 0; e < chunk_elements; e += slice_elements) {
+            slices.push_back({
+                    c,
+                    e,
+                    std::min(e + slice_elements, chunk_elements)
+                    });
+        }
+    }
+
+    size_t const threads = (num_threads_ != 0)
+        ? num_threads_
+        : std::max(1u, std::thread::hardware_concurrency())
+        ;
+
+    // Generate a batch of slices while writing the previous batch
+    std::vector<std::vector<T>> buffers[2];
+    buffers[0].resize(threads);
+    buffers[1].resize(threads);
+
+    auto write_batch = [&](uint64_t first_slice, size_t set) {
+        for (size_t t = 0;
+                t < threads and first_slice + t < slices.size();
+                ++t)
+        {
+            Slice const& slice = slices[first_slice + t];
+            std::vector<T> const& buffer = buffers[set][t];
+            size_t const length = (slice.end - slice.begin) * sizeof(T);
+            chunks[slice.chunk].checksum = BinaryFormat::checksum(
+                    buffer.data(),
+                    length,
+                    chunks[slice.chunk].checksum
+                    );
+            fh.write((char const*)buffer.data(), length);
+        }
+    };
+
+    fh.seekp(header.points_offset);
+    for (uint64_t first = 0; first < slices.size(); first += threads) {
+        size_t const set = (first / threads) % 2;
+        std::vector<std::thread> workers;
+
+        if (first != 0) {
+            workers.emplace_back(write_batch, first - threads, 1 - set);
+        }
+
+        for (size_t t = 0; t < threads and first + t < slices.size(); ++t) {
+            workers.emplace_back([&, t, set]() {
+                Slice const& slice = slices[first + t];
+                std::vector<T>& buffer = buffers[set][t];
+                buffer.resize(slice.end - slice.begin);
+                generate_slice(
+                        header,
+                        slice.chunk,
+                        slice.begin,
+                        slice.end,
+                        model,
+                        buffer.data()
+                        );
+            });
+        }
+
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+    if (not slices.empty()) {
+        uint64_t const last = (slices.size() - 1) / threads * threads;
+        write_batch(last, (last / threads) % 2);
+    }
+}
+
+/*
+ * Generate elements begin to end of chunk into dst.
+ */
+template <typename T>
+void cle::ClusterGenerator::generate_slice(
+        Clustering::BinaryFormat::Header const& header,
+        uint64_t chunk,
+        uint64_t begin,
+        uint64_t end,
+        Model const& model,
+        T *dst
+        ) const {
+
+    using BinaryFormat = Clustering::BinaryFormat;
+
+    // Partitioned chunks contain all features of a range of points,
+    // column major chunks a single feature of all points
+    bool const partitioned =
+        header.layout == BinaryFormat::Layout::Partitioned;
+    uint64_t const chunk_points = (partitioned)
+        ? header.chunk_size / sizeof(T) / features_
+        : header.num_points
+        ;
+    uint64_t const first_point = (partitioned) ? chunk * chunk_points : 0;
+    uint64_t const num_chunk_points = std::min(
+            chunk_points,
+            header.num_points - first_point
+            );
+    uint64_t const first_feature = (partitioned) ? 0 : chunk;
+
+    uint64_t e = begin;
+    while (e < end) {
+        uint64_t const feature = first_feature + e / num_chunk_points;
+        uint64_t point = first_point + e % num_chunk_points;
+        uint64_t const run_end = std::min(
+                end,
+                e - e % num_chunk_points + num_chunk_points
+                );
+
+        uint64_t cluster = std::upper_bound(
+                model.cluster_offsets.begin(),
+                model.cluster_offsets.end(),
+                point
+                ) - model.cluster_offsets.begin() - 1;
+
+        for (; e < run_end; ++e, ++point) {
+            while (point >= model.cluster_offsets[cluster + 1]) {
+                ++cluster;
+            }
+            *dst++ = generate_value(
+                    model,
+                    header.num_points,
+                    feature,
+                    point,
+                    cluster
+                    );
+        }
+    }
+}
+
+/*
+ * Noise points are selected by their index, independent of the feature.
+ */
+bool cle::ClusterGenerator::is_noise(uint64_t point) const {
+
+    return noise_fraction_ > 0.0f
+        and Philox::uniform(Philox::generate(seed_, point, NoiseStream))
+        < noise_fraction_;
+}
+
+/*
+ * Draw feature of point in cluster.
+ *
+ * Noise points are uniform in the domain. Otherwise, points are
+ * Gaussian around their centroid with per-cluster and per-dimension
+ * scales, drawn in the latent space if intrinsic_dims is set.
+ */
+float cle::ClusterGenerator::generate_value(
+        Model const& model,
+        uint64_t num_points,
+        uint64_t feature,
+        uint64_t point,
+        uint64_t cluster
+        ) const {
+
+    if (is_noise(point)) {
+        return domain_min_ + (domain_max_ - domain_min_)
+            * Philox::uniform(Philox::generate(
+                        seed_,
+                        feature * num_points + point,
+                        OutlierStream
+                        ));
+    }
+
+    float value = model.centroids[feature * clusters_ + cluster];
+
+    if (model.latent_dims == 0) {
+        float const scale = model.scales[feature * clusters_ + cluster];
+        float const z = Philox::gaussian(Philox::generate(
+                    seed_,
+                    feature * num_points + point,
+                    PointStream
+                    ));
+        return value + scale * z;
+    }
+
+    for (uint64_t j = 0; j < model.latent_dims; ++j) {
+        float const scale = model.scales[j * clusters_ + cluster];
+        float const z = Philox::gaussian(Philox::generate(
+                    seed_,
+                    j * num_points + point,
+                    LatentStream
+                    ));
+        value += model.embedding[feature * model.latent_dims + j]
+            * scale * z;
+    }
+
+    return value;
+}
+
+/*
+ * Draw centroids, cluster sizes and scales.
+ */
+cle::ClusterGenerator::Model cle::ClusterGenerator::build_model(
+        uint64_t num_points,
+        uint64_t remainder
+        ) const {
+
+    Model model;
+    model.latent_dims = intrinsic_dims_;
+
+    // Points of cluster c are cluster_offsets[c] to cluster_offsets[c+1]
+    model.cluster_offsets.assign(clusters_ + 1, 0);
+    if (zipf_exponent_ == 0.0f) {
+        uint64_t const points_per_cluster = (num_points + remainder) / clusters_;
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            uint64_t start = 0;
+            if (remainder != 0 && c != 0) {
+                start = (clusters_ + remainder - 2) / (clusters_ - 1);
+                remainder = remainder - start;
+            }
+            model.cluster_offsets[c + 1] =
+                model.cluster_offsets[c] + points_per_cluster - start;
+        }
+    }
+    else {
+        // Size of cluster c is proportional to 1 / (c + 1)^s,
+        // but each cluster has at least one point
+        std::vector<double> weights(clusters_);
+        double total_weight = 0.0;
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            weights[c] = std::pow(c + 1.0, -(double) zipf_exponent_);
+            total_weight += weights[c];
+        }
+
+        assert(num_points >= clusters_);
+        uint64_t const spare_points = num_points - clusters_;
+        uint64_t assigned = 0;
+        std::vector<uint64_t> sizes(clusters_);
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            sizes[c] = 1 + (uint64_t) (spare_points * weights[c] / total_weight);
+            assigned += sizes[c];
+        }
+        for (uint64_t c = 0; assigned < num_points; ++c, ++assigned) {
+            ++sizes[c % clusters_];
+        }
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            model.cluster_offsets[c + 1] = model.cluster_offsets[c] + sizes[c];
+        }
+    }
+
+    // Scale of each cluster, log-uniform in [radius / spread, radius * spread]
+    std::vector<float> cluster_scales(clusters_, radius_);
+    if (radius_spread_ != 1.0f) {
+        float const log_spread = std::log(radius_spread_);
+        for (uint64_t c = 0; c < clusters_; ++c) {
+            float const u = Philox::uniform(
+                    Philox::generate(seed_, c, ScaleStream));
+            cluster_scales[c] *= std::exp((2.0f * u - 1.0f) * log_spread);
+        }
+    }
+
+    // Diagonal covariance of each cluster, in latent space if set.
+    // Column major, like centroids.
+    uint64_t const scale_dims =
+        (model.latent_dims != 0) ? model.latent_dims : features_;
+    model.scales.resize(scale_dims * clusters_);
+    float const log_anisotropy = std::log(anisotropy_);
+    for (uint64_t i = 0; i < model.scales.size(); ++i) {
+        float const u = Philox::uniform(
+                Philox::generate(seed_, i, AnisotropyStream));
+        model.scales[i] = cluster_scales[i % clusters_]
+            * std::exp((2.0f * u - 1.0f) * log_anisotropy);
+    }
+
+    // centroids are column major
+    model.centroids.resize(clusters_ * features_);
+    if (model.latent_dims == 0) {
+        for (uint64_t i = 0; i < model.centroids.size(); ++i) {
+            model.centroids[i] = domain_min_ + (domain_max_ - domain_min_)
+                * Philox::uniform(Philox::generate(seed_, i, CentroidStream));
+        }
+    }
+    else {
+        // Random Gaussian embedding of the latent space,
+        // normalized to preserve distances on average
+        uint64_t const k = model.latent_dims;
+        model.embedding.resize(features_ * k);
+        for (uint64_t i = 0; i < model.embedding.size(); ++i) {
+            model.embedding[i] = Philox::gaussian(
+                    Philox::generate(seed_, i, EmbeddingStream))
+                / std::sqrt((float) k);
+        }
+
+        std::vector<float> latent_centroids(clusters_ * k);
+        for (uint64_t i = 0; i < latent_centroids.size(); ++i) {
+            latent_centroids[i] = domain_min_ + (domain_max_ - domain_min_)
+                * Philox::uniform(Philox::generate(seed_, i, CentroidStream));
+        }
+
+        for (uint64_t f = 0; f < features_; ++f) {
+            for (uint64_t c = 0; c < clusters_; ++c) {
+                float centroid = 0.0f;
+                for (uint64_t j = 0; j < k; ++j) {
+                    centroid += model.embedding[f * k + j]
+                        * latent_centroids[j * clusters_ + c];
+                }
+                model.centroids[f * clusters_ + c] = centroid;
+            }
+        }
+    }
+
+    return model;
+}
+
 /*
  * Generate binary file
  * File format:
@@ -154,7 +687,7 @@ void cle::ClusterGenerator::generate_csv(char const* file_name) {
  * float clusters[0 ... num_clusters-1], column major
  * float points[0 ... num_points-1], column major
  */
-void cle::ClusterGenerator::generate_bin(char const* file_name) {
+void cle::ClusterGenerator::generate_bin_v1(char const* file_name) {
 
     uint64_t size = bytes_ / sizeof(float);
     uint64_t num_points = size / features_;
@@ -11,8 +11,10 @@
 #define CLUSTER_GENERATOR_HPP
 
 #include "matrix.hpp"
+#include "binary_format.hpp"
 
 #include <cstdint>
+#include <fstream>
 #include <vector>
 
 namespace cle {
@@ -24,6 +26,31 @@ public:
     void domain(float min, float max);
     void total_size(uint64_t bytes);
     void point_multiple(uint64_t multiple);
+    void chunk_size(uint64_t bytes);
+    void data_type(Clustering::BinaryFormat::DataType dtype);
+    void num_threads(uint32_t threads);
+    void seed(uint64_t seed);
+
+    /*
+     * Workload shape of generate_bin:
+     *
+     * zipf_exponent: Cluster sizes proportional to 1 / rank^exponent.
+     *   0 gives equal-sized clusters.
+     * radius_spread: Per-cluster radius, log-uniform in
+     *   [radius / spread, radius * spread].
+     * anisotropy: Per-cluster and per-dimension scale of the radius,
+     *   log-uniform in [1 / anisotropy, anisotropy].
+     * noise_fraction: Fraction of points drawn uniformly from the domain.
+     *   Their ground-truth label is the number of clusters, as they
+     *   belong to no cluster.
+     * intrinsic_dims: Clusters lie in a random subspace with this many
+     *   dimensions, embedded in the feature space. 0 disables.
+     */
+    void zipf_exponent(float exponent);
+    void radius_spread(float spread);
+    void anisotropy(float anisotropy);
+    void noise_fraction(float fraction);
+    void intrinsic_dims(uint64_t dims);
 
     void generate_matrix(
         Matrix<float, std::allocator<float>, uint32_t>& points,
@@ -33,8 +60,51 @@ public:
 
     void generate_csv(char const* file_name);
     void generate_bin(char const* file_name);
+    void generate_bin_v1(char const* file_name);
 
 private:
+    struct Model {
+        // Points of cluster c are cluster_offsets[c] to cluster_offsets[c+1]
+        std::vector<uint64_t> cluster_offsets;
+        // Column major
+        std::vector<float> centroids;
+        // Column major, per latent dimension if latent_dims is set
+        std::vector<float> scales;
+        // Feature-major features_ x latent_dims matrix
+        std::vector<float> embedding;
+        uint64_t latent_dims;
+    };
+
+    Model build_model(uint64_t num_points, uint64_t remainder) const;
+
+    bool is_noise(uint64_t point) const;
+
+    float generate_value(
+            Model const& model,
+            uint64_t num_points,
+            uint64_t feature,
+            uint64_t point,
+            uint64_t cluster
+            ) const;
+
+    template <typename T>
+    void write_points(
+            std::ofstream& fh,
+            Clustering::BinaryFormat::Header const& header,
+            std::vector<Clustering::BinaryFormat::ChunkInfo>& chunks,
+            Model const& model
+            );
+
+    template <typename T>
+    void generate_slice(
+            Clustering::BinaryFormat::Header const& header,
+            uint64_t chunk,
+            uint64_t begin,
+            uint64_t end,
+            Model const& model,
+            T *dst
+            ) const;
+
     uint64_t features_;
     uint64_t clusters_;
     float radius_;
@@ -42,6 +112,16 @@ private:
     float domain_max_;
     uint64_t bytes_;
     uint64_t multiple_;
+    uint64_t chunk_size_ = 16 * 1024 * 1024;
+    Clustering::BinaryFormat::DataType dtype_ =
+        Clustering::BinaryFormat::DataType::Float32;
+    uint32_t num_threads_ = 0;
+    uint64_t seed_ = 0;
+    float zipf_exponent_ = 0.0f;
+    float radius_spread_ = 1.0f;
+    float anisotropy_ = 1.0f;
+    float noise_fraction_ = 0.0f;
+    uint64_t intrinsic_dims_ = 0;
 };
 }
 #endif /* CLUSTER_GENERATOR_HPP */
@@ -262,14 +262,7 @@ uint64_t Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>::verif
             labels_
      );
 
-    uint64_t counter = 0;
-    for (size_t l = 0; l < labels_.size(); ++l) {
-        if (reference_labels_[l] != labels_[l]) {
-            ++counter;
-        }
-    }
-
-    return counter;
+    return count_incorrect_labels();
 }
 
 template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
@@ -306,14 +299,29 @@ uint64_t Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>::verif
             labels
      );
 
-    uint64_t counter = 0;
+    return count_incorrect_labels();
+}
+
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
+double Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>::incorrect_label_fraction() const {
+
+    return (labels_.empty())
+        ? 0.0
+        : (double) incorrect_labels_ / labels_.size()
+        ;
+}
+
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
+uint64_t Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>::count_incorrect_labels() {
+
+    incorrect_labels_ = 0;
     for (size_t l = 0; l < labels_.size(); ++l) {
         if (reference_labels_[l] != labels_[l]) {
-            ++counter;
+            ++incorrect_labels_;
         }
     }
 
-    return counter;
+    return incorrect_labels_;
 }
 
 template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
@@ -372,3 +380,5 @@ void Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>::print_res
 
 template class Clustering::ClusteringBenchmark<float, uint32_t, uint32_t, true>;
 template class Clustering::ClusteringBenchmark<double, uint64_t, uint64_t, true>;
+template class Clustering::ClusteringBenchmark<float, uint32_t, uint32_t, false>;
+template class Clustering::ClusteringBenchmark<double, uint64_t, uint64_t, false>;
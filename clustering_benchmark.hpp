@@ -105,12 +105,30 @@ public:
     ClusteringBenchmarkStats run(ClClusteringFunction f);
     void setVerificationReference(std::vector<LabelT>&& reference_labels);
     int setVerificationReference(ClusteringFunction reference);
+    /*
+     * Run f once and return the number of labels that differ from the
+     * reference.
+     */
     uint64_t verify(ClusteringFunction f);
     uint64_t verify(ClClusteringFunction f);
+
+    /*
+     * Share of labels of the last verify() that differ from the
+     * reference, in [0, 1].
+     */
+    double incorrect_label_fraction() const;
+
     double mse();
     void print_labels();
     void print_result();
 
+    /*
+     * Results of the last run.
+     */
+    cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& centroids() const { return centroids_; }
+    std::vector<MassT> const& masses() const { return cluster_mass_; }
+    std::vector<LabelT> const& labels() const { return labels_; }
+
 private:
     const uint32_t num_runs_;
     const size_t num_points_;
@@ -124,11 +142,16 @@ private:
     std::vector<LabelT> labels_;
     std::vector<LabelT> reference_labels_;
     InitCentroidsFunction init_centroids_;
+    uint64_t incorrect_labels_ = 0;
+
+    uint64_t count_incorrect_labels();
 };
 
 }
 
 extern template class Clustering::ClusteringBenchmark<float, uint32_t, uint32_t, true>;
 extern template class Clustering::ClusteringBenchmark<double, uint64_t, uint64_t, true>;
+extern template class Clustering::ClusteringBenchmark<float, uint32_t, uint32_t, false>;
+extern template class Clustering::ClusteringBenchmark<double, uint64_t, uint64_t, false>;
 
 #endif /* CLUSTERING_BENCHMARK_HPP */
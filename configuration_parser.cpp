@@ -18,6 +18,29 @@
 
 namespace po = boost::program_options;
 
+namespace {
+
+/*
+ * Check that value is a number of bytes that fits into size_t.
+ */
+bool is_byte_count(std::string const& value) {
+    if (value.empty()
+            or value.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+
+    try {
+        std::stoul(value);
+    }
+    catch (std::out_of_range const&) {
+        return false;
+    }
+    return true;
+}
+
+}
+
 namespace Clustering {
 
 void ConfigurationParser::parse_file(std::string file) {
@@ -63,6 +86,14 @@ po::options_description ConfigurationParser::kmeans_options() {
         // K-means general options
         ("kmeans.clusters", po::value<size_t>())
         ("kmeans.pipeline", po::value<std::string>())
+        ("kmeans.buffer_size", po::value<std::string>())
+        ("kmeans.out_of_order", po::value<bool>())
+        ("kmeans.checkpoint", po::value<std::string>())
+        ("kmeans.checkpoint_interval", po::value<size_t>())
+        ("kmeans.append_points", po::value<size_t>())
+        ("kmeans.append_incremental_iterations", po::value<size_t>())
+        ("kmeans.append_full_iterations", po::value<size_t>())
+        ("kmeans.layout", po::value<std::string>())
         ("kmeans.iterations", po::value<size_t>())
         ("kmeans.converge", po::value<bool>())
         ("kmeans.types.point", po::value<std::string>())
@@ -78,6 +109,9 @@ po::options_description ConfigurationParser::kmeans_options() {
         ("kmeans.labeling.vector_length", po::value<size_t>())
         ("kmeans.labeling.unroll_clusters_length", po::value<size_t>())
         ("kmeans.labeling.unroll_features_length", po::value<size_t>())
+        ("kmeans.labeling.tile_features", po::value<size_t>())
+        ("kmeans.labeling.tile_clusters", po::value<size_t>())
+        ("kmeans.labeling.autotune", po::value<bool>())
 
         // Mass sum specific
         ("kmeans.mass_update.platform", po::value<size_t>())
@@ -95,6 +129,7 @@ po::options_description ConfigurationParser::kmeans_options() {
         ("kmeans.centroid_update.local_size", po::value<std::vector<size_t>>())
         ("kmeans.centroid_update.local_features", po::value<size_t>())
         ("kmeans.centroid_update.thread_features", po::value<size_t>())
+        ("kmeans.centroid_update.tile_features", po::value<size_t>())
         ("kmeans.centroid_update.vector_length", po::value<size_t>())
 
         // Fused specific
@@ -104,6 +139,7 @@ po::options_description ConfigurationParser::kmeans_options() {
         ("kmeans.fused.global_size", po::value<std::vector<size_t>>())
         ("kmeans.fused.local_size", po::value<std::vector<size_t>>())
         ("kmeans.fused.vector_length", po::value<size_t>())
+        ("kmeans.fused.autotune", po::value<bool>())
 
         ;
 
@@ -137,6 +173,37 @@ KmeansConfiguration ConfigurationParser::get_kmeans_configuration() {
         else if (option.first == "kmeans.pipeline") {
             conf.pipeline = option.second.as<std::string>();
         }
+        else if (option.first == "kmeans.buffer_size") {
+            conf.buffer_size = option.second.as<std::string>();
+            if (conf.buffer_size != "auto"
+                    and not is_byte_count(conf.buffer_size))
+            {
+                throw std::invalid_argument(
+                        "kmeans.buffer_size must be \"auto\" or a number"
+                        " of bytes, got \"" + conf.buffer_size + "\"");
+            }
+        }
+        else if (option.first == "kmeans.out_of_order") {
+            conf.out_of_order = option.second.as<bool>();
+        }
+        else if (option.first == "kmeans.checkpoint") {
+            conf.checkpoint = option.second.as<std::string>();
+        }
+        else if (option.first == "kmeans.checkpoint_interval") {
+            conf.checkpoint_interval = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.append_points") {
+            conf.append_points = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.append_incremental_iterations") {
+            conf.append_incremental_iterations = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.append_full_iterations") {
+            conf.append_full_iterations = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.layout") {
+            conf.layout = option.second.as<std::string>();
+        }
         else if (option.first == "kmeans.iterations") {
             conf.iterations = option.second.as<size_t>();
         }
@@ -198,6 +265,15 @@ LabelingConfiguration ConfigurationParser::get_labeling_configuration() {
         else if (option.first == "kmeans.labeling.unroll_features_length") {
             conf.unroll_features_length = option.second.as<size_t>();
         }
+        else if (option.first == "kmeans.labeling.tile_features") {
+            conf.tile_features = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.labeling.tile_clusters") {
+            conf.tile_clusters = option.second.as<size_t>();
+        }
+        else if (option.first == "kmeans.labeling.autotune") {
+            conf.autotune = option.second.as<bool>();
+        }
 
     }
 
@@ -280,6 +356,9 @@ CentroidUpdateConfiguration ConfigurationParser::get_centroid_update_configurati
         else if (option.first == "kmeans.centroid_update.thread_features") {
             conf.thread_features = option.second.as<size_t>();
         }
+        else if (option.first == "kmeans.centroid_update.tile_features") {
+            conf.tile_features = option.second.as<size_t>();
+        }
         else if (option.first == "kmeans.centroid_update.vector_length") {
             conf.vector_length = option.second.as<size_t>();
         }
@@ -322,6 +401,9 @@ FusedConfiguration ConfigurationParser::get_fused_configuration() {
         else if (option.first == "kmeans.fused.vector_length") {
             conf.vector_length = option.second.as<size_t>();
         }
+        else if (option.first == "kmeans.fused.autotune") {
+            conf.autotune = option.second.as<bool>();
+        }
     }
 
     return conf;
@@ -14,6 +14,8 @@
 
 #include <vector>
 #include <tuple>
+#include <thread>
+#include <algorithm>
 #include <iostream>
 #include <cerrno>
 #include <cstring>
@@ -121,8 +123,8 @@ public:
         return 1;
     }
 
-    template <typename T, typename Alloc, typename INT>
-    int read_csv(char const *file_name, Matrix<T, Alloc, INT, true>& matrix,
+    template <typename T, typename Alloc, typename INT, bool COL_MAJOR>
+    int read_csv(char const *file_name, Matrix<T, Alloc, INT, COL_MAJOR>& matrix,
             size_t const batch_size = 10) {
 
 
@@ -144,6 +146,139 @@ public:
         return 1;
     }
 
+    /*
+     * Read CSV file into column-major or row-major matrix using multiple
+     * threads.
+     *
+     * The mapped file is split at line boundaries. Each thread first
+     * counts its lines and then parses them straight into the matrix.
+     * A first line that doesn't start with a number is skipped as
+     * header. Empty lines and carriage returns are ignored.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    template <typename T, typename Alloc, typename INT, bool COL_MAJOR>
+    int read_csv_parallel(char const *file_name,
+            Matrix<T, Alloc, INT, COL_MAJOR>& matrix, size_t num_threads = 0) {
+
+        size_t file_size = 0;
+        char const * mapped = NULL;
+
+        if (open_file(file_name, mapped, file_size) != 1) {
+            return -1;
+        }
+
+        char const * const file_end = &mapped[file_size];
+        char const * data_begin = mapped;
+
+        // Skip header
+        {
+            T v;
+            char const * it = data_begin;
+            if (not boost::spirit::qi::parse(it, file_end,
+                        boost::spirit::qi::real_parser<T>(), v)) {
+                data_begin = next_line(data_begin, file_end);
+            }
+        }
+
+        size_t num_columns = num_fields(data_begin, file_end, delimiter_);
+        if (num_columns == 0) {
+            std::cerr << "CSV file " << file_name << " has no data"
+                << std::endl;
+            close_file(mapped, file_size);
+            return -1;
+        }
+
+        // Split at line boundaries
+        size_t data_size = file_end - data_begin;
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+            num_threads = std::min(num_threads,
+                    data_size / min_thread_bytes + 1);
+        }
+        std::vector<char const *> bounds(num_threads + 1, file_end);
+        bounds[0] = data_begin;
+        for (size_t t = 1; t < num_threads; ++t) {
+            char const * split = data_begin + data_size / num_threads * t;
+            bounds[t] = std::max(bounds[t - 1],
+                    next_line(split - 1, file_end));
+        }
+
+        // Count lines to find each thread's first row
+        std::vector<size_t> first_row(num_threads + 1, 0);
+        {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < num_threads; ++t) {
+                workers.emplace_back([&, t]() {
+                    size_t lines = 0;
+                    char const * line = bounds[t];
+                    while (line < bounds[t + 1]) {
+                        char const * line_end = find_line_end(line,
+                                bounds[t + 1]);
+                        if (line_end != line) {
+                            ++lines;
+                        }
+                        line = next_line(line, bounds[t + 1]);
+                    }
+                    first_row[t + 1] = lines;
+                });
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+        for (size_t t = 0; t < num_threads; ++t) {
+            first_row[t + 1] += first_row[t];
+        }
+
+        size_t const num_rows = first_row[num_threads];
+        matrix.resize(num_rows, num_columns);
+        T * const dst = matrix.data();
+
+        // Parse lines directly into their matrix rows
+        std::vector<size_t> error_row(num_threads, num_rows);
+        {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < num_threads; ++t) {
+                workers.emplace_back([&, t]() {
+                    size_t row = first_row[t];
+                    char const * line = bounds[t];
+                    while (line < bounds[t + 1]) {
+                        char const * line_end = find_line_end(line,
+                                bounds[t + 1]);
+                        if (line_end != line) {
+                            if (parse_row(line, line_end, dst, row,
+                                        num_rows, num_columns,
+                                        COL_MAJOR) < 0) {
+                                error_row[t] = row;
+                                return;
+                            }
+                            ++row;
+                        }
+                        line = next_line(line, bounds[t + 1]);
+                    }
+                });
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+        }
+
+        close_file(mapped, file_size);
+
+        size_t bad_row = *std::min_element(error_row.begin(),
+                error_row.end());
+        if (bad_row != num_rows) {
+            std::cerr << "CSV file " << file_name
+                << ": parse error in data row " << bad_row
+                << ", expected " << num_columns << " fields"
+                << std::endl;
+            return -1;
+        }
+
+        return 1;
+    }
+
     void set_delimiter(const char delimiter) {
         delimiter_ = delimiter;
     }
@@ -280,6 +415,74 @@ private:
         return column;
     }
 
+    // Don't spawn threads for less than this many bytes each
+    static constexpr size_t min_thread_bytes = 4 * 1024 * 1024;
+
+    // Returns beginning of line after the one containing pos
+    static char const * next_line(char const *pos, char const *end) {
+        char const * nl = (char const*) memchr(pos, '\n', end - pos);
+        return (nl) ? nl + 1 : end;
+    }
+
+    // Returns end of line at begin, excluding line break
+    static char const * find_line_end(char const *begin, char const *end) {
+        char const * line_end = (char const*) memchr(begin, '\n',
+                end - begin);
+        if (not line_end) {
+            line_end = end;
+        }
+        while (line_end != begin and line_end[-1] == '\r') {
+            --line_end;
+        }
+        return line_end;
+    }
+
+    static size_t num_fields(char const *begin, char const *end,
+            char delimiter) {
+        char const * line_end = find_line_end(begin, end);
+        if (line_end == begin) {
+            return 0;
+        }
+        return std::count(begin, line_end, delimiter) + 1;
+    }
+
+    template <typename T>
+    int parse_row(char const *begin, char const *end, T *dst,
+            size_t row, size_t num_rows, size_t num_columns,
+            bool col_major) {
+
+        char const * it = begin;
+        for (size_t c = 0; c < num_columns; ++c) {
+            while (it != end and *it == ' ' and delimiter_ != ' ') {
+                ++it;
+            }
+
+            T v;
+            if (not boost::spirit::qi::parse(it, end,
+                        boost::spirit::qi::real_parser<T>(), v)) {
+                return -1;
+            }
+            if (col_major) {
+                dst[c * num_rows + row] = v;
+            }
+            else {
+                dst[row * num_columns + c] = v;
+            }
+
+            while (it != end and *it == ' ' and delimiter_ != ' ') {
+                ++it;
+            }
+            if (c + 1 < num_columns) {
+                if (it == end or *it != delimiter_) {
+                    return -1;
+                }
+                ++it;
+            }
+        }
+
+        return (it == end) ? 1 : -1;
+    }
+
     template <size_t depth = 0, typename T>
     int parse_line(std::stringstream& ssbuf, CToken const *tokens,
             std::vector<T>& vec) {
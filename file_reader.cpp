@@ -0,0 +1,252 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* O_DIRECT */
+#endif
+
+#include "file_reader.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Clustering;
+
+FileReader::FileReader()
+{
+#ifdef URING_FOUND
+    ring_ready = (io_uring_queue_init(queue_depth, &ring, 0) == 0);
+    if (not ring_ready) {
+        std::cerr
+            << "FileReader: io_uring unavailable,"
+            << " falling back to pread"
+            << std::endl;
+    }
+#endif
+}
+
+FileReader::~FileReader()
+{
+#ifdef URING_FOUND
+    if (ring_ready) {
+        io_uring_queue_exit(&ring);
+    }
+#endif
+}
+
+int FileReader::open(char const *file_name, int& fd, int& direct_fd)
+{
+    fd = ::open(file_name, O_RDONLY);
+    if (fd < 0) {
+        std::cerr
+            << "FileReader: cannot open " << file_name
+            << ": " << std::strerror(errno)
+            << std::endl;
+        return -1;
+    }
+
+    // Some file systems (e.g. tmpfs) don't support O_DIRECT
+    direct_fd = ::open(file_name, O_RDONLY | O_DIRECT);
+
+    return 1;
+}
+
+void FileReader::close(int fd, int direct_fd)
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (direct_fd >= 0) {
+        ::close(direct_fd);
+    }
+}
+
+int FileReader::read(
+        int fd,
+        int direct_fd,
+        void *dst,
+        size_t length,
+        size_t capacity,
+        size_t offset
+        )
+{
+    size_t aligned_length =
+        (length + alignment - 1) / alignment * alignment;
+
+    bool use_direct =
+        direct_fd >= 0
+        and offset % alignment == 0
+        and (uintptr_t)dst % alignment == 0
+        and aligned_length <= capacity
+        ;
+
+    int read_fd = (use_direct) ? direct_fd : fd;
+    size_t read_length = (use_direct) ? aligned_length : length;
+
+#ifdef URING_FOUND
+    if (ring_ready) {
+        return read_uring(read_fd, (char*)dst, read_length, offset);
+    }
+#endif
+
+    return read_sequential(read_fd, (char*)dst, read_length, offset);
+}
+
+int FileReader::read_sequential(
+        int fd,
+        char *dst,
+        size_t length,
+        size_t offset
+        )
+{
+    size_t done = 0;
+    while (done < length) {
+        ssize_t ret = pread(fd, &dst[done], length - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr
+                << "FileReader: pread error: " << std::strerror(errno)
+                << std::endl;
+            return -1;
+        }
+        else if (ret == 0) {
+            // Reached end of file; direct reads are rounded up
+            // to the alignment and may legitimately end here
+            break;
+        }
+        done += ret;
+    }
+
+    return 1;
+}
+
+#ifdef URING_FOUND
+int FileReader::read_uring(
+        int fd,
+        char *dst,
+        size_t length,
+        size_t offset
+        )
+{
+    // Ranges of the requests in flight, indexed by the request's user data
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+    Range ranges[queue_depth];
+    unsigned free_slots[queue_depth];
+    unsigned num_free = queue_depth;
+    for (unsigned i = 0; i < queue_depth; ++i) {
+        free_slots[i] = i;
+    }
+
+    auto prepare = [&](unsigned slot) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        if (not sqe) {
+            return false;
+        }
+
+        Range const& range = ranges[slot];
+        io_uring_prep_read(
+                sqe,
+                fd,
+                &dst[range.begin],
+                range.end - range.begin,
+                offset + range.begin
+                );
+        io_uring_sqe_set_data(sqe, (void*)(uintptr_t)slot);
+        return true;
+    };
+
+    size_t submitted = 0;
+    unsigned in_flight = 0;
+    int ret = 1;
+
+    while (submitted < length or in_flight > 0) {
+
+        while (ret > 0 and submitted < length and in_flight < queue_depth) {
+            size_t chunk = (length - submitted < chunk_size)
+                ? length - submitted
+                : chunk_size
+                ;
+
+            unsigned slot = free_slots[num_free - 1];
+            ranges[slot] = Range{submitted, submitted + chunk};
+            if (not prepare(slot)) {
+                break;
+            }
+            --num_free;
+            submitted += chunk;
+            ++in_flight;
+        }
+
+        if (io_uring_submit(&ring) < 0) {
+            std::cerr << "FileReader: io_uring_submit error" << std::endl;
+            return -1;
+        }
+
+        struct io_uring_cqe *cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+            std::cerr << "FileReader: io_uring_wait_cqe error" << std::endl;
+            return -1;
+        }
+
+        int res = cqe->res;
+        unsigned slot = (unsigned)(uintptr_t)io_uring_cqe_get_data(cqe);
+        io_uring_cqe_seen(&ring, cqe);
+        --in_flight;
+
+        Range& range = ranges[slot];
+        bool resubmit = false;
+        if (res == -EINTR or res == -EAGAIN) {
+            resubmit = true;
+        }
+        else if (res < 0) {
+            std::cerr
+                << "FileReader: io_uring read error: " << std::strerror(-res)
+                << std::endl;
+
+            // Stop submitting, but drain requests still in flight
+            ret = -1;
+            submitted = length;
+        }
+        else if (res > 0) {
+            // Short reads may occur anywhere, read the remainder
+            range.begin += res;
+            resubmit = range.begin < range.end;
+        }
+        // else reached end of file; direct reads are rounded up
+        // to the alignment and may legitimately end here
+
+        if (resubmit and ret > 0) {
+            if (not prepare(slot)) {
+                std::cerr << "FileReader: io_uring queue full" << std::endl;
+                ret = -1;
+                submitted = length;
+                free_slots[num_free++] = slot;
+            }
+            else {
+                ++in_flight;
+            }
+        }
+        else {
+            free_slots[num_free++] = slot;
+        }
+    }
+
+    return ret;
+}
+#endif
@@ -0,0 +1,89 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef FILE_READER_HPP
+#define FILE_READER_HPP
+
+#include <SystemConfig.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef URING_FOUND
+#include <liburing.h>
+#endif
+
+namespace Clustering {
+
+/*
+ * Reads file ranges into host memory for the buffer cache IO threads.
+ *
+ * If liburing is available, a range is split into chunks that are
+ * submitted together to an io_uring. This keeps multiple requests in
+ * flight, which NVMe drives need to reach their full bandwidth.
+ * Otherwise, falls back to sequential pread().
+ *
+ * Reads use the O_DIRECT file descriptor if offset, destination and
+ * length are aligned to FileReader::alignment. This bypasses the page
+ * cache and DMAs straight into the (pinned) destination buffer.
+ *
+ * A FileReader is not thread-safe; use one instance per thread.
+ */
+class FileReader {
+public:
+    static constexpr size_t alignment = 4096;
+
+    FileReader();
+    ~FileReader();
+
+    FileReader(FileReader const&) = delete;
+    FileReader& operator=(FileReader const&) = delete;
+
+    /*
+     * Open file for buffered reads and, if supported by the file
+     * system, for direct reads. Either fd may be used with read().
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    static int open(char const *file_name, int& fd, int& direct_fd);
+    static void close(int fd, int direct_fd);
+
+    /*
+     * Read length bytes at offset into dst.
+     * capacity is the size of dst, which may be larger than length to
+     * allow rounding up direct reads to the alignment.
+     *
+     * Returns 1 if successful, negative value if unsuccessful.
+     */
+    int read(
+            int fd,
+            int direct_fd,
+            void *dst,
+            size_t length,
+            size_t capacity,
+            size_t offset
+            );
+
+private:
+    int read_sequential(int fd, char *dst, size_t length, size_t offset);
+
+#ifdef URING_FOUND
+    static constexpr unsigned queue_depth = 16;
+    static constexpr size_t chunk_size = 1024 * 1024;
+
+    int read_uring(int fd, char *dst, size_t length, size_t offset);
+
+    struct io_uring ring;
+    bool ring_ready;
+#endif
+};
+
+} // namespace Clustering
+
+#endif /* FILE_READER_HPP */
@@ -10,6 +10,8 @@
 #ifndef FUSED_CONFIGURATION_HPP
 #define FUSED_CONFIGURATION_HPP
 
+#include "point_storage.hpp"
+
 #include <cstddef>
 #include <string>
 
@@ -22,6 +24,9 @@ struct FusedConfiguration {
     size_t global_size[3];
     size_t local_size[3];
     size_t vector_length;
+    bool autotune = false;
+    PointStorage point_storage = PointStorage::Native;
+    Quantization quantization;
 };
 
 }
@@ -11,6 +11,8 @@
 #define FUSED_FACTORY_HPP
 
 #include "fused_configuration.hpp"
+#include "measurement/measurement.hpp"
+#include "online_tuner.hpp"
 
 #include "cl_kernels/fused_cluster_merge.hpp"
 #include "cl_kernels/fused_feature_sum.hpp"
@@ -18,6 +20,7 @@
 #include <functional>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/compute/core.hpp>
 #include <boost/compute/iterator/buffer_iterator.hpp>
@@ -57,6 +60,10 @@ public:
             FusedConfiguration config,
             Measurement::Measurement& measurement)
     {
+        if (config.autotune) {
+            return create_autotuned(context, config, measurement);
+        }
+
         measurement.set_parameter(
                 "FusedGlobalSize",
                 std::to_string(config.global_size[0])
@@ -84,6 +91,35 @@ public:
             throw std::invalid_argument(config.strategy);
         }
     }
+
+private:
+    /*
+     * Try launch configurations around the configured one in the first
+     * iterations, and continue with the fastest
+     */
+    FusedFunction create_autotuned(
+            boost::compute::context context,
+            FusedConfiguration config,
+            Measurement::Measurement& measurement)
+    {
+        config.autotune = false;
+        std::vector<FusedConfiguration> configs = launch_variants(
+                config,
+                context.get_device().max_work_group_size());
+
+        // Only the configured variant's parameters are recorded
+        Measurement::Measurement variants_measurement;
+        std::vector<FusedFunction> variants;
+        variants.push_back(create(context, configs[0], measurement));
+        for (size_t v = 1; v < configs.size(); ++v) {
+            variants.push_back(
+                    create(context, configs[v], variants_measurement));
+        }
+
+        measurement.set_parameter("FusedAutotune", "true");
+
+        return OnlineTuner<FusedFunction>(std::move(variants));
+    }
 };
 
 }
@@ -50,6 +50,25 @@ public:
              "Domain space (maximum value for centroids)")
             ("divisor", po::value<uint64_t>(&multiple_)->default_value(8),
              "Number of points are multiple of divisor")
+            ("chunk-size", po::value<uint64_t>(&chunk_size_)->default_value(16 * 1024 * 1024),
+             "Chunk size in bytes, matching the buffer size of buffered pipelines (0 for column major layout)")
+            ("type", po::value<std::string>(&type_)->default_value("float"),
+             "Data type (float, double, half or bfloat16)")
+            ("seed", po::value<uint64_t>(&seed_)->default_value(0),
+             "Random seed")
+            ("threads", po::value<uint32_t>(&threads_)->default_value(0),
+             "Number of generator threads (0 for all cores)")
+            ("zipf", po::value<float>(&zipf_)->default_value(0.0f),
+             "Zipf exponent of cluster sizes (0 for equal sizes)")
+            ("radius-spread", po::value<float>(&radius_spread_)->default_value(1.0f),
+             "Per-cluster radius varies by up to this factor")
+            ("anisotropy", po::value<float>(&anisotropy_)->default_value(1.0f),
+             "Per-cluster, per-dimension radius varies by up to this factor")
+            ("noise", po::value<float>(&noise_)->default_value(0.0f),
+             "Fraction of uniformly distributed noise points, labeled with the number of clusters in the ground truth")
+            ("intrinsic-dims", po::value<uint64_t>(&intrinsic_dims_)->default_value(0),
+             "Embed clusters in a subspace of this dimension (0 to disable)")
+            ("v1", "Generate version 1 binary file")
             ;
 
         po::options_description hidden("Hidden options");
@@ -82,6 +101,62 @@ public:
             csv_format_ = false;
         }
 
+        if (vm.count("v1")) {
+            v1_format_ = true;
+        }
+        else {
+            v1_format_ = false;
+        }
+
+        bool const shaped =
+            zipf_ != 0.0f || radius_spread_ != 1.0f || anisotropy_ != 1.0f
+            || noise_ != 0.0f || intrinsic_dims_ != 0;
+        if (shaped && (csv_format_ || v1_format_)) {
+            std::cout << "Workload shape options require version 2 binary output!" << std::endl;
+            return -1;
+        }
+
+        if (features_ == 0 || clusters_ == 0 || multiple_ == 0) {
+            std::cout << "Features, clusters and divisor must be at least 1!" << std::endl;
+            return -1;
+        }
+
+        // Number of points as computed by ClusterGenerator
+        uint64_t const points_per_cluster =
+            bytes() / sizeof(float) / features_ / clusters_;
+        uint64_t const num_points = points_per_cluster * clusters_
+            - points_per_cluster * clusters_ % multiple_;
+        if (num_points < clusters_) {
+            std::cout << "Size too small for " << clusters_ << " clusters!" << std::endl;
+            return -1;
+        }
+
+        if (zipf_ < 0.0f) {
+            std::cout << "Zipf exponent must not be negative!" << std::endl;
+            return -1;
+        }
+
+        if (radius_spread_ < 1.0f || anisotropy_ < 1.0f) {
+            std::cout << "Radius spread and anisotropy must be at least 1!" << std::endl;
+            return -1;
+        }
+
+        if (noise_ < 0.0f || noise_ > 1.0f) {
+            std::cout << "Noise must be a fraction between 0 and 1!" << std::endl;
+            return -1;
+        }
+
+        if (type_ != "float" && type_ != "double"
+                && type_ != "half" && type_ != "bfloat16") {
+            std::cout << "Type must be float, double, half or bfloat16!" << std::endl;
+            return -1;
+        }
+
+        if ((type_ == "half" || type_ == "bfloat16") && (csv_format_ || v1_format_)) {
+            std::cout << "16-bit types require version 2 binary output!" << std::endl;
+            return -1;
+        }
+
         // Ensure we have required options
         if (output_file_.empty()) {
             std::cout << "Give me an output file!" << std::endl;
@@ -95,6 +170,28 @@ public:
         return csv_format_;
     }
 
+    bool v1_format() const {
+        return v1_format_;
+    }
+
+    uint64_t chunk_size() const {
+        return chunk_size_;
+    }
+
+    Clustering::BinaryFormat::DataType data_type() const {
+        if (type_ == "double") {
+            return Clustering::BinaryFormat::DataType::Float64;
+        }
+        else if (type_ == "half") {
+            return Clustering::BinaryFormat::DataType::Float16;
+        }
+        else if (type_ == "bfloat16") {
+            return Clustering::BinaryFormat::DataType::BFloat16;
+        }
+
+        return Clustering::BinaryFormat::DataType::Float32;
+    }
+
     uint64_t features() const {
         return features_;
     }
@@ -123,6 +220,34 @@ public:
         return domain_max_;
     }
 
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    uint32_t threads() const {
+        return threads_;
+    }
+
+    float zipf() const {
+        return zipf_;
+    }
+
+    float radius_spread() const {
+        return radius_spread_;
+    }
+
+    float anisotropy() const {
+        return anisotropy_;
+    }
+
+    float noise() const {
+        return noise_;
+    }
+
+    uint64_t intrinsic_dims() const {
+        return intrinsic_dims_;
+    }
+
     std::string output_file() const {
         return output_file_;
     }
@@ -130,6 +255,9 @@ public:
 private:
     std::string output_file_;
     bool csv_format_;
+    bool v1_format_;
+    std::string type_;
+    uint64_t chunk_size_;
     uint64_t features_;
     uint64_t clusters_;
     uint64_t megabytes_;
@@ -137,6 +265,13 @@ private:
     float radius_;
     float domain_min_;
     float domain_max_;
+    uint64_t seed_;
+    uint32_t threads_;
+    float zipf_;
+    float radius_spread_;
+    float anisotropy_;
+    float noise_;
+    uint64_t intrinsic_dims_;
 };
 
 int main(int argc, char **argv) {
@@ -154,10 +289,22 @@ int main(int argc, char **argv) {
     generator.num_features(options.features());
     generator.num_clusters(options.clusters());
     generator.point_multiple(options.multiple());
+    generator.chunk_size(options.chunk_size());
+    generator.data_type(options.data_type());
+    generator.seed(options.seed());
+    generator.num_threads(options.threads());
+    generator.zipf_exponent(options.zipf());
+    generator.radius_spread(options.radius_spread());
+    generator.anisotropy(options.anisotropy());
+    generator.noise_fraction(options.noise());
+    generator.intrinsic_dims(options.intrinsic_dims());
 
     if (options.csv_format()) {
         generator.generate_csv(options.output_file().c_str());
     }
+    else if (options.v1_format()) {
+        generator.generate_bin_v1(options.output_file().c_str());
+    }
     else {
         generator.generate_bin(options.output_file().c_str());
     }
@@ -18,6 +18,14 @@ namespace Clustering {
 struct KmeansConfiguration {
     size_t clusters;
     std::string pipeline;
+    std::string buffer_size;
+    bool out_of_order = false;
+    std::string checkpoint;
+    size_t checkpoint_interval = 0;
+    size_t append_points = 0;
+    size_t append_incremental_iterations = 1;
+    size_t append_full_iterations = 1;
+    std::string layout = "col_major";
     size_t iterations;
     bool converge;
     std::string point_type;
@@ -11,10 +11,10 @@
 
 #include <random>
 
-template <typename PointT>
-void Clustering::KmeansInitializer<PointT>::forgy(
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids) {
+template <typename PointT, bool ColMajor>
+void Clustering::KmeansInitializer<PointT, ColMajor>::forgy(
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids) {
 
     std::random_device rand;
 
@@ -26,10 +26,10 @@ void Clustering::KmeansInitializer<PointT>::forgy(
     }
 }
 
-template <typename PointT>
-void Clustering::KmeansInitializer<PointT>::first_x(
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids) {
+template <typename PointT, bool ColMajor>
+void Clustering::KmeansInitializer<PointT, ColMajor>::first_x(
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids) {
 
     for (size_t d = 0; d < centroids.cols(); ++d) {
         for (size_t c = 0; c != centroids.rows(); ++c) {
@@ -40,3 +40,5 @@ void Clustering::KmeansInitializer<PointT>::first_x(
 
 template class Clustering::KmeansInitializer<float>;
 template class Clustering::KmeansInitializer<double>;
+template class Clustering::KmeansInitializer<float, false>;
+template class Clustering::KmeansInitializer<double, false>;
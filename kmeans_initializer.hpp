@@ -15,17 +15,17 @@
 
 namespace Clustering {
 
-template <typename PointT>
+template <typename PointT, bool ColMajor = true>
 class KmeansInitializer {
 public:
     static void forgy(
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids
             );
 
     static void first_x(
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids
             );
 };
 
@@ -38,5 +38,7 @@ using KmeansInitializer64 =
 
 extern template class Clustering::KmeansInitializer<float>;
 extern template class Clustering::KmeansInitializer<double>;
+extern template class Clustering::KmeansInitializer<float, false>;
+extern template class Clustering::KmeansInitializer<double, false>;
 
 #endif /* KMEANS_INITIALIZER_HPP */
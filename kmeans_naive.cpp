@@ -14,25 +14,25 @@
 #include <limits>
 #include <string>
 
-template <typename PointT, typename LabelT, typename MassT>
-char const* Clustering::KmeansNaive<PointT, LabelT, MassT>::name() const {
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
+char const* Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor>::name() const {
 
     return "Lloyd_Naive";
 }
 
 
-template <typename PointT, typename LabelT, typename MassT>
-int Clustering::KmeansNaive<PointT, LabelT, MassT>::initialize() { return 1; }
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
+int Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor>::initialize() { return 1; }
 
-template <typename PointT, typename LabelT, typename MassT>
-int Clustering::KmeansNaive<PointT, LabelT, MassT>::finalize() { return 1; }
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
+int Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor>::finalize() { return 1; }
 
-template <typename PointT, typename LabelT, typename MassT>
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor>
 std::shared_ptr<Measurement::Measurement>
-Clustering::KmeansNaive<PointT, LabelT, MassT>::operator() (
+Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor>::operator() (
         uint32_t const max_iterations,
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids,
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids,
         std::vector<MassT>& cluster_mass,
         std::vector<LabelT>& labels) {
 
@@ -73,7 +73,7 @@ Clustering::KmeansNaive<PointT, LabelT, MassT>::operator() (
         std::fill(cluster_mass.begin(), cluster_mass.end(), 0);
         std::fill(centroids.begin(), centroids.end(), 0);
 
-        cle::Matrix<PointT, std::allocator<PointT>, size_t, true> compensation;
+        cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> compensation;
         compensation.resize(centroids.rows(), centroids.cols());
         std::fill(compensation.begin(), compensation.end(), 0);
 
@@ -107,3 +107,5 @@ Clustering::KmeansNaive<PointT, LabelT, MassT>::operator() (
 
 template class Clustering::KmeansNaive<float, uint32_t, uint32_t>;
 template class Clustering::KmeansNaive<double, uint64_t, uint64_t>;
+template class Clustering::KmeansNaive<float, uint32_t, uint32_t, false>;
+template class Clustering::KmeansNaive<double, uint64_t, uint64_t, false>;
@@ -19,7 +19,7 @@
 
 namespace Clustering {
 
-template <typename PointT, typename LabelT, typename MassT>
+template <typename PointT, typename LabelT, typename MassT, bool ColMajor = true>
 class KmeansNaive {
 public:
     char const* name() const;
@@ -29,8 +29,8 @@ public:
 
     std::shared_ptr<Measurement::Measurement> operator() (
             uint32_t const max_iterations,
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true> const& points,
-            cle::Matrix<PointT, std::allocator<PointT>, size_t, true>& centroids,
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor> const& points,
+            cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>& centroids,
             std::vector<MassT>& cluster_mass,
             std::vector<LabelT>& labels
             );
@@ -45,5 +45,7 @@ using KmeansNaive64 =
 
 extern template class Clustering::KmeansNaive<float, uint32_t, uint32_t>;
 extern template class Clustering::KmeansNaive<double, uint64_t, uint64_t>;
+extern template class Clustering::KmeansNaive<float, uint32_t, uint32_t, false>;
+extern template class Clustering::KmeansNaive<double, uint64_t, uint64_t, false>;
 
 #endif /* KMEANS_NAIVE_HPP */
@@ -199,7 +199,7 @@ public:
 
 private:
     FusedFunction f_fused;
-    MatrixBinaryOp<PointT, MassT> matrix_divide;
+    MatrixBinaryOp<PointT, MassT, ColMajor> matrix_divide;
 
     boost::compute::context context;
     boost::compute::command_queue queue;
@@ -15,6 +15,8 @@
 #include "simple_buffer_cache.hpp"
 #include "single_device_scheduler.hpp"
 #include "buffer_helper.hpp"
+#include "checkpoint.hpp"
+#include "point_storage.hpp"
 #include "cl_kernels/matrix_binary_op.hpp"
 
 #include "measurement/measurement.hpp"
@@ -22,8 +24,11 @@
 
 #include <functional>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include <boost/compute/core.hpp>
 #include <boost/compute/algorithm/copy.hpp>
@@ -48,23 +53,13 @@ public:
 
     void run() {
 
-        buffer_cache = std::make_shared<SimpleBufferCache>(
-                size_t(buffer_size)
-                );
-        this->scheduler.add_buffer_cache(buffer_cache);
-
         this->matrix_divide.prepare(
                 this->context,
                 matrix_divide.Divide
                 );
-
-        this->host_points_partitioned.resize(this->host_points->size());
-        BufferHelper::partition_matrix(
-                this->host_points->data(),
-                &this->host_points_partitioned[0],
-                this->host_points->size() * sizeof(PointT),
-                this->num_features,
-                this->buffer_cache->buffer_size()
+        this->matrix_multiply.prepare(
+                this->context,
+                matrix_multiply.Multiply
                 );
 
         device_old_centroids = decltype(device_old_centroids)(
@@ -92,31 +87,51 @@ public:
                     this->context,
                     this->queue.get_device()
                     ));
-        assert(true ==
-                this->buffer_cache->add_device(
-                    this->context,
-                    this->queue.get_device(),
-                    // TODO: remove this temporary fix
-                    // Underlaying problem is that we try allocate too
-                    // much pinned memory on host in SimpleBufferCache.
-                    // Instead, need to multiplex each pinned buffer among
-                    // multiple device buffers
-                    //
-                    // this->queue.get_device().global_memory_size()
-                    // - 64 * 1024 * 1024
-                    128 * 1024 * 1024
-                    ));
-        auto points_handle = this->buffer_cache->add_object(
-                (void*)this->host_points_partitioned.data(),
-                this->host_points->size() * sizeof(PointT),
-                ObjectMode::ReadOnly
-                );
-        auto labels_handle = this->buffer_cache->add_object(
-                this->host_labels->data(),
-                this->host_labels->size() * sizeof(LabelT),
-                ObjectMode::ReadWrite
+
+        stored_points = store_points(this->host_points);
+        stored_points_bytes = this->host_points->size() * point_size();
+
+        if (requested_buffer_size == 0 and points_file.empty()) {
+            buffer_size = tune_buffer_size();
+
+            // Probe iterations modified the centroids, start over
+            boost::compute::copy(
+                    this->host_centroids->begin(),
+                    this->host_centroids->begin()
+                    + this->num_features * this->num_clusters,
+                    device_old_centroids.begin(),
+                    this->queue);
+        }
+        else {
+            buffer_size = BufferHelper::round_buffer_size(
+                    (requested_buffer_size == 0)
+                    ? size_t(default_buffer_size)
+                    : requested_buffer_size,
+                    this->num_features,
+                    point_size()
+                    );
+        }
+        assert(not points_file_partitioned
+                or buffer_size == requested_buffer_size);
+        // Labels of a buffer must fit into a buffer, reduced points
+        // require enough features
+        assert(label_buffer_size() <= buffer_size);
+        this->measurement->set_parameter(
+                "BufferSize",
+                std::to_string(buffer_size)
                 );
 
+        uint32_t points_handle = 0;
+        uint32_t labels_handle = 0;
+        prepare_buffers(buffer_size, points_handle, labels_handle);
+        batches.assign(1, Batch{
+                stored_points,
+                this->host_labels,
+                points_handle,
+                labels_handle
+                });
+        appended.clear();
+
         // If centroids initializer function is callable, then call
         if (this->centroids_initializer) {
             this->centroids_initializer(
@@ -125,6 +140,42 @@ public:
                     );
         }
 
+        // Resume from latest checkpoint, replacing initial centroids
+        uint32_t iterations = 0;
+        if (checkpoint) {
+            checkpoint->set_points(
+                    this->num_points,
+                    BufferHelper::checksum(
+                        this->host_points->data(),
+                        this->host_points->size() * sizeof(PointT)
+                        )
+                    );
+
+            std::vector<PointT> saved_centroids;
+            std::vector<MassT> saved_masses;
+            uint32_t saved_iteration = 0;
+            if (1 == checkpoint->load(
+                        this->num_features,
+                        this->num_clusters,
+                        saved_iteration,
+                        saved_centroids,
+                        saved_masses
+                        ))
+            {
+                boost::compute::copy(
+                        saved_centroids.begin(),
+                        saved_centroids.end(),
+                        device_old_centroids.begin(),
+                        this->queue);
+                boost::compute::copy(
+                        saved_masses.begin(),
+                        saved_masses.end(),
+                        device_masses.begin(),
+                        this->queue);
+                iterations = saved_iteration + 1;
+            }
+        }
+
         // Wait for all preprocessing steps to finish before
         // starting timer
         this->queue.finish();
@@ -132,127 +183,280 @@ public:
         Timer::Timer total_timer;
         total_timer.start();
 
-        uint32_t iterations = 0;
         while (iterations < this->max_iterations) {
+            iterate(
+                    batches,
+                    *this->measurement,
+                    iterations
+                    );
 
-            boost::compute::event fill_masses_event =
-                boost::compute::fill_async(
-                        device_masses.begin(),
-                        device_masses.end(),
-                        0,
-                        this->queue
-                        )
-                .get_event();
-            boost::compute::event fill_centroids_event =
-                boost::compute::fill_async(
-                        device_new_centroids.begin(),
-                        device_new_centroids.end(),
-                        0,
-                        this->queue
-                        )
-                .get_event();
-
-            auto lambda = [
-                f_fused = this->f_fused,
-                num_features = this->num_features,
-                num_clusters = this->num_clusters,
-                &device_old_centroids = this->device_old_centroids,
-                &device_new_centroids = this->device_new_centroids,
-                &device_masses = this->device_masses
-            ]
-            (
-             boost::compute::command_queue queue,
-             size_t /* cl_offset */,
-             size_t point_bytes,
-             size_t label_bytes,
-             boost::compute::buffer points,
-             boost::compute::buffer labels,
-             boost::compute::wait_list wait_list,
-             Measurement::DataPoint& datapoint
-            )
-            {
-                auto num_buffer_points = label_bytes / sizeof(LabelT);
-
-                boost::compute::buffer_iterator<PointT>
-                    points_begin(
-                            points,
-                            0
-                            ),
-                    points_end(
-                            points,
-                            point_bytes / sizeof(PointT)
-                            );
-
-                boost::compute::buffer_iterator<LabelT>
-                    labels_begin(
-                            labels,
-                            0
-                            ),
-                    labels_end(
-                            labels,
-                            label_bytes / sizeof(LabelT)
-                            );
-
-                return f_fused(
-                        queue,
-                        num_features,
-                        num_buffer_points,
-                        num_clusters,
-                        points_begin,
-                        points_end,
-                        device_old_centroids.begin(),
-                        device_old_centroids.end(),
-                        device_new_centroids.begin(),
-                        device_new_centroids.end(),
-                        labels_begin,
-                        labels_end,
-                        device_masses.begin(),
-                        device_masses.end(),
-                        datapoint,
-                        wait_list
+            if (checkpoint and checkpoint->due(iterations)) {
+                checkpoint->save(
+                        this->queue,
+                        iterations,
+                        this->num_features,
+                        this->num_clusters,
+                        device_old_centroids,
+                        device_masses,
+                        this->measurement->add_datapoint(iterations)
                         );
-            };
+            }
 
-            std::future<std::deque<boost::compute::event>> fu_future;
-            assert(true ==
-                    scheduler.enqueue(
-                        lambda,
-                        points_handle,
-                        labels_handle,
-                        buffer_size,
-                        buffer_size / this->num_features,
-                        fu_future,
-                        this->measurement->add_datapoint(iterations)
-                        ));
+            ++iterations;
+        }
 
-            assert(true == scheduler.run());
+        // Wait for last queue to finish processing
+        this->queue.finish();
+        if (checkpoint) {
+            // Subsequent runs start over instead of resuming this one
+            checkpoint->remove();
+        }
 
-            boost::compute::wait_list division_wait_list;
-            matrix_divide.row(
-                this->queue,
-                this->num_features,
+        uint64_t total_time = total_timer
+            .stop<std::chrono::nanoseconds>();
+        this->measurement->add_datapoint()
+            .set_name("TotalTime")
+            .add_value() = total_time;
+
+        read_results();
+    }
+
+    void set_fused(FusedConfiguration config) {
+        point_storage = config.point_storage;
+        quantization = config.quantization;
+
+        FusedFactory<PointT, LabelT, MassT, ColMajor> factory;
+        f_fused = factory.create(
+                this->context,
+                config,
+                *this->measurement);
+    }
+
+    /*
+     * Stream points from a file in partitioned layout instead of
+     * gathering buffers from host memory. The file is (re-)created from
+     * the host points unless its header matches the buffer size and the
+     * points' checksum.
+     */
+    void set_points_file(std::string file_name) {
+        points_file = file_name;
+    }
+
+    /*
+     * Stream points from an existing file that holds them in partitioned
+     * layout at offset, e.g. a version 2 BinaryFormat file. The file is
+     * never rewritten. Sets the buffer size to chunk_size, which must be
+     * a multiple of the point size.
+     *
+     * The host points are still required, e.g. for the number of points
+     * and checkpoints, thus streaming bounds device memory and transfer
+     * volume, but not host memory.
+     */
+    void set_partitioned_points_file(
+            std::string file_name,
+            size_t offset,
+            size_t chunk_size
+            )
+    {
+        points_file = file_name;
+        points_file_offset = offset;
+        points_file_partitioned = true;
+        requested_buffer_size = chunk_size;
+    }
+
+    /*
+     * Save centroids and masses to file every interval iterations.
+     * If the file exists, the run resumes after the saved iteration.
+     */
+    void set_checkpoint(std::string file_name, uint32_t interval) {
+        checkpoint = std::make_shared<Checkpoint<PointT, MassT>>();
+        checkpoint->set_file(file_name, interval);
+    }
+
+    /*
+     * Append points to the data set of the previous run(). Points are
+     * in the pipeline's layout with the same number of features. The
+     * new points are clustered by the next update(). The pipeline keeps
+     * points and labels alive, as the buffer cache doesn't own them.
+     * With 16-bit point storage, the pipeline keeps a converted copy
+     * instead. Throws std::length_error if the buffer cache's pool has
+     * no slots left for the new points and labels.
+     */
+    void append(
+            std::shared_ptr<const std::vector<PointT>> points,
+            std::shared_ptr<std::vector<LabelT>> labels
+            )
+    {
+        assert(buffer_cache);
+        assert(points->size() % this->num_features == 0);
+
+        // Points and labels of each batch are two objects in the cache
+        size_t const num_objects = 2 * (batches.size() + appended.size() + 1);
+        if (
+                num_objects
+                > this->buffer_cache->max_objects(this->queue.get_device())
+           )
+        {
+            throw std::length_error(
+                    "Buffer cache has no slots left to append points");
+        }
+
+        labels->resize(points->size() / this->num_features);
+
+        Batch batch;
+        batch.points = store_points(points);
+        batch.labels = labels;
+        batch.points_handle = this->buffer_cache->add_strided_object(
+                (void*)batch.points.get(),
+                points->size() * point_size(),
+                partition_dims(),
+                ObjectMode::ReadOnly
+                );
+        assert(batch.points_handle != 0);
+        batch.labels_handle = this->buffer_cache->add_object(
+                labels->data(),
+                labels->size() * sizeof(LabelT),
+                ObjectMode::ReadWrite
+                );
+
+        appended.push_back(batch);
+    }
+
+    /*
+     * Re-cluster after append() without starting over.
+     *
+     * First, runs incremental_iterations over the appended points only.
+     * These start from the centroids and masses of the previous run,
+     * i.e. the previously clustered points keep their labels.
+     * Afterwards, runs full_iterations over all points to refine the
+     * result. Appended points then become part of the data set.
+     */
+    void update(uint32_t incremental_iterations, uint32_t full_iterations) {
+        assert(buffer_cache);
+
+        Timer::Timer update_timer;
+        update_timer.start();
+
+        // Cluster sums are the centroids weighted by their masses
+        device_base_centroids = decltype(device_base_centroids)(
+                this->num_clusters * this->num_features,
+                this->queue.get_context()
+                );
+        device_base_masses = decltype(device_base_masses)(
                 this->num_clusters,
-                device_new_centroids.begin(),
-                device_new_centroids.end(),
+                this->queue.get_context()
+                );
+        boost::compute::copy(
+                device_old_centroids.begin(),
+                device_old_centroids.end(),
+                device_base_centroids.begin(),
+                this->queue
+                );
+        boost::compute::copy(
                 device_masses.begin(),
                 device_masses.end(),
-                this->measurement->add_datapoint(iterations),
-                division_wait_list
+                device_base_masses.begin(),
+                this->queue
+                );
+        boost::compute::wait_list multiply_wait_list;
+        matrix_multiply.row(
+                this->queue,
+                this->num_features,
+                this->num_clusters,
+                device_base_centroids.begin(),
+                device_base_centroids.end(),
+                device_base_masses.begin(),
+                device_base_masses.end(),
+                this->measurement->add_datapoint(),
+                multiply_wait_list
                 );
 
-            std::swap(device_old_centroids, device_new_centroids);
+        uint32_t iterations = 0;
+        for (uint32_t i = 0; i < incremental_iterations; ++i) {
+            iterate(appended, *this->measurement, iterations, true);
+            ++iterations;
+        }
+
+        batches.insert(batches.end(), appended.begin(), appended.end());
+        appended.clear();
+
+        for (uint32_t i = 0; i < full_iterations; ++i) {
+            iterate(batches, *this->measurement, iterations);
             ++iterations;
         }
 
-        // Wait for last queue to finish processing
         this->queue.finish();
 
-        uint64_t total_time = total_timer
+        uint64_t update_time = update_timer
             .stop<std::chrono::nanoseconds>();
         this->measurement->add_datapoint()
-            .set_name("TotalTime")
-            .add_value() = total_time;
+            .set_name("UpdateTime")
+            .add_value() = update_time;
+
+        read_results();
+    }
+
+    /*
+     * Set buffer size in bytes. The size is rounded down to whole points
+     * per feature. If 0, the buffer size is selected by timing one
+     * iteration for each candidate size. Selection is skipped when
+     * streaming from a points file, as each candidate would require
+     * rewriting the file.
+     */
+    void set_buffer_size(size_t size) {
+        requested_buffer_size = size;
+    }
+
+    void set_context(boost::compute::context c) {
+        context = c;
+    }
+
+    void set_queue(boost::compute::command_queue q) {
+        queue = q;
+
+        auto device = q.get_device();
+        this->measurement->set_parameter(
+                "FusedPlatform",
+                device.platform().name()
+                );
+        this->measurement->set_parameter(
+                "FusedDevice",
+                device.name()
+                );
+    }
 
+private:
+    static constexpr size_t default_buffer_size = 16ul * 1024ul * 1024ul;
+
+    // TODO: remove this temporary fix
+    // Underlaying problem is that we try allocate too
+    // much pinned memory on host in SimpleBufferCache.
+    // Instead, need to multiplex each pinned buffer among
+    // multiple device buffers
+    //
+    // this->queue.get_device().global_memory_size()
+    // - 64 * 1024 * 1024
+    static constexpr size_t pool_size = 128ul * 1024ul * 1024ul;
+
+    // Buffers of the largest candidate size that probe each candidate
+    static constexpr size_t probe_buffers = 4;
+
+    /*
+     * Points and labels registered with the buffer cache. Points are in
+     * the storage format, see store_points().
+     */
+    struct Batch {
+        std::shared_ptr<void const> points;
+        std::shared_ptr<std::vector<LabelT>> labels;
+        uint32_t points_handle;
+        uint32_t labels_handle;
+    };
+
+    /*
+     * Copy centroids and masses to host and read back the labels of all
+     * clustered points.
+     */
+    void read_results() {
         boost::compute::event centroids_copy_event = boost::compute::copy_async(
                 this->device_old_centroids.begin(),
                 this->device_old_centroids.begin() + this->num_features * this->num_clusters,
@@ -269,12 +473,12 @@ public:
                 ).get_event();
         masses_copy_event.wait();
 
-        {
+        for (Batch const& batch : batches) {
             char *begin, *iter, *end;
-            size_t labels_content_size = buffer_size / this->num_features;
+            size_t labels_content_size = label_buffer_size();
             for (
-                    begin = (char*) this->host_labels->data(),
-                    end = begin + this->host_labels->size() * sizeof(LabelT),
+                    begin = (char*) batch.labels->data(),
+                    end = begin + batch.labels->size() * sizeof(LabelT),
                     iter = begin;
                     iter < end;
                     iter += labels_content_size
@@ -290,7 +494,7 @@ public:
                 assert(true ==
                         buffer_cache->read(
                             this->queue,
-                            labels_handle,
+                            batch.labels_handle,
                             iter,
                             iter_step,
                             labels_read_event,
@@ -303,48 +507,425 @@ public:
         this->queue.finish();
     }
 
-    void set_fused(FusedConfiguration config) {
-        FusedFactory<PointT, LabelT, MassT, ColMajor> factory;
-        f_fused = factory.create(
-                this->context,
-                config,
-                *this->measurement);
+    /*
+     * Number of columns to partition the points by. Column-major points
+     * are gathered per feature, row-major points are split as a whole,
+     * as each buffer then holds whole points.
+     */
+    size_t partition_dims() const {
+        return (ColMajor) ? this->num_features : 1;
     }
 
-    void set_context(boost::compute::context c) {
-        context = c;
+    /*
+     * Size in bytes of a point value in buffers.
+     */
+    size_t point_size() const {
+        return PointStorageHelper::value_size(point_storage, sizeof(PointT));
     }
 
-    void set_queue(boost::compute::command_queue q) {
-        queue = q;
+    /*
+     * Bytes of labels that belong to a full buffer of points.
+     */
+    size_t label_buffer_size() const {
+        return buffer_size / this->num_features / point_size()
+            * sizeof(LabelT);
+    }
 
-        auto device = q.get_device();
-        this->measurement->set_parameter(
-                "FusedPlatform",
-                device.platform().name()
+    /*
+     * Convert points to the storage format. Returns a pointer to the
+     * stored values, which keeps them alive. Native points are not
+     * copied.
+     */
+    std::shared_ptr<void const> store_points(
+            std::shared_ptr<const std::vector<PointT>> points
+            ) const
+    {
+        switch (point_storage) {
+        case PointStorage::Half:
+            return convert_points<Half>(*points);
+        case PointStorage::BFloat16:
+            return convert_points<BFloat16>(*points);
+        case PointStorage::Int8:
+            return quantize_points(*points);
+        default:
+            return std::shared_ptr<void const>(points, points->data());
+        }
+    }
+
+    template <typename StoreT>
+    static std::shared_ptr<void const> convert_points(
+            std::vector<PointT> const& points
+            )
+    {
+        auto stored = std::make_shared<std::vector<StoreT>>(
+                points.begin(),
+                points.end()
                 );
-        this->measurement->set_parameter(
-                "FusedDevice",
-                device.name()
+        return std::shared_ptr<void const>(stored, stored->data());
+    }
+
+    std::shared_ptr<void const> quantize_points(
+            std::vector<PointT> const& points
+            ) const
+    {
+        size_t const num_points = points.size() / this->num_features;
+        auto stored = std::make_shared<std::vector<uint8_t>>(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            size_t const feature = (ColMajor)
+                ? i / num_points
+                : i % this->num_features
+                ;
+            (*stored)[i] = quantization.quantize(points[i], feature);
+        }
+        return std::shared_ptr<void const>(stored, stored->data());
+    }
+
+    /*
+     * Create a new buffer cache with buffer_size and register points
+     * and labels with it.
+     */
+    void prepare_buffers(
+            size_t buffer_size,
+            uint32_t& points_handle,
+            uint32_t& labels_handle
+            )
+    {
+        buffer_cache = std::make_shared<SimpleBufferCache>(buffer_size);
+        this->scheduler.add_buffer_cache(buffer_cache);
+
+        size_t const points_bytes = stored_points_bytes;
+        // The file's layout depends on the buffer size, reuse the file
+        // only if it was written with the same buffer size and points
+        size_t data_offset = points_file_offset;
+        if (not points_file.empty() and not points_file_partitioned) {
+            if (BufferHelper::check_partitioned_matrix(
+                        stored_points.get(),
+                        points_file.c_str(),
+                        points_bytes,
+                        partition_dims(),
+                        this->buffer_cache->buffer_size()
+                        ) < 0
+                    and BufferHelper::write_partitioned_matrix(
+                        stored_points.get(),
+                        points_file.c_str(),
+                        points_bytes,
+                        partition_dims(),
+                        this->buffer_cache->buffer_size()
+                        ) < 0)
+            {
+                throw std::runtime_error(
+                        "Cannot write points file " + points_file);
+            }
+            data_offset = BufferHelper::partitioned_header_size;
+        }
+
+        assert(true ==
+                this->buffer_cache->add_device(
+                    this->context,
+                    this->queue.get_device(),
+                    pool_size
+                    ));
+        if (points_file.empty()) {
+            // Gather buffers from the points on the fly
+            points_handle = this->buffer_cache->add_strided_object(
+                    (void*)stored_points.get(),
+                    points_bytes,
+                    partition_dims(),
+                    ObjectMode::ReadOnly
+                    );
+        }
+        else {
+            points_handle = this->buffer_cache->add_file_object(
+                    points_file.c_str(),
+                    data_offset,
+                    points_bytes,
+                    ObjectMode::ReadOnly
+                    );
+            if (points_handle == 0) {
+                throw std::runtime_error(
+                        "Cannot open points file " + points_file);
+            }
+        }
+        assert(points_handle != 0);
+        labels_handle = this->buffer_cache->add_object(
+                this->host_labels->data(),
+                this->host_labels->size() * sizeof(LabelT),
+                ObjectMode::ReadWrite
                 );
     }
 
-private:
-    static constexpr size_t buffer_size = 16ul * 1024ul * 1024ul;
+    /*
+     * Time one iteration over a prefix of the points for each candidate
+     * buffer size, starting with a cold cache so that transfers are
+     * included, and return the fastest size. The prefix spans
+     * probe_buffers buffers of the largest candidate, thus probing costs
+     * a bounded number of transfers instead of full passes.
+     */
+    size_t tune_buffer_size() {
+
+        // Points and labels are each double buffered
+        auto candidates = BufferHelper::buffer_size_candidates(
+                stored_points_bytes,
+                this->num_features,
+                point_size(),
+                pool_size / 4
+                );
+
+        Measurement::Measurement probe_measurement;
+        size_t best_size = BufferHelper::round_buffer_size(
+                default_buffer_size,
+                this->num_features,
+                point_size()
+                );
+        uint64_t best_time = std::numeric_limits<uint64_t>::max();
+        if (candidates.empty()) {
+            return best_size;
+        }
+
+        size_t const num_probe = std::min(
+                this->num_points,
+                probe_buffers * candidates.back()
+                / (this->num_features * point_size())
+                );
+        auto probe_points = points_prefix(num_probe);
+        auto probe_labels = std::make_shared<std::vector<LabelT>>(num_probe);
+
+        for (size_t candidate : candidates) {
+            buffer_size = candidate;
+            buffer_cache = std::make_shared<SimpleBufferCache>(candidate);
+            this->scheduler.add_buffer_cache(buffer_cache);
+            assert(true ==
+                    this->buffer_cache->add_device(
+                        this->context,
+                        this->queue.get_device(),
+                        pool_size
+                        ));
+            uint32_t points_handle = this->buffer_cache->add_strided_object(
+                    (void*)probe_points.get(),
+                    num_probe * this->num_features * point_size(),
+                    partition_dims(),
+                    ObjectMode::ReadOnly
+                    );
+            uint32_t labels_handle = this->buffer_cache->add_object(
+                    probe_labels->data(),
+                    probe_labels->size() * sizeof(LabelT),
+                    ObjectMode::ReadWrite
+                    );
+            this->queue.finish();
+
+            Timer::Timer probe_timer;
+            probe_timer.start();
+
+            iterate(
+                    std::vector<Batch>{Batch{
+                        probe_points,
+                        probe_labels,
+                        points_handle,
+                        labels_handle
+                    }},
+                    probe_measurement,
+                    0
+                    );
+            this->queue.finish();
+
+            uint64_t probe_time = probe_timer
+                .stop<std::chrono::nanoseconds>();
+            this->measurement->add_datapoint()
+                .set_name("BufferSizeProbe")
+                .add_value() = probe_time;
+
+            if (probe_time < best_time) {
+                best_time = probe_time;
+                best_size = candidate;
+            }
+        }
+
+        return best_size;
+    }
+
+    /*
+     * Copy of the first num_prefix stored points in the same layout.
+     */
+    std::shared_ptr<void const> points_prefix(size_t num_prefix) const {
+        size_t const columns = partition_dims();
+        size_t const column_bytes = stored_points_bytes / columns;
+        size_t const prefix_bytes =
+            num_prefix * this->num_features * point_size() / columns;
+        char const* stored = static_cast<char const*>(stored_points.get());
+
+        auto prefix = std::make_shared<std::vector<char>>(
+                columns * prefix_bytes);
+        for (size_t c = 0; c < columns; ++c) {
+            std::copy(
+                    stored + c * column_bytes,
+                    stored + c * column_bytes + prefix_bytes,
+                    prefix->begin() + c * prefix_bytes
+                    );
+        }
+        return std::shared_ptr<void const>(prefix, prefix->data());
+    }
+
+    /*
+     * Run one iteration over batches. If incremental, cluster sums start
+     * from the sums of the previously clustered points instead of zero.
+     */
+    void iterate(
+            std::vector<Batch> const& batches,
+            Measurement::Measurement& measurement,
+            uint32_t iteration,
+            bool incremental = false
+            )
+    {
+        if (incremental) {
+            boost::compute::copy_async(
+                    device_base_masses.begin(),
+                    device_base_masses.end(),
+                    device_masses.begin(),
+                    this->queue
+                    );
+            boost::compute::copy_async(
+                    device_base_centroids.begin(),
+                    device_base_centroids.end(),
+                    device_new_centroids.begin(),
+                    this->queue
+                    );
+        }
+        else {
+            boost::compute::fill_async(
+                    device_masses.begin(),
+                    device_masses.end(),
+                    0,
+                    this->queue
+                    );
+            boost::compute::fill_async(
+                    device_new_centroids.begin(),
+                    device_new_centroids.end(),
+                    0,
+                    this->queue
+                    );
+        }
+
+        auto lambda = [
+            f_fused = this->f_fused,
+            num_features = this->num_features,
+            num_clusters = this->num_clusters,
+            &device_old_centroids = this->device_old_centroids,
+            &device_new_centroids = this->device_new_centroids,
+            &device_masses = this->device_masses
+        ]
+        (
+         boost::compute::command_queue queue,
+         size_t /* cl_offset */,
+         size_t /* point_bytes */,
+         size_t label_bytes,
+         boost::compute::buffer points,
+         boost::compute::buffer labels,
+         boost::compute::wait_list wait_list,
+         Measurement::DataPoint& datapoint
+        )
+        {
+            auto num_buffer_points = label_bytes / sizeof(LabelT);
+
+            boost::compute::buffer_iterator<PointT>
+                points_begin(
+                        points,
+                        0
+                        ),
+                points_end(
+                        points,
+                        num_buffer_points * num_features
+                        );
+
+            boost::compute::buffer_iterator<LabelT>
+                labels_begin(
+                        labels,
+                        0
+                        ),
+                labels_end(
+                        labels,
+                        label_bytes / sizeof(LabelT)
+                        );
+
+            return f_fused(
+                    queue,
+                    num_features,
+                    num_buffer_points,
+                    num_clusters,
+                    points_begin,
+                    points_end,
+                    device_old_centroids.begin(),
+                    device_old_centroids.end(),
+                    device_new_centroids.begin(),
+                    device_new_centroids.end(),
+                    labels_begin,
+                    labels_end,
+                    device_masses.begin(),
+                    device_masses.end(),
+                    datapoint,
+                    wait_list
+                    );
+        };
+
+        for (Batch const& batch : batches) {
+            std::future<std::deque<boost::compute::event>> fu_future;
+            assert(true ==
+                    scheduler.enqueue(
+                        lambda,
+                        batch.points_handle,
+                        batch.labels_handle,
+                        buffer_size,
+                        label_buffer_size(),
+                        fu_future,
+                        measurement.add_datapoint(iteration)
+                        ));
+        }
+
+        assert(true == scheduler.run());
+
+        boost::compute::wait_list division_wait_list;
+        matrix_divide.row(
+            this->queue,
+            this->num_features,
+            this->num_clusters,
+            device_new_centroids.begin(),
+            device_new_centroids.end(),
+            device_masses.begin(),
+            device_masses.end(),
+            measurement.add_datapoint(iteration),
+            division_wait_list
+            );
+
+        std::swap(device_old_centroids, device_new_centroids);
+    }
+
 
     FusedFunction f_fused;
+    PointStorage point_storage = PointStorage::Native;
+    Quantization quantization;
+    std::shared_ptr<void const> stored_points;
+    size_t stored_points_bytes = 0;
 
     boost::compute::context context;
     boost::compute::command_queue queue;
 
-    typename AbstractKmeans<PointT, LabelT, MassT, ColMajor>::template HostVector<PointT> host_points_partitioned;
+    size_t requested_buffer_size = default_buffer_size;
+    size_t buffer_size = default_buffer_size;
+    std::string points_file;
+    size_t points_file_offset = 0;
+    bool points_file_partitioned = false;
+    std::shared_ptr<Checkpoint<PointT, MassT>> checkpoint;
     std::shared_ptr<SimpleBufferCache> buffer_cache;
+    std::vector<Batch> batches;
+    std::vector<Batch> appended;
     SingleDeviceScheduler scheduler;
-    MatrixBinaryOp<PointT, MassT> matrix_divide;
+    MatrixBinaryOp<PointT, MassT, ColMajor> matrix_divide;
+    MatrixBinaryOp<PointT, MassT, ColMajor> matrix_multiply;
 
     boost::compute::vector<PointT> device_old_centroids;
     boost::compute::vector<PointT> device_new_centroids;
     boost::compute::vector<MassT> device_masses;
+    boost::compute::vector<PointT> device_base_centroids;
+    boost::compute::vector<MassT> device_base_masses;
 };
 
 }
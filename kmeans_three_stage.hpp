@@ -67,7 +67,7 @@ public:
 
         boost::compute::wait_list ll_wait_list, mu_wait_list, cu_wait_list;
         boost::compute::wait_list sync_labels_wait_list, sync_centroids_wait_list, sync_masses_wait_list;
-        Event ll_event, mu_event, cu_event;
+        Event ll_event, mu_event, cu_event, division_event;
         Event sync_labels_event, sync_centroids_event, sync_masses_event;
 
         buffer_map.set_queues(
@@ -116,13 +116,43 @@ public:
         uint32_t iterations = 0;
         while (iterations < this->max_iterations) {
 
+            // Events of the previous iteration
+            Event ll_prev_event = ll_event;
+            Event mu_prev_event = mu_event;
+            Event cu_prev_event = cu_event;
+            Event division_prev_event = division_event;
+            Event sync_masses_prev_event = sync_masses_event;
+
             // execute labeling
+            sync_centroids_wait_list.clear();
+            buffer_map.depend(
+                    BufferMap::ll,
+                    division_prev_event,
+                    sync_centroids_wait_list);
+            buffer_map.depend(
+                    BufferMap::ll,
+                    ll_prev_event,
+                    sync_centroids_wait_list);
             sync_centroids_event = buffer_map.sync_centroids(
                     this->measurement->add_datapoint(iterations),
                     sync_centroids_wait_list);
-            // TODO
-            // ll_wait_list.insert(
-            //         sync_centroids_event);
+
+            // Labels must not be overwritten while still in use
+            ll_wait_list.clear();
+            buffer_map.depend(
+                    BufferMap::ll,
+                    (sync_centroids_event == Event())
+                    ? division_prev_event
+                    : sync_centroids_event,
+                    ll_wait_list);
+            buffer_map.depend(
+                    BufferMap::ll,
+                    mu_prev_event,
+                    ll_wait_list);
+            buffer_map.depend(
+                    BufferMap::ll,
+                    cu_prev_event,
+                    ll_wait_list);
             ll_event = this->f_labeling(
                     this->q_labeling,
                     this->num_features,
@@ -139,32 +169,67 @@ public:
 
             if (/* not converged */ true) {
 
-                boost::compute::event fill_masses_event =
-                    boost::compute::fill_async(
-                            buffer_map.get_masses(BufferMap::mu).begin(),
-                            buffer_map.get_masses(BufferMap::mu).end(),
-                            0,
-                            this->q_mass_update
-                            )
-                    .get_event();
-                boost::compute::event fill_centroids_event =
-                    boost::compute::fill_async(
-                            buffer_map.get_centroids(BufferMap::cu).begin(),
-                            buffer_map.get_centroids(BufferMap::cu).end(),
-                            0,
-                            this->q_centroid_update
-                            )
-                    .get_event();
+                boost::compute::wait_list fill_masses_wait_list;
+                buffer_map.depend(
+                        BufferMap::mu,
+                        mu_prev_event,
+                        fill_masses_wait_list);
+                buffer_map.depend(
+                        BufferMap::mu,
+                        sync_masses_prev_event,
+                        fill_masses_wait_list);
+                if (buffer_map.device_map[BufferMap::mu][BufferMap::cu]) {
+                    buffer_map.depend(
+                            BufferMap::mu,
+                            division_prev_event,
+                            fill_masses_wait_list);
+                }
+                Event fill_masses_event =
+                    buffer_map.fill_masses(fill_masses_wait_list);
+
+                boost::compute::wait_list fill_centroids_wait_list;
+                buffer_map.depend(
+                        BufferMap::cu,
+                        division_prev_event,
+                        fill_centroids_wait_list);
+                if (buffer_map.device_map[BufferMap::cu][BufferMap::ll]) {
+                    buffer_map.depend(
+                            BufferMap::cu,
+                            ll_event,
+                            fill_centroids_wait_list);
+                }
+                Event fill_centroids_event =
+                    buffer_map.fill_centroids(fill_centroids_wait_list);
 
                 // execute mass update
+                sync_labels_wait_list.clear();
+                buffer_map.depend(
+                        BufferMap::ll,
+                        ll_event,
+                        sync_labels_wait_list);
+                buffer_map.depend(
+                        BufferMap::mu,
+                        mu_prev_event,
+                        sync_labels_wait_list);
+                buffer_map.depend(
+                        BufferMap::cu,
+                        cu_prev_event,
+                        sync_labels_wait_list);
                 sync_labels_event = buffer_map.sync_labels(
                         this->measurement->add_datapoint(iterations),
                         sync_labels_wait_list);
-                // TODO
-                // mu_wait_list.insert(
-                //         sync_labels_event);
-                // cu_wait_list.insert(
-                //         sync_labels_event);
+
+                mu_wait_list.clear();
+                buffer_map.depend(
+                        BufferMap::mu,
+                        (buffer_map.device_map[BufferMap::mu][BufferMap::ll])
+                        ? ll_event
+                        : sync_labels_event,
+                        mu_wait_list);
+                buffer_map.depend(
+                        BufferMap::mu,
+                        fill_masses_event,
+                        mu_wait_list);
                 mu_event = this->f_mass_update(
                         this->q_mass_update,
                         this->num_points,
@@ -175,16 +240,43 @@ public:
                         buffer_map.get_masses(BufferMap::mu).end(),
                         this->measurement->add_datapoint(iterations),
                         mu_wait_list);
-                // TODO
-                // sync_masses_wait_list.insert(
-                //         mu_event);
 
                 // execute centroid update
+                sync_masses_wait_list.clear();
+                buffer_map.depend(
+                        BufferMap::mu,
+                        mu_event,
+                        sync_masses_wait_list);
+                buffer_map.depend(
+                        BufferMap::cu,
+                        division_prev_event,
+                        sync_masses_wait_list);
                 sync_masses_event = buffer_map.sync_masses(
                         sync_masses_wait_list);
-                // TODO
-                // cu_wait_list.insert(
-                //         sync_masses_event);
+
+                cu_wait_list.clear();
+                if (buffer_map.device_map[BufferMap::cu][BufferMap::ll]) {
+                    buffer_map.depend(
+                            BufferMap::cu,
+                            ll_event,
+                            cu_wait_list);
+                }
+                else {
+                    buffer_map.depend(
+                            BufferMap::cu,
+                            sync_labels_event,
+                            cu_wait_list);
+                }
+                buffer_map.depend(
+                        BufferMap::cu,
+                        (buffer_map.device_map[BufferMap::cu][BufferMap::mu])
+                        ? mu_event
+                        : sync_masses_event,
+                        cu_wait_list);
+                buffer_map.depend(
+                        BufferMap::cu,
+                        fill_centroids_event,
+                        cu_wait_list);
                 cu_event = this->f_centroid_update(
                         this->q_centroid_update,
                         this->num_features,
@@ -200,12 +292,9 @@ public:
                         buffer_map.get_masses(BufferMap::cu).end(),
                         this->measurement->add_datapoint(iterations),
                         cu_wait_list);
-                // TODO
-                // sync_centroids_wait_list.insert(
-                //         cu_event);
 
-                boost::compute::wait_list division_wait_list;
-                matrix_divide.row(
+                boost::compute::wait_list division_wait_list(cu_event);
+                division_event = matrix_divide.row(
                         this->q_centroid_update,
                         this->num_features,
                         this->num_clusters,
@@ -221,7 +310,9 @@ public:
             ++iterations;
         }
 
-        // Wait for last queue to finish processing
+        // Wait for all queues to finish processing
+        this->q_labeling.finish();
+        this->q_mass_update.finish();
         this->q_centroid_update.finish();
 
         uint64_t total_time = total_timer
@@ -324,7 +415,7 @@ private:
     LabelingFunction f_labeling;
     MassUpdateFunction f_mass_update;
     CentroidUpdateFunction f_centroid_update;
-    MatrixBinaryOp<PointT, MassT> matrix_divide;
+    MatrixBinaryOp<PointT, MassT, ColMajor> matrix_divide;
 
     boost::compute::context context_labeling;
     boost::compute::context context_mass_update;
@@ -570,14 +661,17 @@ private:
 
         Event sync_centroids(
                 Measurement::DataPoint& datapoint,
-                boost::compute::wait_list const& /* wait_list */
+                boost::compute::wait_list const& wait_list
                 )
         {
             using Device = boost::compute::device;
 
             datapoint.set_name("SyncCentroids");
 
+            Event e;
             if (not device_map[cu][ll]) {
+                wait_all(wait_list);
+
                 size_t num_elements = num_clusters * num_features;
                 Future copy_future;
                 if (queue[cu].get_device().type() == Device::cpu) {
@@ -614,21 +708,28 @@ private:
                 }
 
                 datapoint.add_event() = copy_future.get_event();
+                e = copy_future.get_event();
             }
 
-            Event e;
             return e;
         }
 
         Event sync_labels(
                 Measurement::DataPoint& datapoint,
-                boost::compute::wait_list const& /* wait_list */
+                boost::compute::wait_list const& wait_list
                 )
         {
             using Device = boost::compute::device;
 
             datapoint.set_name("SyncLabels");
 
+            Event e;
+            if (not device_map[ll][mu]
+                    or (not device_map[ll][cu] && not device_map[mu][cu]))
+            {
+                wait_all(wait_list);
+            }
+
             if (not device_map[ll][mu]) {
                 Event sync_event;
                 auto dev_type = queue[mu].get_device().type();
@@ -678,6 +779,7 @@ private:
                 }
 
                 datapoint.add_event() = sync_event;
+                e = sync_event;
             }
 
             if (not device_map[ll][cu] && not device_map[mu][cu]) {
@@ -707,7 +809,7 @@ private:
                             buf_ptr);
                 }
                 else {
-                    boost::compute::copy(
+                    copy_future = boost::compute::copy_async(
                             labels[ll]->begin(),
                             labels[ll]->end(),
                             labels[cu]->begin(),
@@ -717,26 +819,94 @@ private:
                 }
 
                 datapoint.add_event() = copy_future.get_event();
+                e = copy_future.get_event();
             }
 
-            Event e;
             return e;
         }
 
-        Event sync_masses(boost::compute::wait_list const& /* wait_list */)
+        Event sync_masses(boost::compute::wait_list const& wait_list)
         {
+            Event e;
             if (not device_map[mu][cu]) {
-                boost::compute::copy(
+                wait_all(wait_list);
+
+                Future copy_future = boost::compute::copy_async(
                         masses[mu]->begin(),
                         masses[mu]->begin() + num_clusters,
                         masses[cu]->begin(),
                         queue[cu]);
+
+                copy_future.wait();
+                e = copy_future.get_event();
             }
 
-            Event e;
             return e;
         }
 
+        Event fill_masses(boost::compute::wait_list const& wait_list)
+        {
+            MassT const zero = 0;
+
+            return queue[mu].enqueue_fill_buffer(
+                    masses[mu]->get_buffer(),
+                    &zero,
+                    sizeof(zero),
+                    0,
+                    masses[mu]->size() * sizeof(MassT),
+                    wait_list);
+        }
+
+        Event fill_centroids(boost::compute::wait_list const& wait_list)
+        {
+            PointT const zero = 0;
+
+            return queue[cu].enqueue_fill_buffer(
+                    centroids[cu]->get_buffer(),
+                    &zero,
+                    sizeof(zero),
+                    0,
+                    centroids[cu]->size() * sizeof(PointT),
+                    wait_list);
+        }
+
+        /*
+         * Make commands of phase p depend on event. OpenCL wait lists
+         * can't contain events of other contexts, so the host waits
+         * for these instead. Null events are ignored.
+         */
+        void depend(
+                Phase p,
+                Event const& event,
+                boost::compute::wait_list& wait_list
+                )
+        {
+            if (event == Event()) {
+                return;
+            }
+
+            if (event.get_info<cl_context>(CL_EVENT_CONTEXT)
+                    == context[p].get())
+            {
+                wait_list.insert(event);
+            }
+            else {
+                event.wait();
+            }
+        }
+
+        /*
+         * Wait on host for events, which may belong to different
+         * contexts. In contrast, wait_list::wait() requires all events
+         * to belong to the same context.
+         */
+        static void wait_all(boost::compute::wait_list const& wait_list)
+        {
+            for (auto const& event : wait_list) {
+                event.wait();
+            }
+        }
+
         void shrink_centroids() {
             for (auto& buf : centroids) {
                 if (buf) {
@@ -24,6 +24,10 @@ struct LabelingConfiguration {
     size_t vector_length;
     size_t unroll_clusters_length;
     size_t unroll_features_length;
+    // Defaults match lloyd_labeling_tiled.cl
+    size_t tile_features = 256;
+    size_t tile_clusters = 8;
+    bool autotune = false;
 };
 
 }
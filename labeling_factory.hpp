@@ -12,12 +12,16 @@
 
 #include "labeling_configuration.hpp"
 #include "measurement/measurement.hpp"
+#include "online_tuner.hpp"
 
 #include "cl_kernels/labeling_unroll_vector.hpp"
+#include "cl_kernels/labeling_tiled.hpp"
+#include "cl_kernels/labeling_tiled_async.hpp"
 
 #include <functional>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 #include <boost/compute/core.hpp>
 #include <boost/compute/iterator/buffer_iterator.hpp>
@@ -52,6 +56,10 @@ public:
             LabelingConfiguration config,
             Measurement::Measurement& measurement) {
 
+        if (config.autotune) {
+            return create_autotuned(context, config, measurement);
+        }
+
         measurement.set_parameter(
                 "LabelingGlobalSize",
                 std::to_string(config.global_size[0])
@@ -79,10 +87,67 @@ public:
             strategy.prepare(context, config);
             return strategy;
         }
+        else if (config.strategy == "tiled") {
+            measurement.set_parameter(
+                    "LabelingTileFeatures",
+                    std::to_string(config.tile_features)
+                    );
+            measurement.set_parameter(
+                    "LabelingTileClusters",
+                    std::to_string(config.tile_clusters)
+                    );
+
+            LabelingTiled<PointT, LabelT, ColMajor> strategy;
+            strategy.prepare(context, config);
+            return strategy;
+        }
+        else if (config.strategy == "tiled_async") {
+            measurement.set_parameter(
+                    "LabelingTileFeatures",
+                    std::to_string(config.tile_features)
+                    );
+            measurement.set_parameter(
+                    "LabelingTileClusters",
+                    std::to_string(config.tile_clusters)
+                    );
+
+            LabelingTiledAsync<PointT, LabelT, ColMajor> strategy;
+            strategy.prepare(context, config);
+            return strategy;
+        }
         else {
             throw std::invalid_argument(config.strategy);
         }
     }
+
+private:
+    /*
+     * Try launch configurations around the configured one in the first
+     * iterations, and continue with the fastest
+     */
+    LabelingFunction create_autotuned(
+            boost::compute::context context,
+            LabelingConfiguration config,
+            Measurement::Measurement& measurement) {
+
+        config.autotune = false;
+        std::vector<LabelingConfiguration> configs = launch_variants(
+                config,
+                context.get_device().max_work_group_size());
+
+        // Only the configured variant's parameters are recorded
+        Measurement::Measurement variants_measurement;
+        std::vector<LabelingFunction> variants;
+        variants.push_back(create(context, configs[0], measurement));
+        for (size_t v = 1; v < configs.size(); ++v) {
+            variants.push_back(
+                    create(context, configs[v], variants_measurement));
+        }
+
+        measurement.set_parameter("LabelingAutotune", "true");
+
+        return OnlineTuner<LabelingFunction>(std::move(variants));
+    }
 };
 
 }
@@ -114,7 +114,7 @@ public:
                 << std::endl;
         }
 #endif
-        return raw_[x_dim_ * y + x];
+        return raw_[index(x, y)];
     }
 
     inline T const& operator() (INT const x, INT const y) const {
@@ -126,7 +126,7 @@ public:
                 << std::endl;
         }
 #endif
-        return raw_[x_dim_ * y + x];
+        return raw_[index(x, y)];
     }
 
     inline INT size() const {
@@ -142,6 +142,12 @@ public:
     }
 
 private:
+    inline size_t index(INT const x, INT const y) const {
+        return (COL_MAJOR)
+            ? (size_t) x_dim_ * y + x
+            : (size_t) y_dim_ * x + y;
+    }
+
     std::vector<T, Talloc> raw_;
     INT x_dim_;
     INT y_dim_;
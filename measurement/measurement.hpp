@@ -51,6 +51,10 @@ public:
         return children_.back();
     }
 
+    inline std::deque<Event> const& get_events() const {
+        return events_;
+    }
+
 private:
     inline DataPoint()
         :
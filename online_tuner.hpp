@@ -0,0 +1,195 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef ONLINE_TUNER_HPP
+#define ONLINE_TUNER_HPP
+
+#include "measurement/measurement.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <boost/compute/core.hpp>
+
+namespace Clustering {
+
+/*
+ * Launch configurations with half, equal and double global and local
+ * sizes, starting with the given configuration
+ *
+ * Omits local sizes beyond the device's limit, and global sizes that are
+ * not a multiple of the local size.
+ */
+template <typename Configuration>
+std::vector<Configuration> launch_variants(
+        Configuration const& config,
+        size_t max_local_size
+        )
+{
+    std::vector<Configuration> variants(1, config);
+
+    size_t const global_size = config.global_size[0];
+    size_t const local_size = config.local_size[0];
+
+    for (size_t g : {global_size / 2, global_size, global_size * 2}) {
+        for (size_t l : {local_size / 2, local_size, local_size * 2}) {
+            if (g == global_size && l == local_size) {
+                continue;
+            }
+            if (l == 0 || l > max_local_size || g < l || g % l != 0) {
+                continue;
+            }
+
+            Configuration variant = config;
+            variant.global_size[0] = g;
+            variant.local_size[0] = l;
+            variants.push_back(variant);
+        }
+    }
+
+    return variants;
+}
+
+/*
+ * Selects the fastest of several variants of a strategy during a run
+ *
+ * The first calls try each variant once, and time them by the events
+ * that the variant adds to its data point. Buffered pipelines call the
+ * variants once per buffer, and the last buffer may hold fewer points,
+ * thus times are compared per point. Afterwards, the fastest variant
+ * runs all remaining calls. The choice is kept in subsequent
+ * runs, thus only the first iterations of the first run pay for tuning.
+ *
+ * Variants that fail to launch, e.g. due to exceeding the device's
+ * resources, are skipped. The first variant should be the configured
+ * one, and its errors are passed on. It is also kept if the queue does
+ * not enable profiling.
+ */
+template <typename Function>
+class OnlineTuner {
+public:
+    using Event = boost::compute::event;
+
+    OnlineTuner(std::vector<Function> variants) :
+        state(std::make_shared<State>())
+    {
+        assert(not variants.empty());
+
+        this->state->variants = std::move(variants);
+        this->state->events.resize(this->state->variants.size());
+        this->state->failed.resize(this->state->variants.size(), false);
+        this->state->num_points.resize(this->state->variants.size(), 0);
+    }
+
+    /*
+     * Arguments are those of the variants. As in all strategies, the
+     * number of points must be the third argument and the data point
+     * the second to last argument.
+     */
+    template <typename... Args>
+    Event operator() (Args&&... args) {
+        State& s = *this->state;
+
+        while (s.next_trial < s.variants.size()) {
+            Measurement::DataPoint& datapoint =
+                std::get<sizeof...(Args) - 2>(std::tie(args...));
+            size_t const v = s.next_trial;
+            size_t const first_event = datapoint.get_events().size();
+
+            ++s.next_trial;
+            s.num_points[v] = std::get<2>(std::tie(args...));
+            try {
+                Event event = s.variants[v](args...);
+
+                auto const& events = datapoint.get_events();
+                s.events[v].assign(
+                        events.begin() + first_event,
+                        events.end());
+
+                return event;
+            }
+            catch (boost::compute::opencl_error const&) {
+                if (v == 0) {
+                    throw;
+                }
+                s.failed[v] = true;
+            }
+        }
+
+        if (s.chosen == NONE) {
+            choose();
+        }
+
+        return s.variants[s.chosen](args...);
+    }
+
+private:
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    struct State {
+        std::vector<Function> variants;
+        std::vector<std::vector<Event>> events;
+        std::vector<bool> failed;
+        std::vector<size_t> num_points;
+        size_t next_trial = 0;
+        size_t chosen = NONE;
+    };
+
+    void choose() {
+        State& s = *this->state;
+
+        double min_time = std::numeric_limits<double>::max();
+        for (size_t v = 0; v < s.variants.size(); ++v) {
+            if (s.failed[v]) {
+                continue;
+            }
+
+            uint64_t time = 0;
+            try {
+                for (Event& event : s.events[v]) {
+                    event.wait();
+                    time +=
+                        event.get_profiling_info<uint64_t>(
+                                Event::profiling_command_end)
+                        - event.get_profiling_info<uint64_t>(
+                                Event::profiling_command_start);
+                }
+            }
+            catch (boost::compute::opencl_error const&) {
+                // Queue without profiling, keep the configured variant
+                s.chosen = 0;
+                break;
+            }
+
+            double const point_time =
+                double(time) / std::max(s.num_points[v], size_t(1));
+            if (s.chosen == NONE || point_time < min_time) {
+                min_time = point_time;
+                s.chosen = v;
+            }
+        }
+
+        s.events.clear();
+    }
+
+    std::shared_ptr<State> state;
+};
+
+template <typename Function>
+constexpr size_t OnlineTuner<Function>::NONE;
+
+}
+
+#endif /* ONLINE_TUNER_HPP */
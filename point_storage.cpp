@@ -0,0 +1,202 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include "point_storage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    uint32_t float_bits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(uint32_t bits) {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+Clustering::Half::Half(float value)
+{
+    uint32_t const u = float_bits(value);
+    uint32_t const sign = (u >> 16) & 0x8000;
+    uint32_t const abs = u & 0x7fffffff;
+
+    if (abs >= 0x7f800000) {
+        // Infinity or NaN, keep NaN quiet
+        bits = sign | 0x7c00 | ((abs > 0x7f800000) ? 0x200 : 0);
+    }
+    else if (abs >= 0x477ff000) {
+        // Rounds to or above 65520, overflows to infinity
+        bits = sign | 0x7c00;
+    }
+    else if (abs < 0x38800000) {
+        // Below 2^-14, subnormal or zero
+        int const shift = 126 - (int) (abs >> 23);
+        if (shift > 24) {
+            bits = sign;
+        }
+        else {
+            uint32_t const mantissa = (abs & 0x7fffff) | 0x800000;
+            uint32_t const remainder = mantissa & ((1u << shift) - 1);
+            uint32_t const halfway = 1u << (shift - 1);
+            uint32_t h = mantissa >> shift;
+            if (remainder > halfway or (remainder == halfway and (h & 1))) {
+                ++h;
+            }
+            bits = sign | h;
+        }
+    }
+    else {
+        // Rebias exponent, carry of rounding may increment it
+        uint32_t const remainder = abs & 0x1fff;
+        uint32_t h = (abs - 0x38000000) >> 13;
+        if (remainder > 0x1000 or (remainder == 0x1000 and (h & 1))) {
+            ++h;
+        }
+        bits = sign | h;
+    }
+}
+
+Clustering::Half::operator float() const
+{
+    uint32_t const sign = (uint32_t) (bits & 0x8000) << 16;
+    uint32_t const exponent = (bits >> 10) & 0x1f;
+    uint32_t const mantissa = bits & 0x3ff;
+
+    if (exponent == 0) {
+        float const value = std::ldexp((float) mantissa, -24);
+        return (sign) ? -value : value;
+    }
+    else if (exponent == 0x1f) {
+        return bits_float(sign | 0x7f800000 | (mantissa << 13));
+    }
+
+    return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+Clustering::BFloat16::BFloat16(float value)
+{
+    uint32_t const u = float_bits(value);
+
+    if ((u & 0x7fffffff) > 0x7f800000) {
+        // Keep NaN quiet, as truncating might drop the payload
+        bits = (u >> 16) | 0x40;
+    }
+    else {
+        bits = (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+    }
+}
+
+Clustering::BFloat16::operator float() const
+{
+    return bits_float((uint32_t) bits << 16);
+}
+
+template <typename T>
+Clustering::Quantization Clustering::Quantization::fit(
+        T const *points,
+        size_t num_points,
+        size_t num_features,
+        bool col_major
+        )
+{
+    std::vector<float> min(num_features, std::numeric_limits<float>::max());
+    std::vector<float> max(num_features, std::numeric_limits<float>::lowest());
+
+    for (size_t p = 0; p < num_points; ++p) {
+        for (size_t f = 0; f < num_features; ++f) {
+            float const value = (col_major)
+                ? points[f * num_points + p]
+                : points[p * num_features + f]
+                ;
+            min[f] = std::min(min[f], value);
+            max[f] = std::max(max[f], value);
+        }
+    }
+
+    Quantization quantization;
+    quantization.scale.resize(num_features);
+    quantization.offset.resize(num_features);
+    for (size_t f = 0; f < num_features; ++f) {
+        float const range = (num_points == 0) ? 0.0f : max[f] - min[f];
+        quantization.scale[f] = (range > 0.0f) ? range / 255.0f : 1.0f;
+        quantization.offset[f] = (num_points == 0) ? 0.0f : min[f];
+    }
+
+    return quantization;
+}
+
+uint8_t Clustering::Quantization::quantize(float value, size_t feature) const
+{
+    float const code = std::round((value - offset[feature]) / scale[feature]);
+    return (uint8_t) std::min(std::max(code, 0.0f), 255.0f);
+}
+
+float Clustering::Quantization::dequantize(uint8_t code, size_t feature) const
+{
+    return scale[feature] * code + offset[feature];
+}
+
+Clustering::PointStorage Clustering::PointStorageHelper::parse(
+        std::string const& point_type
+        )
+{
+    if (point_type == "half") {
+        return PointStorage::Half;
+    }
+    else if (point_type == "bfloat16") {
+        return PointStorage::BFloat16;
+    }
+    else if (point_type == "int8") {
+        return PointStorage::Int8;
+    }
+
+    return PointStorage::Native;
+}
+
+size_t Clustering::PointStorageHelper::value_size(
+        PointStorage storage,
+        size_t native_size
+        )
+{
+    switch (storage) {
+    case PointStorage::Half:
+        return sizeof(Half);
+    case PointStorage::BFloat16:
+        return sizeof(BFloat16);
+    case PointStorage::Int8:
+        return sizeof(uint8_t);
+    default:
+        return native_size;
+    }
+}
+
+std::string Clustering::PointStorageHelper::defines(PointStorage storage)
+{
+    switch (storage) {
+    case PointStorage::Half:
+        return " -DPOINT_HALF";
+    case PointStorage::BFloat16:
+        return " -DPOINT_BFLOAT16";
+    case PointStorage::Int8:
+        return " -DPOINT_INT8";
+    default:
+        return "";
+    }
+}
+
+template Clustering::Quantization Clustering::Quantization::fit(float const*, size_t, size_t, bool);
+template Clustering::Quantization Clustering::Quantization::fit(double const*, size_t, size_t, bool);
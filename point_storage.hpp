@@ -0,0 +1,120 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef POINT_STORAGE_HPP
+#define POINT_STORAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Clustering {
+
+/*
+ * Storage format of points in device memory.
+ *
+ * Native: Points are stored as PointT.
+ * Half: Points are stored as IEEE 754 binary16.
+ * BFloat16: Points are stored as the upper 16 bits of a float.
+ * Int8: Points are quantized to 8-bit codes with a per-feature scale
+ *   and offset, see Quantization.
+ *
+ * Reduced points are widened to float in-register by the kernels, while
+ * centroids, distances and sums stay in float. 16-bit points halve, and
+ * 8-bit points quarter, transfer volume and device memory of points, at
+ * the cost of precision.
+ */
+enum class PointStorage {
+    Native,
+    Half,
+    BFloat16,
+    Int8
+};
+
+/*
+ * IEEE 754 binary16 value. Converts from float with round to nearest
+ * even, as vstore_half_rte() does.
+ */
+struct Half {
+    uint16_t bits;
+
+    Half() = default;
+    Half(float value);
+    operator float() const;
+};
+
+/*
+ * Brain floating point value. Converts from float with round to nearest
+ * even.
+ */
+struct BFloat16 {
+    uint16_t bits;
+
+    BFloat16() = default;
+    BFloat16(float value);
+    operator float() const;
+};
+
+/*
+ * Affine quantization of features to unsigned 8-bit codes:
+ * value = scale[f] * code + offset[f]
+ *
+ * Each feature's range is mapped onto the 256 codes, i.e. offset is the
+ * feature's minimum, such that the quantization error is at most
+ * scale[f] / 2.
+ */
+struct Quantization {
+    std::vector<float> scale;
+    std::vector<float> offset;
+
+    /*
+     * Fit scale and offset to the range of each feature.
+     */
+    template <typename T>
+    static Quantization fit(
+            T const *points,
+            size_t num_points,
+            size_t num_features,
+            bool col_major
+            );
+
+    uint8_t quantize(float value, size_t feature) const;
+    float dequantize(uint8_t code, size_t feature) const;
+};
+
+static_assert(sizeof(Half) == 2, "Half must be 16 bits");
+static_assert(sizeof(BFloat16) == 2, "BFloat16 must be 16 bits");
+
+class PointStorageHelper {
+public:
+    /*
+     * Parse point type name. "half" and "bfloat16" select 16-bit
+     * storage, "int8" selects quantized storage, all other names native
+     * storage.
+     */
+    static PointStorage parse(std::string const& point_type);
+
+    /*
+     * Size in bytes of a stored value, given the size of PointT.
+     */
+    static size_t value_size(PointStorage storage, size_t native_size);
+
+    /*
+     * Preprocessor defines that select the storage in kernels.
+     */
+    static std::string defines(PointStorage storage);
+};
+
+}
+
+extern template Clustering::Quantization Clustering::Quantization::fit(float const*, size_t, size_t, bool);
+extern template Clustering::Quantization Clustering::Quantization::fit(double const*, size_t, size_t, bool);
+
+#endif /* POINT_STORAGE_HPP */
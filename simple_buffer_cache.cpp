@@ -15,6 +15,9 @@
 #include <cstring>
 #include <iostream>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 #define VERBOSE false
 #define CPU_ZERO_COPY true
 
@@ -30,12 +33,35 @@ SimpleBufferCache::SimpleBufferCache(size_t buffer_size)
     ObjectInfo& obj = object_info_i[0];
     obj.ptr = nullptr;
     obj.size = 0;
+    obj.fd = -1;
+    obj.direct_fd = -1;
+
+    pending_releases = 0;
 }
 
 SimpleBufferCache::~SimpleBufferCache() {
+    // Complete outstanding commands, such that their event callbacks fire
+    for (auto& t : io_thread) {
+        Queue queue = t.first;
+        queue.finish();
+    }
+
     for (auto& t : io_thread) {
         t.second.join();
     }
+
+    // Slot release callbacks reference the slot locks
+    {
+        std::unique_lock<std::mutex> lock(release_mutex);
+        release_cv.wait(lock, [this]{ return pending_releases == 0; });
+    }
+
+    for (auto& obj : object_info_i) {
+        if (obj.fd >= 0) {
+            munmap(obj.map_ptr, obj.map_length);
+            FileReader::close(obj.fd, obj.direct_fd);
+        }
+    }
 }
 
 size_t SimpleBufferCache::pool_size(Device device)
@@ -49,6 +75,16 @@ size_t SimpleBufferCache::pool_size(Device device)
     return dev.pool_size;
 }
 
+size_t SimpleBufferCache::max_objects(Device device)
+{
+    int64_t did = find_device_id(device);
+    if (did < 0) {
+        return 0;
+    }
+
+    return device_info_i[did].num_slots / DoubleBuffering;
+}
+
 int SimpleBufferCache::add_device(Context context, Device device, size_t pool_size)
 {
     if (pool_size <= buffer_size_i * DoubleBuffering) {
@@ -64,7 +100,11 @@ int SimpleBufferCache::add_device(Context context, Device device, size_t pool_si
     info.device = device;
     info.pool_size = pool_size;
     info.num_slots = num_cache_slots;
-    info.slot_lock.resize(num_cache_slots, {});
+    info.slot_lock.reset(new std::atomic<uint32_t>[num_cache_slots]);
+    for (size_t i = 0; i < num_cache_slots; ++i) {
+        info.slot_lock[i] = DeviceInfo::SlotLock::Free;
+    }
+    info.slot_release_events.resize(num_cache_slots);
     info.cached_object_id.resize(num_cache_slots, -1);
     info.cached_buffer_id.resize(num_cache_slots, 0);
     info.cached_ptr.resize(num_cache_slots, nullptr);
@@ -78,29 +118,32 @@ int SimpleBufferCache::add_device(Context context, Device device, size_t pool_si
     // Leave CPU buffers default-initialized, we create them on-demand
     // For other devices, do buffer initialization
     if (not (CPU_ZERO_COPY and device.type() == Device::cpu)) {
-        for (auto& buf : info.device_buffer) {
-            buf = Buffer(context, buffer_size_i);
-        }
-
-        for (size_t i = 0; i < info.host_buffer.size(); ++i) {
-            auto& buf = info.host_buffer[i];
-            buf = Buffer(
-                    context,
-                    buffer_size_i,
-                    Buffer::read_write | Buffer::alloc_host_ptr
-                    );
-            info.host_ptr[i] = queue.enqueue_map_buffer(
-                    buf,
-                    Queue::map_write_invalidate_region,
-                    0,
-                    buffer_size_i
-                    );
+        for (size_t i = 0; i < num_cache_slots; ++i) {
+            allocate_cache_slot(queue, info, i);
         }
     }
 
     return 1;
 }
 
+void SimpleBufferCache::allocate_cache_slot(Queue& queue, DeviceInfo& info, size_t cache_slot)
+{
+    info.device_buffer[cache_slot] = Buffer(info.context, buffer_size_i);
+
+    auto& buf = info.host_buffer[cache_slot];
+    buf = Buffer(
+            info.context,
+            buffer_size_i,
+            Buffer::read_write | Buffer::alloc_host_ptr
+            );
+    info.host_ptr[cache_slot] = queue.enqueue_map_buffer(
+            buf,
+            Queue::map_write_invalidate_region,
+            0,
+            buffer_size_i
+            );
+}
+
 // TODO: Objects in ObjectMode::Transient don't need an underlying host object
 uint32_t SimpleBufferCache::add_object(void *data_object, size_t size, ObjectMode mode)
 {
@@ -110,6 +153,74 @@ uint32_t SimpleBufferCache::add_object(void *data_object, size_t size, ObjectMod
     obj.ptr = data_object;
     obj.size = size;
     obj.mode = mode;
+    obj.num_dims = 1;
+    obj.fd = -1;
+    obj.direct_fd = -1;
+
+    return oid;
+}
+
+uint32_t SimpleBufferCache::add_strided_object(void *data_object, size_t size, size_t num_dims, ObjectMode mode)
+{
+    if (mode != ObjectMode::ReadOnly) {
+        std::cerr << "add_strided_object: only ReadOnly mode supported" << std::endl;
+        return 0;
+    }
+    if (num_dims == 0 or size % num_dims != 0 or buffer_size_i % num_dims != 0) {
+        std::cerr << "add_strided_object: dimension mismatch" << std::endl;
+        return 0;
+    }
+
+    uint32_t oid = add_object(data_object, size, mode);
+    object_info_i[oid].num_dims = num_dims;
+
+    return oid;
+}
+
+uint32_t SimpleBufferCache::add_file_object(char const *file_name, size_t offset, size_t size, ObjectMode mode)
+{
+    if (mode != ObjectMode::ReadOnly) {
+        std::cerr << "add_file_object: only ReadOnly mode supported" << std::endl;
+        return 0;
+    }
+
+    int fd = -1, direct_fd = -1;
+    if (FileReader::open(file_name, fd, direct_fd) < 0) {
+        return 0;
+    }
+
+    // Map the file to give the object an address range. Devices read the
+    // file through the IO thread, only CPU zero-copy buffers touch the
+    // mapping. Private mapping, because CPU buffers are read_write.
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t map_offset = offset / page_size * page_size;
+    size_t map_length = size + (offset - map_offset);
+    void *map_ptr = mmap(
+            nullptr,
+            map_length,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE,
+            fd,
+            map_offset
+            );
+    if (map_ptr == MAP_FAILED) {
+        std::cerr << "add_file_object: cannot map " << file_name << std::endl;
+        FileReader::close(fd, direct_fd);
+        return 0;
+    }
+
+    uint32_t oid = object_info_i.size();
+    object_info_i.emplace_back();
+    ObjectInfo& obj = object_info_i[oid];
+    obj.ptr = (char*)map_ptr + (offset - map_offset);
+    obj.size = size;
+    obj.mode = mode;
+    obj.num_dims = 1;
+    obj.fd = fd;
+    obj.direct_fd = direct_fd;
+    obj.file_offset = offset;
+    obj.map_ptr = map_ptr;
+    obj.map_length = map_length;
 
     return oid;
 }
@@ -178,6 +289,13 @@ int SimpleBufferCache::get(Queue queue, uint32_t oid, void *begin, void *end, Bu
     buffers.clear();
     buffers.push_back({device_info.device_buffer[cache_slot], size, buffer_id});
 
+    // Order after commands of previous lock holders, if still running
+    auto& release_events = device_info.slot_release_events[cache_slot];
+    if (release_events.size() != 0) {
+        event = queue.enqueue_marker(release_events);
+        release_events.clear();
+    }
+
     return 1;
 }
 
@@ -206,12 +324,32 @@ int SimpleBufferCache::write_and_get(Queue queue, uint32_t oid, void *begin, voi
         std::cerr << "write_and_get: bad begin ptr" << std::endl;
         return -1;
     }
+    if (object_info_i[oid].num_dims > 1
+            and (buffer_id % buffer_size_i != 0
+                or size % object_info_i[oid].num_dims != 0))
+    {
+        std::cerr << "write_and_get: strided range not buffer aligned" << std::endl;
+        return -1;
+    }
     auto cache_slot = assign_cache_slot(device_id, oid, buffer_id);
     if (cache_slot < 0) {
         std::cerr << "write_and_get: no free cache slot" << std::endl;
         return -1;
     }
     auto& device_info = device_info_i[device_id];
+    auto& obj = object_info_i[oid];
+    bool const zero_copy =
+        CPU_ZERO_COPY
+        and device_info.device.type() == Device::cpu
+        and obj.num_dims == 1
+        ;
+
+    // CPU devices can't use strided objects in place, they need a
+    // staging buffer to gather into. Slots belong to a single object,
+    // thus allocate them once on first use.
+    if (not zero_copy and device_info.host_ptr[cache_slot] == nullptr) {
+        allocate_cache_slot(queue, device_info, cache_slot);
+    }
     void *host_ptr = device_info.host_ptr[cache_slot];
     auto& device_buffer = device_info.device_buffer[cache_slot];
 
@@ -221,8 +359,17 @@ int SimpleBufferCache::write_and_get(Queue queue, uint32_t oid, void *begin, voi
         return -1;
     }
 
+    // Previous lock holders may still use the slot,
+    // must wait for them before evicting and overwriting
+    WaitList slot_wait_list(wait_list);
+    auto& release_events = device_info.slot_release_events[cache_slot];
+    for (size_t i = 0; i < release_events.size(); ++i) {
+        slot_wait_list.insert(release_events[i]);
+    }
+    release_events.clear();
+
     Event evict_event;
-    if (evict_cache_slot(queue, device_id, cache_slot, evict_event, wait_list, datapoint.create_child()) < 0) {
+    if (evict_cache_slot(queue, device_id, cache_slot, evict_event, slot_wait_list, datapoint.create_child()) < 0) {
         std::cerr << "write_and_get: cannot evict cache slot " << cache_slot << std::endl;
         return -1;
     }
@@ -234,7 +381,7 @@ int SimpleBufferCache::write_and_get(Queue queue, uint32_t oid, void *begin, voi
     device_info.cached_ptr[cache_slot] = begin;
     device_info.cached_content_length[cache_slot] = size;
 
-    if (CPU_ZERO_COPY and device_info.device.type() == Device::cpu) {
+    if (zero_copy) {
         device_buffer = Buffer(
                 device_info.context,
                 size,
@@ -250,29 +397,49 @@ int SimpleBufferCache::write_and_get(Queue queue, uint32_t oid, void *begin, voi
         auto& mode = object_info_i[oid].mode;
         if (mode == ObjectMode::Transient) {
             // Don't need to actually write anything, locking is enough
-            finish_event = evict_event;
+            finish_event = (slot_wait_list.size() != 0)
+                ? queue.enqueue_marker(slot_wait_list)
+                : evict_event;
             return 1;
         }
 
-        WaitList task_wait_list(wait_list);
+        WaitList task_wait_list(slot_wait_list);
         Event const empty_event;
         if (evict_event != empty_event) {
             task_wait_list.insert(evict_event);
         }
+        // Strided objects are addressed in partitioned layout, but
+        // stored column major. Locate the buffer's segment in column 0.
+        void *src_ptr = begin;
+        size_t src_stride = 0;
+        if (obj.num_dims > 1) {
+            size_t buf_dim_size = buffer_size_i / obj.num_dims;
+            src_ptr = (char*)obj.ptr
+                + buffer_id / buffer_size_i * buf_dim_size;
+            src_stride = obj.size / obj.num_dims;
+        }
+
         boost::compute::user_event task_uevent(queue.get_context());
         auto& iot = this->get_io_thread(queue);
         AsyncTask *async_task = new AsyncTask{
             &iot,
-                begin,
+                src_ptr,
                 host_ptr,
                 size,
                 task_wait_list,
                 task_uevent,
-                &datapoint
+                &datapoint,
+                obj.num_dims,
+                src_stride,
+                obj.fd,
+                obj.direct_fd,
+                obj.file_offset + buffer_id,
+                buffer_size_i,
+                nullptr
         };
 
         WaitList write_wait_list(async_task->finish_event);
-        iot.push_back(async_task);
+        iot.submit(async_task);
 
         finish_event = queue.enqueue_write_buffer_async(
                 device_buffer,
@@ -363,13 +530,20 @@ int SimpleBufferCache::read(Queue queue, uint32_t oid, void *begin, void *end, E
                 size,
                 task_wait_list,
                 task_uevent,
-                &datapoint
+                &datapoint,
+                1,
+                0,
+                -1,
+                -1,
+                0,
+                size,
+                nullptr
         };
 
         WaitList barrier_wait_list(async_task->finish_event);
         Event barrier_event;
         barrier_event = queue.enqueue_barrier(barrier_wait_list);
-        iot.push_back(async_task);
+        iot.submit(async_task);
 
         finish_event = barrier_event;
     }
@@ -429,6 +603,8 @@ int SimpleBufferCache::evict_cache_slot(Queue queue, uint32_t device_id, uint32_
 
 int SimpleBufferCache::try_read_lock(uint32_t device_id, uint32_t cache_slot)
 {
+    using SlotLock = DeviceInfo::SlotLock;
+
     DeviceInfo& dev = device_info_i[device_id];
     if (cache_slot >= dev.num_slots) {
         std::cerr << "try_read_lock: invalid cache slot " << cache_slot << std::endl;
@@ -440,24 +616,35 @@ int SimpleBufferCache::try_read_lock(uint32_t device_id, uint32_t cache_slot)
     }
 
     auto& lock = dev.slot_lock[cache_slot];
-    if (lock.status == DeviceInfo::SlotLock::Free) {
-        lock.status = DeviceInfo::SlotLock::ReadLock;
-        lock.count = 1;
-
-        return 1;
-    }
-    else if (lock.status == DeviceInfo::SlotLock::ReadLock) {
-        ++lock.count;
+    uint32_t state = lock.load();
+    uint32_t desired = 0;
+    do {
+        switch (SlotLock::status(state)) {
+            case SlotLock::Free:
+            case SlotLock::ReleasePending:
+                desired = SlotLock::make(
+                        SlotLock::ReadLock,
+                        1,
+                        SlotLock::epoch(state));
+                break;
+            case SlotLock::ReadLock:
+                desired = SlotLock::make(
+                        SlotLock::ReadLock,
+                        SlotLock::count(state) + 1,
+                        SlotLock::epoch(state));
+                break;
+            default:
+                return -1;
+        }
+    } while (not lock.compare_exchange_weak(state, desired));
 
-        return 1;
-    }
-    else {
-        return -1;
-    }
+    return 1;
 }
 
 int SimpleBufferCache::try_write_lock(uint32_t device_id, uint32_t cache_slot)
 {
+    using SlotLock = DeviceInfo::SlotLock;
+
     DeviceInfo& dev = device_info_i[device_id];
     if (cache_slot >= dev.num_slots) {
         std::cerr << "try_write_lock: invalid cache slot " << cache_slot << std::endl;
@@ -469,18 +656,23 @@ int SimpleBufferCache::try_write_lock(uint32_t device_id, uint32_t cache_slot)
     }
 
     auto& lock = dev.slot_lock[cache_slot];
-    if (lock.status == DeviceInfo::SlotLock::Free) {
-        lock.status = DeviceInfo::SlotLock::WriteLock;
-        lock.count = 1;
+    uint32_t state = lock.load();
+    uint32_t desired = 0;
+    do {
+        auto status = SlotLock::status(state);
+        if (status != SlotLock::Free and status != SlotLock::ReleasePending) {
+            return -1;
+        }
+        desired = SlotLock::make(
+                SlotLock::WriteLock,
+                1,
+                SlotLock::epoch(state));
+    } while (not lock.compare_exchange_weak(state, desired));
 
-        return 1;
-    }
-    else {
-        return -1;
-    }
+    return 1;
 }
 
-int SimpleBufferCache::unlock(Queue queue, uint32_t oid, BufferList const& buffers, Event&, WaitList const&, Measurement::DataPoint& datapoint)
+int SimpleBufferCache::unlock(Queue queue, uint32_t oid, BufferList const& buffers, Event&, WaitList const& wait_list, Measurement::DataPoint& datapoint)
 {
     datapoint.set_name("BufferCache::unlock");
 
@@ -518,26 +710,127 @@ int SimpleBufferCache::unlock(Queue queue, uint32_t oid, BufferList const& buffe
         std::cerr << "unlock: OID " << oid << " BID " << buf_id << " DID " << dev_id << " SlotID " << slot_id << std::endl;
     }
 
+    using SlotLock = DeviceInfo::SlotLock;
+
+    // Don't wait for the commands in wait_list to complete. Instead,
+    // mark the slot as ReleasePending and free it in an event callback.
+    bool has_events = wait_list.size() != 0;
     auto& lock = dev.slot_lock[slot_id];
-    if (lock.status == DeviceInfo::SlotLock::ReadLock) {
-        if (lock.count == 1) {
-            lock.status = DeviceInfo::SlotLock::Free;
-            lock.count = 0;
+    uint32_t state = lock.load();
+    uint32_t desired = 0;
+    do {
+        auto status = SlotLock::status(state);
+        auto released = (has_events)
+            ? SlotLock::ReleasePending
+            : SlotLock::Free
+            ;
+
+        if (status == SlotLock::ReadLock and SlotLock::count(state) > 1) {
+            desired = SlotLock::make(
+                    SlotLock::ReadLock,
+                    SlotLock::count(state) - 1,
+                    SlotLock::epoch(state));
+        }
+        else if (status == SlotLock::ReadLock or status == SlotLock::WriteLock) {
+            desired = SlotLock::make(
+                    released,
+                    0,
+                    SlotLock::epoch(state) + 1);
         }
         else {
-            --lock.count;
+            std::cerr << "unlock: invalid lock state error" << std::endl;
+            return -1;
+        }
+    } while (not lock.compare_exchange_weak(state, desired));
+
+    if (has_events) {
+        auto& release_events = dev.slot_release_events[slot_id];
+        for (size_t i = 0; i < wait_list.size(); ++i) {
+            release_events.insert(wait_list[i]);
+        }
+
+        if (SlotLock::status(desired) == SlotLock::ReleasePending) {
+            {
+                std::lock_guard<std::mutex> lock(release_mutex);
+                ++pending_releases;
+            }
+            when_complete(
+                    wait_list,
+                    &release_callback,
+                    new SlotRelease{this, &lock, desired}
+                    );
         }
     }
-    else if (lock.status == DeviceInfo::SlotLock::WriteLock) {
-        lock.status = DeviceInfo::SlotLock::Free;
-        lock.count = 0;
+
+    return 1;
+}
+
+void SimpleBufferCache::release_callback(void *data)
+{
+    using SlotLock = DeviceInfo::SlotLock;
+
+    SlotRelease *release = (SlotRelease*) data;
+
+    // Fails if slot was locked again in the meantime
+    uint32_t expected = release->pending_state;
+    release->lock->compare_exchange_strong(
+            expected,
+            SlotLock::make(
+                SlotLock::Free,
+                0,
+                SlotLock::epoch(release->pending_state)));
+
+    SimpleBufferCache *cache = release->cache;
+    delete release;
+
+    std::lock_guard<std::mutex> lock(cache->release_mutex);
+    --cache->pending_releases;
+    cache->release_cv.notify_all();
+}
+
+void SimpleBufferCache::when_complete(WaitList const& wait_list, void (*function)(void*), void *data)
+{
+    struct Countdown {
+        std::atomic<uint32_t> count;
+        void (*function)(void*);
+        void *data;
+
+        static void callback(cl_event, cl_int status, void *countdown) {
+            Countdown *cd = (Countdown*) countdown;
+            if (status < 0) {
+                std::cerr << "when_complete: event error " << status << std::endl;
+            }
+            if (--cd->count == 0) {
+                cd->function(cd->data);
+                delete cd;
+            }
+        }
+    };
+
+    Event const empty_event;
+    uint32_t num_events = 0;
+    for (size_t i = 0; i < wait_list.size(); ++i) {
+        if (wait_list[i] != empty_event) {
+            ++num_events;
+        }
     }
-    else {
-        std::cerr << "unlock: invalid lock state error" << std::endl;
-        return -1;
+
+    if (num_events == 0) {
+        function(data);
+        return;
     }
 
-    return 1;
+    Countdown *countdown = new Countdown;
+    countdown->count = num_events;
+    countdown->function = function;
+    countdown->data = data;
+
+    for (size_t i = 0; i < wait_list.size(); ++i) {
+        Event event = wait_list[i];
+        if (event != empty_event) {
+            event.set_callback(&Countdown::callback, Event::complete, countdown);
+        }
+    }
 }
 
 int64_t SimpleBufferCache::find_device_id(Device device)
@@ -604,15 +897,26 @@ int64_t SimpleBufferCache::assign_cache_slot(uint32_t device_id, uint32_t oid, s
     if (device_id >= device_info_i.size()) {
         return -1;
     }
-    if (oid >= object_info_i.size()) {
+    if (oid == 0 or oid >= object_info_i.size()) {
         return -1;
     }
 
+    using SlotLock = DeviceInfo::SlotLock;
+
+    auto is_unlocked = [](uint32_t state) {
+        return SlotLock::status(state) == SlotLock::Free
+            or SlotLock::status(state) == SlotLock::ReleasePending;
+    };
+
     auto& dev = device_info_i[device_id];
-    uint32_t base_slot = (oid - 1) * DoubleBuffering;
-    uint32_t slot = (dev.slot_lock[base_slot].status == DeviceInfo::SlotLock::Free) ? base_slot : base_slot + 1;
+    size_t base_slot = (oid - 1) * DoubleBuffering;
+    if (base_slot + 1 >= dev.num_slots) {
+        std::cerr << "assign_cache_slot: object exceeds cache slots" << std::endl;
+        return -1;
+    }
+    size_t slot = (is_unlocked(dev.slot_lock[base_slot].load())) ? base_slot : base_slot + 1;
 
-    if (dev.slot_lock[slot].status != DeviceInfo::SlotLock::Free) {
+    if (not is_unlocked(dev.slot_lock[slot].load())) {
         std::cerr << "assign_cache_slot: cannot find free cache slot" << std::endl;
         return -1;
     }
@@ -633,30 +937,67 @@ SimpleBufferCache::IOThread& SimpleBufferCache::get_io_thread(Queue& queue) {
 
 void SimpleBufferCache::IOThread::launch() {
 
-    this->queue_locked = false;
+    this->ready_tasks = nullptr;
+    this->outstanding_tasks = 0;
+    this->sleeping = false;
+    this->stop = false;
     this->thread = std::thread(&work, this);
 }
 
 void SimpleBufferCache::IOThread::join() {
 
-    this->push_back(nullptr);
+    this->stop = true;
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->sleep_cv.notify_one();
+    }
     this->thread.join();
 }
 
 void SimpleBufferCache::IOThread::work(IOThread *io_thread) {
 
-    AsyncTask *task = nullptr;
     while (true) {
-        task = io_thread->pop_front();
+        AsyncTask *task = io_thread->pop_all();
 
         if (task == nullptr) {
-            break;
+            std::unique_lock<std::mutex> lock(io_thread->sleep_mutex);
+            io_thread->sleeping = true;
+
+            // Tasks still waiting for their events will be pushed later
+            bool finished =
+                io_thread->stop
+                and io_thread->outstanding_tasks.load() == 0;
+            if (finished) {
+                break;
+            }
+            if (io_thread->ready_tasks.load() == nullptr) {
+                io_thread->sleep_cv.wait(lock);
+            }
+
+            io_thread->sleeping = false;
+            continue;
         }
 
-        task->wait_list.wait();
-        async_memcpy(*task);
-        task->finish_event.set_status(Event::complete);
-        delete task;
+        while (task != nullptr) {
+            AsyncTask *next = task->next;
+
+            int ret = 1;
+            if (task->fd >= 0) {
+                ret = async_file_read(io_thread->reader, *task);
+            }
+            else {
+                async_memcpy(*task);
+            }
+
+            // A negative status aborts the commands waiting on the task,
+            // such that the caller sees the error instead of stale data
+            task->finish_event.set_status(
+                    (ret < 0) ? IOErrorStatus : CL_COMPLETE);
+            delete task;
+            --io_thread->outstanding_tasks;
+
+            task = next;
+        }
     }
 }
 
@@ -664,42 +1005,79 @@ void SimpleBufferCache::IOThread::async_memcpy(AsyncTask& task) {
 
     Timer::Timer memcpy_timer;
     memcpy_timer.start();
-    std::memcpy(task.dst_ptr, task.src_ptr, task.size);
+    if (task.num_dims == 1) {
+        std::memcpy(task.dst_ptr, task.src_ptr, task.size);
+    }
+    else {
+        size_t segment_size = task.size / task.num_dims;
+        for (size_t d = 0; d < task.num_dims; ++d) {
+            std::memcpy(
+                    (char*)task.dst_ptr + d * segment_size,
+                    (char const*)task.src_ptr + d * task.src_stride,
+                    segment_size
+                    );
+        }
+    }
     uint64_t memcpy_time = memcpy_timer
         .stop<std::chrono::nanoseconds>();
     task.datapoint->add_value() = memcpy_time;
 }
 
-void SimpleBufferCache::IOThread::push_back(AsyncTask *task) {
+int SimpleBufferCache::IOThread::async_file_read(FileReader& reader, AsyncTask& task) {
+
+    Timer::Timer read_timer;
+    read_timer.start();
+    int ret = reader.read(
+            task.fd,
+            task.direct_fd,
+            task.dst_ptr,
+            task.size,
+            task.capacity,
+            task.file_offset
+            );
+    uint64_t read_time = read_timer
+        .stop<std::chrono::nanoseconds>();
+    task.datapoint->add_value() = read_time;
+
+    return ret;
+}
 
-    std::unique_lock<std::mutex> lock(this->queue_mutex);
+void SimpleBufferCache::IOThread::submit(AsyncTask *task) {
 
-    while (this->queue_locked) {
-        this->queue_cv.wait(lock);
-    }
-    this->queue_locked = true;
+    ++this->outstanding_tasks;
+    when_complete(task->wait_list, &ready_callback, task);
+}
 
-    this->tasks.push_back(task);
+void SimpleBufferCache::IOThread::ready_callback(void *task) {
 
-    this->queue_locked = false;
-    this->queue_cv.notify_all();
+    AsyncTask *async_task = (AsyncTask*) task;
+    async_task->io_thread->push(async_task);
 }
 
-SimpleBufferCache::AsyncTask* SimpleBufferCache::IOThread::pop_front() {
+void SimpleBufferCache::IOThread::push(AsyncTask *task) {
 
-    std::unique_lock<std::mutex> lock(this->queue_mutex);
+    task->next = this->ready_tasks.load();
+    while (not this->ready_tasks.compare_exchange_weak(task->next, task)) {
+    }
 
-    while (this->queue_locked or this->tasks.empty()) {
-        this->queue_cv.wait(lock);
+    if (this->sleeping.load()) {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->sleep_cv.notify_one();
     }
-    this->queue_locked = true;
+}
 
-    AsyncTask *task = this->tasks.front();
-    this->tasks.pop_front();
+SimpleBufferCache::AsyncTask* SimpleBufferCache::IOThread::pop_all() {
 
-    this->queue_locked = false;
-    this->queue_cv.notify_all();
+    AsyncTask *stack = this->ready_tasks.exchange(nullptr);
 
-    return task;
-}
+    // Reverse stack to process tasks in order of readiness
+    AsyncTask *fifo = nullptr;
+    while (stack != nullptr) {
+        AsyncTask *next = stack->next;
+        stack->next = fifo;
+        fifo = stack;
+        stack = next;
+    }
 
+    return fifo;
+}
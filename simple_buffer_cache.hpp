@@ -11,10 +11,12 @@
 #define SIMPLE_BUFFER_CACHE_HPP
 
 #include <buffer_cache.hpp>
+#include <file_reader.hpp>
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <vector>
-#include <list>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -46,8 +48,17 @@ public:
     // TODO: return multiple OpenCL events in read / write / etc
 
     size_t pool_size(Device device);
+
+    /*
+     * Number of objects the device's pool holds, as each object is
+     * double buffered in its own pair of cache slots.
+     */
+    size_t max_objects(Device device);
+
     int add_device(Context context, Device device, size_t pool_size);
     uint32_t add_object(void *data_object, size_t length, ObjectMode mode = ObjectMode::ReadOnly);
+    uint32_t add_file_object(char const *file_name, size_t offset, size_t length, ObjectMode mode = ObjectMode::ReadOnly);
+    uint32_t add_strided_object(void *data_object, size_t length, size_t num_dims, ObjectMode mode = ObjectMode::ReadOnly);
     void object(uint32_t object_id, void *& data_object, size_t& length);
     int get(Queue queue, uint32_t oid, void *begin, void *end, BufferList& buffer, Event& event, WaitList const& wait_list, Measurement::DataPoint& datapoint);
     int write_and_get(Queue queue, uint32_t oid, void *begin, void *end, BufferList& buffer, Event& event, WaitList const& wait_list, Measurement::DataPoint& datapoint);
@@ -59,18 +70,41 @@ private:
 
     uint32_t static constexpr DoubleBuffering = 2u;
 
+    // Event status of IO tasks that failed to read their object
+    cl_int static constexpr IOErrorStatus = CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST;
+
     struct DeviceInfo {
+        /*
+         * Slot lock state packed into a single atomic word, such that
+         * locks can be taken and released with compare-and-swap:
+         *
+         *   bits  0-1:  SlotLockStatus
+         *   bits  2-15: reader count
+         *   bits 16-31: epoch, incremented on every release
+         *
+         * ReleasePending slots are unlocked by the host, but may still be
+         * in use by enqueued commands. They can be locked again by
+         * waiting on slot_release_events. An event callback sets the
+         * slot Free once the commands complete; the epoch prevents a
+         * late callback from freeing a slot that was locked again.
+         */
         struct SlotLock {
-            enum SlotLockStatus { Free = 0, ReadLock, WriteLock };
-            SlotLockStatus status;
-            uint32_t count;
+            enum SlotLockStatus : uint32_t { Free = 0, ReadLock, WriteLock, ReleasePending };
+
+            static uint32_t status(uint32_t state) { return state & 0x3u; }
+            static uint32_t count(uint32_t state) { return (state >> 2) & 0x3FFFu; }
+            static uint32_t epoch(uint32_t state) { return state >> 16; }
+            static uint32_t make(uint32_t status, uint32_t count, uint32_t epoch) {
+                return (epoch << 16) | ((count & 0x3FFFu) << 2) | status;
+            }
         };
 
         Context context;
         Device device;
         size_t pool_size;
         size_t num_slots;
-        std::vector<SlotLock> slot_lock;
+        std::unique_ptr<std::atomic<uint32_t>[]> slot_lock;
+        std::vector<WaitList> slot_release_events;
         std::vector<int64_t> cached_object_id;
         std::vector<size_t> cached_buffer_id;
         std::vector<void*> cached_ptr;
@@ -84,26 +118,48 @@ private:
         void* ptr;
         size_t size;
         ObjectMode mode;
+
+        // Strided objects only, 1 otherwise
+        size_t num_dims;
+
+        // File-backed objects only, fd is -1 otherwise
+        int fd;
+        int direct_fd;
+        size_t file_offset;
+        void* map_ptr;
+        size_t map_length;
     };
 
     struct AsyncTask;
 
+    /*
+     * IO threads receive tasks only once the task's wait list completed,
+     * via OpenCL event callbacks. Ready tasks are pushed on a lock-free
+     * stack. The mutex is only taken to put an idle IO thread to sleep
+     * and to wake it up.
+     */
     class IOThread {
     public:
         void launch();
         void join();
         static void work(IOThread *io_thread);
-        void push_back(AsyncTask *task);
+        void submit(AsyncTask *task);
 
     private:
         std::thread thread;
-        std::list<AsyncTask*> tasks;
-        std::mutex queue_mutex;
-        std::condition_variable queue_cv;
-        int queue_locked;
-
-        AsyncTask* pop_front();
+        std::atomic<AsyncTask*> ready_tasks;
+        std::atomic<uint32_t> outstanding_tasks;
+        std::atomic<bool> sleeping;
+        std::atomic<bool> stop;
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_cv;
+        FileReader reader;
+
+        void push(AsyncTask *task);
+        AsyncTask* pop_all();
+        static void ready_callback(void *task);
         static void async_memcpy(AsyncTask& task);
+        static int async_file_read(FileReader& reader, AsyncTask& task);
     };
 
     struct AsyncTask {
@@ -114,12 +170,36 @@ private:
         WaitList wait_list;
         boost::compute::user_event finish_event;
         Measurement::DataPoint *datapoint;
+
+        // Gather num_dims segments, src_stride bytes apart
+        size_t num_dims;
+        size_t src_stride;
+
+        // Read from file instead of src_ptr if fd is valid
+        int fd;
+        int direct_fd;
+        size_t file_offset;
+        size_t capacity;
+
+        AsyncTask *next;
+    };
+
+    struct SlotRelease {
+        SimpleBufferCache *cache;
+        std::atomic<uint32_t> *lock;
+        uint32_t pending_state;
     };
 
     std::vector<DeviceInfo> device_info_i;
     std::vector<ObjectInfo> object_info_i;
     std::map<Queue, IOThread> io_thread;
 
+    // Slot release callbacks in flight, the destructor waits for them
+    uint32_t pending_releases;
+    std::mutex release_mutex;
+    std::condition_variable release_cv;
+
+    void allocate_cache_slot(Queue& queue, DeviceInfo& info, size_t cache_slot);
     int evict_cache_slot(Queue queue, uint32_t device_id, uint32_t cache_slot, Event& event, WaitList const& wait_list, Measurement::DataPoint& datapoint);
     int try_read_lock(uint32_t device_id, uint32_t cache_slot);
     int try_write_lock(uint32_t device_id, uint32_t cache_slot);
@@ -128,6 +208,8 @@ private:
     int64_t find_cache_slot(uint32_t device_id, uint32_t oid, size_t buffer_id);
     int64_t assign_cache_slot(uint32_t device_id, uint32_t oid, size_t buffer_id);
     IOThread& get_io_thread(Queue& queue);
+    static void release_callback(void *release);
+    static void when_complete(WaitList const& wait_list, void (*function)(void*), void *data);
 
 };
 
@@ -13,6 +13,10 @@
 #include <gtest/gtest.h>
 #include <boost/compute/core.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
 #include <vector>
 
 #define MAX_PRINT_FAILURES 3
@@ -50,6 +54,54 @@ public:
     void TearDown()
     {}
 
+    /*
+     * Gather the second buffer of data_object as strided object with
+     * four columns. The buffer holds the second segment of each column.
+     */
+    void write_and_get_strided(
+            Clustering::SimpleBufferCache& cache,
+            boost::compute::command_queue& q
+            )
+    {
+        boost::compute::event event;
+        boost::compute::wait_list wait_list;
+        Measurement::Measurement measurement;
+        Clustering::BufferCache::BufferList buffers;
+        size_t const num_dims = 4;
+        size_t const dim_ints = data_object.size() / num_dims;
+        size_t const buf_dim_ints = buffer_ints / num_dims;
+        int ret = 0;
+
+        uint32_t strided_oid = cache.add_strided_object(data_object.data(), object_size, num_dims);
+        ASSERT_NE(0u, strided_oid);
+
+        char *begin = (char*)data_object.data() + buffer_size;
+        char *end = begin + buffer_size;
+        ret = cache.write_and_get(q, strided_oid, begin, end, buffers, event, wait_list, measurement.add_datapoint());
+        ASSERT_EQ(true, ret);
+        event.wait();
+
+        std::vector<uint32_t> result(buffer_ints);
+        q.enqueue_read_buffer(buffers.front().buffer, 0, buffer_size, result.data());
+
+        uint32_t failed_fields = 0;
+        for (uint32_t i = 0; i < buffer_ints; ++i) {
+            uint32_t expected =
+                (i / buf_dim_ints) * dim_ints
+                + buf_dim_ints
+                + i % buf_dim_ints;
+            if (result[i] != expected) {
+                ++failed_fields;
+            }
+            if (failed_fields < MAX_PRINT_FAILURES) {
+                EXPECT_EQ(expected, result[i]) << "Buffer differs at index " << i;
+            }
+        }
+        EXPECT_EQ(0u, failed_fields);
+        ret = cache.unlock(q, strided_oid, buffers, event, wait_list, measurement.add_datapoint());
+        ASSERT_EQ(true, ret);
+    }
+
     size_t const buffer_size, buffer_ints, pool_size, object_size;
     uint32_t object_id;
     std::vector<uint32_t> data_object;
@@ -447,6 +499,146 @@ TEST_F(SimpleBufferCache, ParallelWrites)
     EXPECT_EQ(0u, failed_fields);
 }
 
+TEST_F(SimpleBufferCache, UnlockWithPendingEvent)
+{
+    boost::compute::event event;
+    boost::compute::wait_list wait_list;
+    Measurement::Measurement measurement;
+    Clustering::BufferCache::BufferList buffers;
+    int ret = 0;
+    uint32_t *begin = &data_object[0];
+    uint32_t *end = &data_object[buffer_ints];
+
+    ret = buffer_cache.write_and_get(queue, object_id, begin, end, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+    event.wait();
+
+    // Unlock must not block on a command that has not completed yet
+    boost::compute::user_event kernel_event(queue.get_context());
+    boost::compute::wait_list kernel_wait_list(kernel_event);
+    ret = buffer_cache.unlock(queue, object_id, buffers, event, kernel_wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+
+    // Slot is pending release, but may be locked again
+    boost::compute::event get_event;
+    ret = buffer_cache.get(queue, object_id, begin, end, buffers, get_event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+
+    kernel_event.set_status(boost::compute::event::complete);
+    get_event.wait();
+
+    ret = buffer_cache.unlock(queue, object_id, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+}
+
+TEST_F(SimpleBufferCache, WriteAndGetFileObject)
+{
+    boost::compute::event event;
+    boost::compute::wait_list wait_list;
+    Measurement::Measurement measurement;
+    Clustering::BufferCache::BufferList buffers;
+    char const *file_name = "buffer_cache_file_object.bin";
+    size_t const header_size = 4096;
+    int ret = 0;
+
+    {
+        std::vector<char> header(header_size, 0);
+        std::ofstream fs(file_name, std::fstream::binary | std::fstream::trunc);
+        fs.write(header.data(), header_size);
+        fs.write((char const*)data_object.data(), object_size);
+    }
+
+    uint32_t file_oid = buffer_cache.add_file_object(file_name, header_size, object_size);
+    ASSERT_NE(0u, file_oid);
+
+    void *object_ptr = nullptr;
+    size_t object_length = 0;
+    buffer_cache.object(file_oid, object_ptr, object_length);
+    ASSERT_EQ(object_size, object_length);
+
+    char *begin = (char*)object_ptr + buffer_size;
+    char *end = begin + buffer_size;
+    ret = buffer_cache.write_and_get(queue, file_oid, begin, end, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+    event.wait();
+
+    std::vector<uint32_t> result(buffer_ints);
+    queue.enqueue_read_buffer(buffers.front().buffer, 0, buffer_size, result.data());
+
+    uint32_t failed_fields = 0;
+    for (uint32_t i = 0; i < buffer_ints; ++i) {
+        if (result[i] != buffer_ints + i) {
+            ++failed_fields;
+        }
+        if (failed_fields < MAX_PRINT_FAILURES) {
+            EXPECT_EQ(buffer_ints + i, result[i]) << "Buffer differs at index " << i;
+        }
+    }
+    EXPECT_EQ(0u, failed_fields);
+    ret = buffer_cache.unlock(queue, file_oid, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+
+    std::remove(file_name);
+}
+
+TEST_F(SimpleBufferCache, WriteAndGetNoSlotsLeft)
+{
+    boost::compute::event event;
+    boost::compute::wait_list wait_list;
+    Measurement::Measurement measurement;
+    Clustering::BufferCache::BufferList buffers;
+    int ret = 0;
+
+    // The fixture's object takes the first pair of slots
+    size_t const max_objects = buffer_cache.max_objects(device);
+    EXPECT_EQ(pool_size / buffer_size / 2, max_objects);
+
+    uint32_t last_oid = object_id;
+    for (size_t i = 1; i < max_objects; ++i) {
+        last_oid = buffer_cache.add_object(data_object.data(), object_size);
+    }
+    uint32_t excess_oid = buffer_cache.add_object(data_object.data(), object_size);
+
+    char *begin = (char*)data_object.data();
+    char *end = begin + buffer_size;
+    ret = buffer_cache.write_and_get(queue, last_oid, begin, end, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+    ret = buffer_cache.unlock(queue, last_oid, buffers, event, wait_list, measurement.add_datapoint());
+    ASSERT_EQ(true, ret);
+
+    buffers.clear();
+    ret = buffer_cache.write_and_get(queue, excess_oid, begin, end, buffers, event, wait_list, measurement.add_datapoint());
+    EXPECT_GT(0, ret);
+}
+
+TEST_F(SimpleBufferCache, WriteAndGetStridedObject)
+{
+    write_and_get_strided(buffer_cache, queue);
+}
+
+TEST_F(SimpleBufferCache, WriteAndGetStridedObjectCPU)
+{
+    // CPU devices use zero-copy buffers, except for strided objects
+    auto devices = boost::compute::system::devices();
+    auto cpu = std::find_if(
+            devices.begin(),
+            devices.end(),
+            [](boost::compute::device const& d) {
+                return d.type() & boost::compute::device::cpu;
+            });
+    if (cpu == devices.end()) {
+        std::cout << "[ SKIPPED  ] No CPU device found" << std::endl;
+        return;
+    }
+
+    boost::compute::context cpu_context(*cpu);
+    boost::compute::command_queue cpu_queue(cpu_context, *cpu);
+    Clustering::SimpleBufferCache cpu_cache(buffer_size);
+    cpu_cache.add_device(cpu_context, *cpu, pool_size);
+
+    write_and_get_strided(cpu_cache, cpu_queue);
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
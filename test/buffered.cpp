@@ -0,0 +1,209 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_single_stage_buffered.hpp>
+#include <buffer_helper.hpp>
+#include <checkpoint.hpp>
+#include <measurement/measurement.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+#include <boost/compute/container/vector.hpp>
+
+namespace {
+
+KmeansProblem const problem(4, 4, 4096, 6);
+
+using Result = KmeansProblem::Result<true>;
+
+std::string const checkpoint_file = "buffered_test.checkpoint";
+
+Clustering::KmeansSingleStageBuffered<float, uint32_t, uint32_t>
+make_single_stage() {
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = "feature_sum";
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+
+    Clustering::KmeansSingleStageBuffered<float, uint32_t, uint32_t> kmeans;
+    kmeans.set_queue(clenv->queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+    // Several buffers per iteration
+    kmeans.set_buffer_size(
+            problem.num_points / 4 * problem.num_features * sizeof(float));
+
+    return kmeans;
+}
+
+uint64_t points_checksum() {
+    auto points = problem.make_points<true>();
+
+    return Clustering::BufferHelper::checksum(
+            points.get_data().data(),
+            points.get_data().size() * sizeof(float)
+            );
+}
+
+/*
+ * Write a checkpoint after iteration with the state of a job, as if the
+ * job was killed afterwards.
+ */
+void save_checkpoint(
+        uint32_t iteration,
+        Result const& state,
+        uint64_t checksum
+        ) {
+
+    boost::compute::vector<float> centroids(
+            state.centroids.get_data().begin(),
+            state.centroids.get_data().end(),
+            clenv->queue
+            );
+    boost::compute::vector<uint32_t> masses(
+            state.masses.begin(),
+            state.masses.end(),
+            clenv->queue
+            );
+
+    Measurement::Measurement measurement;
+    Clustering::Checkpoint<float, uint32_t> checkpoint;
+    checkpoint.set_file(checkpoint_file, 1);
+    checkpoint.set_points(problem.num_points, checksum);
+    checkpoint.save(
+            clenv->queue,
+            iteration,
+            problem.num_features,
+            problem.num_clusters,
+            centroids,
+            masses,
+            measurement.add_datapoint(iteration)
+            );
+    checkpoint.wait();
+}
+
+bool checkpoint_exists() {
+    return std::ifstream(checkpoint_file).good();
+}
+
+}
+
+TEST(Buffered, CheckpointResume) {
+    auto reference = problem.run_naive<true>();
+
+    // Cluster c of the saved state is cluster c + 1 of the reference,
+    // which the remaining iteration keeps
+    size_t const k = problem.num_clusters;
+    Result permuted = reference;
+    for (size_t c = 0; c < k; ++c) {
+        for (size_t f = 0; f < problem.num_features; ++f) {
+            permuted.centroids(c, f) = reference.centroids((c + 1) % k, f);
+        }
+        permuted.masses[c] = reference.masses[(c + 1) % k];
+    }
+    for (auto& label : permuted.labels) {
+        label = (label + k - 1) % k;
+    }
+
+    save_checkpoint(problem.num_iterations - 2, permuted, points_checksum());
+
+    auto kmeans = make_single_stage();
+    kmeans.set_checkpoint(checkpoint_file, 1);
+    problem.expect_equal(problem.run_kmeans<true>(kmeans), permuted);
+
+    // Completed runs don't leave a checkpoint to resume from
+    EXPECT_FALSE(checkpoint_exists());
+    problem.expect_equal(problem.run_kmeans<true>(kmeans), reference);
+    EXPECT_FALSE(checkpoint_exists());
+}
+
+TEST(Buffered, CheckpointOtherPoints) {
+    auto reference = problem.run_naive<true>();
+
+    // All points are closest to the first centroid
+    Result foreign = reference;
+    for (size_t c = 0; c < problem.num_clusters; ++c) {
+        for (size_t f = 0; f < problem.num_features; ++f) {
+            foreign.centroids(c, f) = 1000.0f * c;
+        }
+    }
+
+    save_checkpoint(0, foreign, points_checksum() + 1);
+
+    auto kmeans = make_single_stage();
+    kmeans.set_checkpoint(checkpoint_file, 1);
+    problem.expect_equal(problem.run_kmeans<true>(kmeans), reference);
+    EXPECT_FALSE(checkpoint_exists());
+}
+
+TEST(Buffered, AppendUpdate) {
+    auto reference = problem.run_naive<true>();
+    auto points = problem.make_points<true>();
+
+    // Cluster the first half, then append the second half
+    size_t const num_initial = problem.num_points / 2;
+    size_t const num_appended = problem.num_points - num_initial;
+    auto initial_points = std::make_shared<std::vector<float>>();
+    auto appended_points = std::make_shared<std::vector<float>>();
+    for (size_t f = 0; f < problem.num_features; ++f) {
+        for (size_t p = 0; p < problem.num_points; ++p) {
+            auto& part = (p < num_initial) ? initial_points : appended_points;
+            part->push_back(points(p, f));
+        }
+    }
+    ASSERT_EQ(num_appended * problem.num_features, appended_points->size());
+
+    auto centroids = std::make_shared<std::vector<float>>(
+            problem.first_centroids(points).get_data()
+            );
+    auto masses = std::make_shared<std::vector<uint32_t>>(
+            problem.num_clusters);
+    auto labels = std::make_shared<std::vector<uint32_t>>(num_initial);
+    auto appended_labels = std::make_shared<std::vector<uint32_t>>();
+
+    auto kmeans = make_single_stage();
+    kmeans(
+            problem.num_iterations,
+            problem.num_features,
+            initial_points,
+            centroids,
+            masses,
+            labels
+          );
+    kmeans.append(appended_points, appended_labels);
+    kmeans.update(2, 2);
+
+    labels->insert(
+            labels->end(),
+            appended_labels->begin(),
+            appended_labels->end());
+    problem.expect_equal(
+            problem.make_result<true>(*centroids, *masses, *labels),
+            reference
+            );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_three_stage.hpp>
+#include <kmeans_single_stage.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+
+namespace {
+
+// Kernels are specialized for the exact feature count, which need not be
+// a power of two
+std::vector<size_t> const feature_counts = {3, 6, 300};
+
+KmeansProblem make_problem(size_t num_features) {
+    return KmeansProblem(num_features, 4, 2048, 3);
+}
+
+KmeansProblem::Result<true> run_three_stage(KmeansProblem const& problem) {
+
+    Clustering::LabelingConfiguration ll_config = {};
+    ll_config.strategy = "unroll_vector";
+    ll_config.global_size[0] = 512;
+    ll_config.local_size[0] = 8;
+    ll_config.vector_length = 1;
+    ll_config.unroll_clusters_length = 1;
+    ll_config.unroll_features_length = 1;
+
+    Clustering::MassUpdateConfiguration mu_config = {};
+    mu_config.strategy = "part_global";
+    mu_config.global_size[0] = 128;
+    mu_config.local_size[0] = 1;
+    mu_config.vector_length = 8;
+
+    Clustering::CentroidUpdateConfiguration cu_config = {};
+    cu_config.strategy = "feature_sum";
+    cu_config.global_size[0] = 2048;
+    cu_config.local_size[0] = 8;
+    cu_config.local_features = 1;
+    cu_config.thread_features = 1;
+    cu_config.vector_length = 1;
+
+    Clustering::KmeansThreeStage<float, uint32_t, uint32_t, true> kmeans;
+    kmeans.set_labeling_queue(clenv->queue);
+    kmeans.set_mass_update_queue(clenv->queue);
+    kmeans.set_centroid_update_queue(clenv->queue);
+    kmeans.set_labeling_context(clenv->context);
+    kmeans.set_mass_update_context(clenv->context);
+    kmeans.set_centroid_update_context(clenv->context);
+    kmeans.set_labeler(ll_config);
+    kmeans.set_mass_updater(mu_config);
+    kmeans.set_centroid_updater(cu_config);
+
+    return problem.run_kmeans<true>(kmeans);
+}
+
+KmeansProblem::Result<true> run_single_stage(
+        KmeansProblem const& problem,
+        std::string fused_strategy
+        ) {
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = fused_strategy;
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+
+    Clustering::KmeansSingleStage<float, uint32_t, uint32_t, true> kmeans;
+    kmeans.set_queue(clenv->queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+
+    return problem.run_kmeans<true>(kmeans);
+}
+
+}
+
+TEST(FeatureCounts, ThreeStageUnrollVector) {
+    for (size_t num_features : feature_counts) {
+        SCOPED_TRACE(num_features);
+        auto problem = make_problem(num_features);
+        problem.expect_equal(
+                run_three_stage(problem),
+                problem.run_naive<true>()
+                );
+    }
+}
+
+TEST(FeatureCounts, SingleStageFeatureSum) {
+    for (size_t num_features : feature_counts) {
+        SCOPED_TRACE(num_features);
+        auto problem = make_problem(num_features);
+        problem.expect_equal(
+                run_single_stage(problem, "feature_sum"),
+                problem.run_naive<true>()
+                );
+    }
+}
+
+TEST(FeatureCounts, SingleStageClusterMerge) {
+    for (size_t num_features : feature_counts) {
+        SCOPED_TRACE(num_features);
+        auto problem = make_problem(num_features);
+        problem.expect_equal(
+                run_single_stage(problem, "cluster_merge"),
+                problem.run_naive<true>()
+                );
+    }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_three_stage.hpp>
+
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+
+namespace {
+
+// More features than fit into a single tile or constant memory,
+// and neither features nor clusters are multiples of the tile sizes
+KmeansProblem const problem(1500, 5, 2048, 3);
+
+template <bool ColMajor>
+using Result = KmeansProblem::Result<ColMajor>;
+
+template <bool ColMajor>
+Result<ColMajor> run_tiled(
+        size_t centroid_update_global_size,
+        std::string labeling_strategy = "tiled",
+        size_t centroid_update_tile_features = 64
+        ) {
+
+    Clustering::LabelingConfiguration ll_config = {};
+    ll_config.strategy = labeling_strategy;
+    ll_config.global_size[0] = 512;
+    ll_config.local_size[0] = 32;
+    ll_config.tile_features = 64;
+    ll_config.tile_clusters = 4;
+
+    Clustering::MassUpdateConfiguration mu_config = {};
+    mu_config.strategy = "part_global";
+    mu_config.global_size[0] = 128;
+    mu_config.local_size[0] = 1;
+    mu_config.vector_length = 8;
+
+    Clustering::CentroidUpdateConfiguration cu_config = {};
+    cu_config.strategy = "feature_sum_tiled";
+    cu_config.global_size[0] = centroid_update_global_size;
+    cu_config.local_size[0] = 16;
+    cu_config.tile_features = centroid_update_tile_features;
+
+    Clustering::KmeansThreeStage<float, uint32_t, uint32_t, ColMajor> kmeans;
+    kmeans.set_labeling_queue(clenv->queue);
+    kmeans.set_mass_update_queue(clenv->queue);
+    kmeans.set_centroid_update_queue(clenv->queue);
+    kmeans.set_labeling_context(clenv->context);
+    kmeans.set_mass_update_context(clenv->context);
+    kmeans.set_centroid_update_context(clenv->context);
+    kmeans.set_labeler(ll_config);
+    kmeans.set_mass_updater(mu_config);
+    kmeans.set_centroid_updater(cu_config);
+
+    return problem.run_kmeans<ColMajor>(kmeans);
+}
+
+}
+
+TEST(HighDimensional, ThreeStageTiled) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_tiled<true>(256), reference);
+    problem.expect_equal(run_tiled<false>(256), reference);
+}
+
+TEST(HighDimensional, ThreeStageTiledPointBlocks) {
+    // More work groups than feature tiles, summed over point blocks
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_tiled<true>(2048), reference);
+    problem.expect_equal(run_tiled<false>(2048), reference);
+}
+
+TEST(HighDimensional, ThreeStageTiledAsync) {
+    // Partial feature and cluster tiles alternate between both buffers
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_tiled<true>(256, "tiled_async"), reference);
+    problem.expect_equal(run_tiled<false>(256, "tiled_async"), reference);
+}
+
+TEST(HighDimensional, ThreeStageTiledLocalMemory) {
+    // Feature tiles of all clusters exceed any device's local memory
+    EXPECT_THROW(
+            run_tiled<true>(256, "tiled", 1 << 20),
+            std::invalid_argument
+            );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,182 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#ifndef KMEANS_PROBLEM_HPP
+#define KMEANS_PROBLEM_HPP
+
+#include <kmeans_naive.hpp>
+#include <matrix.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+/*
+ * Clustering problem with known result for testing pipelines against
+ * the naive k-means in either layout.
+ *
+ * Points are scattered closely around well-separated centers, such that
+ * labels don't depend on the summation order of the strategies.
+ * Point p belongs to cluster p % num_clusters, thus the first
+ * num_clusters points are good initial centroids.
+ */
+class KmeansProblem {
+public:
+    template <bool ColMajor>
+    using Matrix = cle::Matrix<float, std::allocator<float>, size_t, ColMajor>;
+
+    template <bool ColMajor>
+    struct Result {
+        Matrix<ColMajor> centroids;
+        std::vector<uint32_t> masses;
+        std::vector<uint32_t> labels;
+    };
+
+    KmeansProblem(
+            size_t num_features,
+            size_t num_clusters,
+            size_t num_points,
+            size_t num_iterations
+            ) :
+        num_features(num_features),
+        num_clusters(num_clusters),
+        num_points(num_points),
+        num_iterations(num_iterations)
+    {}
+
+    template <bool ColMajor>
+    Matrix<ColMajor> make_points() const {
+        Matrix<ColMajor> points;
+        points.resize(num_points, num_features);
+
+        std::default_random_engine rgen;
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+        for (size_t p = 0; p < num_points; ++p) {
+            for (size_t f = 0; f < num_features; ++f) {
+                float center = 16.0f * (p % num_clusters) + f % 16;
+                points(p, f) = center + noise(rgen);
+            }
+        }
+
+        return points;
+    }
+
+    template <bool ColMajor>
+    Matrix<ColMajor> first_centroids(Matrix<ColMajor> const& points) const {
+        Matrix<ColMajor> centroids;
+        centroids.resize(num_clusters, num_features);
+
+        for (size_t c = 0; c < num_clusters; ++c) {
+            for (size_t f = 0; f < num_features; ++f) {
+                centroids(c, f) = points(c, f);
+            }
+        }
+
+        return centroids;
+    }
+
+    template <bool ColMajor>
+    Result<ColMajor> run_naive() const {
+        auto points = make_points<ColMajor>();
+
+        Result<ColMajor> result;
+        result.centroids = first_centroids(points);
+        result.masses.resize(num_clusters);
+        result.labels.resize(num_points);
+
+        Clustering::KmeansNaive<float, uint32_t, uint32_t, ColMajor> kmeans;
+        kmeans.initialize();
+        kmeans(
+                num_iterations,
+                points,
+                result.centroids,
+                result.masses,
+                result.labels
+              );
+        kmeans.finalize();
+
+        return result;
+    }
+
+    /*
+     * Run a pipeline, which has all strategies and queues set.
+     */
+    template <bool ColMajor, typename Kmeans>
+    Result<ColMajor> run_kmeans(Kmeans& kmeans) const {
+        auto points = std::make_shared<Matrix<ColMajor>>(
+                make_points<ColMajor>()
+                );
+        auto centroids = std::make_shared<std::vector<float>>(
+                first_centroids(*points).get_data()
+                );
+        auto masses = std::make_shared<std::vector<uint32_t>>(num_clusters);
+        auto labels = std::make_shared<std::vector<uint32_t>>(num_points);
+
+        kmeans(
+                num_iterations,
+                num_features,
+                std::shared_ptr<const std::vector<float>>(
+                    points,
+                    &points->get_data()
+                    ),
+                centroids,
+                masses,
+                labels
+              );
+
+        return make_result<ColMajor>(*centroids, *masses, *labels);
+    }
+
+    template <bool ColMajor>
+    Result<ColMajor> make_result(
+            std::vector<float> centroids,
+            std::vector<uint32_t> const& masses,
+            std::vector<uint32_t> const& labels
+            ) const {
+
+        Result<ColMajor> result;
+        result.centroids = Matrix<ColMajor>(
+                std::move(centroids),
+                num_clusters,
+                num_features
+                );
+        result.masses = masses;
+        result.labels = labels;
+
+        return result;
+    }
+
+    template <bool ColMajorA, bool ColMajorB>
+    void expect_equal(
+            Result<ColMajorA> const& a,
+            Result<ColMajorB> const& b
+            ) const {
+
+        EXPECT_EQ(a.labels, b.labels);
+        EXPECT_EQ(a.masses, b.masses);
+
+        for (size_t c = 0; c < num_clusters; ++c) {
+            for (size_t f = 0; f < num_features; ++f) {
+                EXPECT_NEAR(a.centroids(c, f), b.centroids(c, f), 1e-3);
+            }
+        }
+    }
+
+    size_t const num_features;
+    size_t const num_clusters;
+    size_t const num_points;
+    size_t const num_iterations;
+};
+
+#endif /* KMEANS_PROBLEM_HPP */
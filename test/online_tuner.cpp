@@ -0,0 +1,284 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_three_stage.hpp>
+#include <kmeans_single_stage.hpp>
+#include <kmeans_single_stage_buffered.hpp>
+#include <online_tuner.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+#include <boost/compute/container/vector.hpp>
+
+namespace {
+
+// More iterations than launch variants, such that the fastest variant
+// runs the remaining iterations
+KmeansProblem const problem(4, 4, 4096, 12);
+
+template <typename Kmeans>
+KmeansProblem::Result<true> run_kmeans(Kmeans& kmeans) {
+    return problem.run_kmeans<true>(kmeans);
+}
+
+// Variants are timed by event profiling
+boost::compute::command_queue profiling_queue() {
+    return boost::compute::command_queue(
+            clenv->context,
+            clenv->device,
+            boost::compute::command_queue::enable_profiling
+            );
+}
+
+// Stub variant that spins for a fixed time per point on the device
+using StubVariant = std::function<boost::compute::event(
+        boost::compute::command_queue&,
+        boost::compute::kernel&,
+        size_t,
+        Measurement::DataPoint&,
+        boost::compute::wait_list const&
+        )>;
+
+char const spin_source[] = R"(
+__kernel void spin(__global float *out, uint iterations) {
+    float x = 0.0f;
+    for (uint i = 0; i < iterations; ++i) {
+        x = x * 0.5f + 1.0f;
+    }
+    out[0] = x;
+}
+)";
+
+constexpr size_t spin_per_point = 10000;
+
+StubVariant spin_variant(size_t time_per_point, size_t& calls) {
+    return [time_per_point, &calls](
+            boost::compute::command_queue& queue,
+            boost::compute::kernel& kernel,
+            size_t num_points,
+            Measurement::DataPoint& datapoint,
+            boost::compute::wait_list const& events
+            ) {
+        ++calls;
+        kernel.set_arg(
+                1,
+                (cl_uint) (time_per_point * num_points * spin_per_point));
+        boost::compute::event event = queue.enqueue_task(kernel, events);
+        datapoint.add_event() = event;
+        return event;
+    };
+}
+
+StubVariant failing_variant(size_t& calls) {
+    return [&calls](
+            boost::compute::command_queue&,
+            boost::compute::kernel&,
+            size_t,
+            Measurement::DataPoint&,
+            boost::compute::wait_list const&
+            ) -> boost::compute::event {
+        ++calls;
+        throw boost::compute::opencl_error(CL_OUT_OF_RESOURCES);
+    };
+}
+
+Clustering::KmeansThreeStage<float, uint32_t, uint32_t, true>
+make_three_stage(boost::compute::command_queue queue) {
+
+    Clustering::LabelingConfiguration ll_config = {};
+    ll_config.strategy = "unroll_vector";
+    ll_config.global_size[0] = 512;
+    ll_config.local_size[0] = 8;
+    ll_config.vector_length = 1;
+    ll_config.unroll_clusters_length = 1;
+    ll_config.unroll_features_length = 1;
+    ll_config.autotune = true;
+
+    Clustering::MassUpdateConfiguration mu_config = {};
+    mu_config.strategy = "part_global";
+    mu_config.global_size[0] = 128;
+    mu_config.local_size[0] = 1;
+    mu_config.vector_length = 8;
+
+    Clustering::CentroidUpdateConfiguration cu_config = {};
+    cu_config.strategy = "feature_sum";
+    cu_config.global_size[0] = 2048;
+    cu_config.local_size[0] = 8;
+    cu_config.local_features = 1;
+    cu_config.thread_features = 1;
+    cu_config.vector_length = 1;
+
+    Clustering::KmeansThreeStage<float, uint32_t, uint32_t, true> kmeans;
+    kmeans.set_labeling_queue(queue);
+    kmeans.set_mass_update_queue(queue);
+    kmeans.set_centroid_update_queue(queue);
+    kmeans.set_labeling_context(clenv->context);
+    kmeans.set_mass_update_context(clenv->context);
+    kmeans.set_centroid_update_context(clenv->context);
+    kmeans.set_labeler(ll_config);
+    kmeans.set_mass_updater(mu_config);
+    kmeans.set_centroid_updater(cu_config);
+
+    return kmeans;
+}
+
+Clustering::KmeansSingleStage<float, uint32_t, uint32_t, true>
+make_single_stage(
+        boost::compute::command_queue queue,
+        std::string fused_strategy
+        ) {
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = fused_strategy;
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+    fu_config.autotune = true;
+
+    Clustering::KmeansSingleStage<float, uint32_t, uint32_t, true> kmeans;
+    kmeans.set_queue(queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+
+    return kmeans;
+}
+
+Clustering::KmeansSingleStageBuffered<float, uint32_t, uint32_t, true>
+make_single_stage_buffered(boost::compute::command_queue queue) {
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = "feature_sum";
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+    fu_config.autotune = true;
+
+    Clustering::KmeansSingleStageBuffered<float, uint32_t, uint32_t, true>
+        kmeans;
+    kmeans.set_queue(queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+    // Three buffers per iteration, the last one holds fewer points
+    kmeans.set_buffer_size(1536 * problem.num_features * sizeof(float));
+
+    return kmeans;
+}
+
+}
+
+TEST(OnlineTuner, LaunchVariants) {
+    Clustering::LabelingConfiguration config = {};
+    config.global_size[0] = 512;
+    config.local_size[0] = 8;
+
+    auto variants = Clustering::launch_variants(config, 8);
+
+    // Global sizes 256, 512 and 1024 with local sizes 4 and 8
+    ASSERT_EQ(6u, variants.size());
+    EXPECT_EQ(512u, variants[0].global_size[0]);
+    EXPECT_EQ(8u, variants[0].local_size[0]);
+    for (auto const& variant : variants) {
+        EXPECT_LE(variant.local_size[0], 8u);
+        EXPECT_EQ(0u, variant.global_size[0] % variant.local_size[0]);
+    }
+}
+
+TEST(OnlineTuner, StubVariants) {
+    auto queue = profiling_queue();
+    auto program = boost::compute::program::build_with_source(
+            spin_source,
+            clenv->context
+            );
+    boost::compute::kernel kernel = program.create_kernel("spin");
+    boost::compute::vector<float> out(1, clenv->context);
+    kernel.set_arg(0, out);
+
+    std::vector<size_t> calls(4, 0);
+    Clustering::OnlineTuner<StubVariant> tuner({
+            spin_variant(4, calls[0]),
+            failing_variant(calls[1]),
+            spin_variant(2, calls[2]),
+            spin_variant(8, calls[3])
+            });
+
+    // The first calls try the variants in turn. The failed variant is
+    // skipped within the same call. The last variant takes the least
+    // total time, but the most time per point.
+    Measurement::Measurement measurement;
+    boost::compute::wait_list events;
+    for (size_t num_points : {64, 64, 8, 64, 64}) {
+        tuner(
+                queue,
+                kernel,
+                num_points,
+                measurement.add_datapoint(),
+                events
+             );
+    }
+    queue.finish();
+
+    // The variant with the least time per point runs the remaining calls
+    EXPECT_EQ(1u, calls[0]);
+    EXPECT_EQ(1u, calls[1]);
+    EXPECT_EQ(3u, calls[2]);
+    EXPECT_EQ(1u, calls[3]);
+}
+
+TEST(OnlineTuner, ThreeStageLabeling) {
+    auto reference = problem.run_naive<true>();
+    auto kmeans = make_three_stage(profiling_queue());
+    problem.expect_equal(run_kmeans(kmeans), reference);
+
+    // The fastest variant runs all iterations
+    problem.expect_equal(run_kmeans(kmeans), reference);
+}
+
+TEST(OnlineTuner, SingleStageFeatureSum) {
+    auto reference = problem.run_naive<true>();
+    auto kmeans = make_single_stage(profiling_queue(), "feature_sum");
+    problem.expect_equal(run_kmeans(kmeans), reference);
+    problem.expect_equal(run_kmeans(kmeans), reference);
+}
+
+TEST(OnlineTuner, SingleStageClusterMerge) {
+    auto reference = problem.run_naive<true>();
+    auto kmeans = make_single_stage(profiling_queue(), "cluster_merge");
+    problem.expect_equal(run_kmeans(kmeans), reference);
+    problem.expect_equal(run_kmeans(kmeans), reference);
+}
+
+TEST(OnlineTuner, SingleStageBuffered) {
+    auto reference = problem.run_naive<true>();
+    auto kmeans = make_single_stage_buffered(profiling_queue());
+    problem.expect_equal(run_kmeans(kmeans), reference);
+    problem.expect_equal(run_kmeans(kmeans), reference);
+}
+
+TEST(OnlineTuner, DefaultQueue) {
+    // Keeps the configured variant if the queue doesn't profile
+    auto reference = problem.run_naive<true>();
+    auto kmeans = make_three_stage(clenv->queue);
+    problem.expect_equal(run_kmeans(kmeans), reference);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_three_stage.hpp>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+
+namespace {
+
+// Enough iterations for stages of consecutive iterations to overlap if
+// any dependency is missing
+KmeansProblem const problem(4, 4, 4096, 12);
+
+template <bool ColMajor>
+using Result = KmeansProblem::Result<ColMajor>;
+
+bool out_of_order_supported() {
+    return clenv->device.get_info<cl_command_queue_properties>(
+            CL_DEVICE_QUEUE_PROPERTIES)
+        & boost::compute::command_queue::enable_out_of_order_execution;
+}
+
+boost::compute::command_queue out_of_order_queue() {
+    return boost::compute::command_queue(
+            clenv->context,
+            clenv->device,
+            boost::compute::command_queue::enable_out_of_order_execution
+            );
+}
+
+/*
+ * Run each stage on its own out-of-order queue, such that only the
+ * events between stages order the commands.
+ */
+template <bool ColMajor>
+Result<ColMajor> run_three_stage(std::string centroid_update_strategy) {
+
+    Clustering::LabelingConfiguration ll_config = {};
+    ll_config.strategy = "unroll_vector";
+    ll_config.global_size[0] = 512;
+    ll_config.local_size[0] = 8;
+    ll_config.vector_length = 1;
+    ll_config.unroll_clusters_length = 1;
+    ll_config.unroll_features_length = 1;
+
+    Clustering::MassUpdateConfiguration mu_config = {};
+    mu_config.strategy = "part_global";
+    mu_config.global_size[0] = 128;
+    mu_config.local_size[0] = 1;
+    mu_config.vector_length = 8;
+
+    Clustering::CentroidUpdateConfiguration cu_config = {};
+    cu_config.strategy = centroid_update_strategy;
+    cu_config.global_size[0] = 2048;
+    cu_config.local_size[0] = 8;
+    cu_config.local_features = 1;
+    cu_config.thread_features = 1;
+    cu_config.vector_length = 1;
+
+    Clustering::KmeansThreeStage<float, uint32_t, uint32_t, ColMajor> kmeans;
+    kmeans.set_labeling_queue(out_of_order_queue());
+    kmeans.set_mass_update_queue(out_of_order_queue());
+    kmeans.set_centroid_update_queue(out_of_order_queue());
+    kmeans.set_labeling_context(clenv->context);
+    kmeans.set_mass_update_context(clenv->context);
+    kmeans.set_centroid_update_context(clenv->context);
+    kmeans.set_labeler(ll_config);
+    kmeans.set_mass_updater(mu_config);
+    kmeans.set_centroid_updater(cu_config);
+
+    return problem.run_kmeans<ColMajor>(kmeans);
+}
+
+}
+
+TEST(OutOfOrder, ThreeStageFeatureSum) {
+    if (not out_of_order_supported()) {
+        return;
+    }
+
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("feature_sum"), reference);
+    problem.expect_equal(run_three_stage<false>("feature_sum"), reference);
+}
+
+TEST(OutOfOrder, ThreeStageClusterMerge) {
+    if (not out_of_order_supported()) {
+        return;
+    }
+
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("cluster_merge"), reference);
+    problem.expect_equal(run_three_stage<false>("cluster_merge"), reference);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
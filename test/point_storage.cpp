@@ -0,0 +1,233 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <point_storage.hpp>
+#include <kmeans_single_stage_buffered.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+
+using Clustering::Half;
+using Clustering::BFloat16;
+using Clustering::PointStorage;
+
+TEST(PointStorage, HalfExact) {
+    EXPECT_EQ(0x0000, Half(0.0f).bits);
+    EXPECT_EQ(0x8000, Half(-0.0f).bits);
+    EXPECT_EQ(0x3c00, Half(1.0f).bits);
+    EXPECT_EQ(0xc100, Half(-2.5f).bits);
+    EXPECT_EQ(0x7bff, Half(65504.0f).bits);
+    EXPECT_EQ(0x0400, Half(std::ldexp(1.0f, -14)).bits);
+    EXPECT_EQ(0x0001, Half(std::ldexp(1.0f, -24)).bits);
+}
+
+TEST(PointStorage, HalfRoundToNearestEven) {
+    // Ties round to the even mantissa
+    EXPECT_EQ(0x3c00, Half(1.0f + std::ldexp(1.0f, -11)).bits);
+    EXPECT_EQ(0x3c02, Half(1.0f + 3.0f * std::ldexp(1.0f, -11)).bits);
+    EXPECT_EQ(0x0000, Half(std::ldexp(1.0f, -25)).bits);
+    EXPECT_EQ(0x0002, Half(3.0f * std::ldexp(1.0f, -25)).bits);
+
+    // Overflow to infinity
+    EXPECT_EQ(0x7bff, Half(65519.0f).bits);
+    EXPECT_EQ(0x7c00, Half(65520.0f).bits);
+}
+
+TEST(PointStorage, HalfSpecial) {
+    float const inf = std::numeric_limits<float>::infinity();
+    EXPECT_EQ(0x7c00, Half(inf).bits);
+    EXPECT_EQ(0xfc00, Half(-inf).bits);
+    EXPECT_TRUE(std::isnan((float) Half(std::nanf(""))));
+}
+
+TEST(PointStorage, HalfRoundTrip) {
+    for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+        Half h;
+        h.bits = bits;
+        float value = h;
+        if (not std::isnan(value)) {
+            EXPECT_EQ(bits, Half(value).bits);
+        }
+    }
+}
+
+TEST(PointStorage, BFloat16) {
+    EXPECT_EQ(0x3f80, BFloat16(1.0f).bits);
+    EXPECT_EQ(0xc020, BFloat16(-2.5f).bits);
+    EXPECT_EQ(0x4049, BFloat16(3.14159f).bits);
+
+    // Ties round to the even mantissa
+    EXPECT_EQ(0x3f80, BFloat16(1.0f + std::ldexp(1.0f, -8)).bits);
+    EXPECT_EQ(0x3f82, BFloat16(1.0f + 3.0f * std::ldexp(1.0f, -8)).bits);
+
+    EXPECT_TRUE(std::isnan((float) BFloat16(std::nanf(""))));
+
+    for (uint32_t bits = 0; bits <= 0xffff; ++bits) {
+        BFloat16 b;
+        b.bits = bits;
+        float value = b;
+        if (not std::isnan(value)) {
+            EXPECT_EQ(bits, BFloat16(value).bits);
+        }
+    }
+}
+
+TEST(PointStorage, Quantization) {
+    // Two points, two features, column major
+    std::vector<float> points = {-1.0f, 1.0f, 10.0f, 10.0f};
+    auto q = Clustering::Quantization::fit(points.data(), 2, 2, true);
+
+    EXPECT_FLOAT_EQ(2.0f / 255.0f, q.scale[0]);
+    EXPECT_FLOAT_EQ(-1.0f, q.offset[0]);
+    EXPECT_FLOAT_EQ(1.0f, q.scale[1]);
+    EXPECT_FLOAT_EQ(10.0f, q.offset[1]);
+
+    EXPECT_EQ(0, q.quantize(-1.0f, 0));
+    EXPECT_EQ(255, q.quantize(1.0f, 0));
+    EXPECT_EQ(0, q.quantize(-2.0f, 0));
+    EXPECT_EQ(255, q.quantize(2.0f, 0));
+    EXPECT_EQ(0, q.quantize(10.0f, 1));
+
+    for (float value = -1.0f; value <= 1.0f; value += 0.01f) {
+        EXPECT_NEAR(value, q.dequantize(q.quantize(value, 0), 0), q.scale[0] / 2);
+    }
+}
+
+namespace {
+
+size_t const num_features = 4;
+size_t const num_clusters = 4;
+size_t const num_points = 4096;
+size_t const num_iterations = 3;
+
+/*
+ * Column-major points scattered closely around well-separated centers.
+ * Point p belongs to cluster p % num_clusters.
+ */
+std::vector<float> make_points() {
+    std::vector<float> points(num_points * num_features);
+
+    std::default_random_engine rgen;
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+    for (size_t p = 0; p < num_points; ++p) {
+        for (size_t f = 0; f < num_features; ++f) {
+            float center = 16.0f * (p % num_clusters) + f;
+            points[f * num_points + p] = center + noise(rgen);
+        }
+    }
+
+    return points;
+}
+
+struct Result {
+    std::vector<float> centroids;
+    std::vector<uint32_t> masses;
+    std::vector<uint32_t> labels;
+};
+
+Result run_buffered(PointStorage storage) {
+    auto points = std::make_shared<std::vector<float>>(make_points());
+
+    Result result;
+    result.centroids.resize(num_clusters * num_features);
+    for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t f = 0; f < num_features; ++f) {
+            result.centroids[f * num_clusters + c] =
+                (*points)[f * num_points + c];
+        }
+    }
+
+    auto centroids = std::make_shared<std::vector<float>>(result.centroids);
+    auto masses = std::make_shared<std::vector<uint32_t>>(num_clusters);
+    auto labels = std::make_shared<std::vector<uint32_t>>(num_points);
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = "feature_sum";
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+    fu_config.point_storage = storage;
+    fu_config.quantization = Clustering::Quantization::fit(
+            points->data(),
+            num_points,
+            num_features,
+            true
+            );
+
+    Clustering::KmeansSingleStageBuffered<float, uint32_t, uint32_t> kmeans;
+    kmeans.set_queue(clenv->queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+    kmeans.set_buffer_size(num_points / 4 * num_features * sizeof(float));
+
+    kmeans(
+            num_iterations,
+            num_features,
+            points,
+            centroids,
+            masses,
+            labels
+          );
+
+    result.centroids = *centroids;
+    result.masses = *masses;
+    result.labels = *labels;
+
+    return result;
+}
+
+void expect_close(Result const& a, Result const& b) {
+    EXPECT_EQ(a.labels, b.labels);
+    EXPECT_EQ(a.masses, b.masses);
+
+    for (size_t i = 0; i < num_clusters * num_features; ++i) {
+        EXPECT_NEAR(a.centroids[i], b.centroids[i], 1e-2);
+    }
+}
+
+}
+
+TEST(PointStorage, SingleStageBufferedHalf) {
+    expect_close(
+            run_buffered(PointStorage::Half),
+            run_buffered(PointStorage::Native)
+            );
+}
+
+TEST(PointStorage, SingleStageBufferedBFloat16) {
+    expect_close(
+            run_buffered(PointStorage::BFloat16),
+            run_buffered(PointStorage::Native)
+            );
+}
+
+TEST(PointStorage, SingleStageBufferedInt8) {
+    expect_close(
+            run_buffered(PointStorage::Int8),
+            run_buffered(PointStorage::Native)
+            );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
@@ -220,6 +220,30 @@ TEST(ReduceVectorParcol, FurySize) {
                 ));
 }
 
+TEST(ReduceVectorParcol, OddSize) {
+
+    // e.g. 3 features and 5 clusters over 1000 tiles
+    auto const& data = dgen.def_size(3 * 5, 1000);
+    std::vector<uint32_t> test_output;
+    std::vector<uint32_t> verify_output;
+    Measurement::Measurement measurement;
+
+    reduce_vector_run(
+            clenv->context,
+            clenv->queue,
+            data,
+            test_output,
+            measurement
+            );
+    reduce_vector_verify(data, verify_output);
+
+    EXPECT_TRUE(std::equal(
+                test_output.begin(),
+                test_output.end(),
+                verify_output.begin()
+                ));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   clenv = new CLEnvironment;
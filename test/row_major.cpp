@@ -0,0 +1,138 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include <kmeans_three_stage.hpp>
+#include <kmeans_single_stage.hpp>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kmeans_problem.hpp"
+#include "opencl_setup.hpp"
+
+#include <boost/compute/core.hpp>
+
+namespace {
+
+KmeansProblem const problem(4, 4, 4096, 3);
+
+template <bool ColMajor>
+using Result = KmeansProblem::Result<ColMajor>;
+
+template <bool ColMajor>
+Result<ColMajor> run_three_stage(
+        std::string centroid_update_strategy,
+        size_t labeling_vector_length
+        ) {
+
+    Clustering::LabelingConfiguration ll_config = {};
+    ll_config.strategy = "unroll_vector";
+    ll_config.global_size[0] = 512;
+    ll_config.local_size[0] = 8;
+    ll_config.vector_length = labeling_vector_length;
+    ll_config.unroll_clusters_length = 1;
+    ll_config.unroll_features_length = 1;
+
+    Clustering::MassUpdateConfiguration mu_config = {};
+    mu_config.strategy = "part_global";
+    mu_config.global_size[0] = 128;
+    mu_config.local_size[0] = 1;
+    mu_config.vector_length = 8;
+
+    Clustering::CentroidUpdateConfiguration cu_config = {};
+    cu_config.strategy = centroid_update_strategy;
+    cu_config.global_size[0] = 2048;
+    cu_config.local_size[0] = 8;
+    cu_config.local_features = 1;
+    cu_config.thread_features = 1;
+    cu_config.vector_length = 1;
+
+    Clustering::KmeansThreeStage<float, uint32_t, uint32_t, ColMajor> kmeans;
+    kmeans.set_labeling_queue(clenv->queue);
+    kmeans.set_mass_update_queue(clenv->queue);
+    kmeans.set_centroid_update_queue(clenv->queue);
+    kmeans.set_labeling_context(clenv->context);
+    kmeans.set_mass_update_context(clenv->context);
+    kmeans.set_centroid_update_context(clenv->context);
+    kmeans.set_labeler(ll_config);
+    kmeans.set_mass_updater(mu_config);
+    kmeans.set_centroid_updater(cu_config);
+
+    return problem.run_kmeans<ColMajor>(kmeans);
+}
+
+template <bool ColMajor>
+Result<ColMajor> run_single_stage(std::string fused_strategy) {
+
+    Clustering::FusedConfiguration fu_config = {};
+    fu_config.strategy = fused_strategy;
+    fu_config.global_size[0] = 512;
+    fu_config.local_size[0] = 8;
+    fu_config.vector_length = 1;
+
+    Clustering::KmeansSingleStage<float, uint32_t, uint32_t, ColMajor> kmeans;
+    kmeans.set_queue(clenv->queue);
+    kmeans.set_context(clenv->context);
+    kmeans.set_fused(fu_config);
+
+    return problem.run_kmeans<ColMajor>(kmeans);
+}
+
+}
+
+TEST(RowMajor, Naive) {
+    problem.expect_equal(
+            problem.run_naive<false>(),
+            problem.run_naive<true>()
+            );
+}
+
+TEST(RowMajor, ThreeStageFeatureSum) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("feature_sum", 1), reference);
+    problem.expect_equal(run_three_stage<false>("feature_sum", 1), reference);
+}
+
+TEST(RowMajor, ThreeStageFeatureSumPardim) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("feature_sum_pardim", 1), reference);
+    problem.expect_equal(run_three_stage<false>("feature_sum_pardim", 1), reference);
+}
+
+TEST(RowMajor, ThreeStageClusterMerge) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("cluster_merge", 1), reference);
+    problem.expect_equal(run_three_stage<false>("cluster_merge", 1), reference);
+}
+
+TEST(RowMajor, ThreeStageVectorLabeling) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_three_stage<true>("feature_sum", 4), reference);
+    problem.expect_equal(run_three_stage<false>("feature_sum", 4), reference);
+}
+
+TEST(RowMajor, SingleStageFeatureSum) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_single_stage<true>("feature_sum"), reference);
+    problem.expect_equal(run_single_stage<false>("feature_sum"), reference);
+}
+
+TEST(RowMajor, SingleStageClusterMerge) {
+    auto reference = problem.run_naive<true>();
+    problem.expect_equal(run_single_stage<true>("cluster_merge"), reference);
+    problem.expect_equal(run_single_stage<false>("cluster_merge"), reference);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  clenv = new CLEnvironment;
+  ::testing::AddGlobalTestEnvironment(clenv);
+  return RUN_ALL_TESTS();
+}
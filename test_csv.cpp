@@ -56,6 +56,14 @@ int main(int argc, char **argv) {
 
     std::cout << "Matrix runtime: " << duration << " µs" << std::endl;
 
+    cle::Matrix<float, std::allocator<float>, uint32_t> parallel_matrix;
+
+    timer.start();
+    csv.read_csv_parallel(file_name, parallel_matrix);
+    duration = timer.stop<std::chrono::microseconds>();
+
+    std::cout << "Parallel matrix runtime: " << duration << " µs" << std::endl;
+
     // for (auto& v : array) {
     //     cle::Utils::print_vector(v);
     // }
@@ -69,4 +77,9 @@ int main(int argc, char **argv) {
         std::cout << "Mismatch between read_csv and read_csv_dynamic!!"
             << std::endl;
     }
+
+    if (not std::equal(matrix.begin(), matrix.end(), parallel_matrix.begin())) {
+        std::cout << "Mismatch between read_csv and read_csv_parallel!!"
+            << std::endl;
+    }
 }
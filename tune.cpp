@@ -0,0 +1,833 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file, You can
+ * obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *
+ * Copyright (c) 2018, Lutz, Clemens <lutzcle@cml.li>
+ */
+
+#include "clustering_benchmark.hpp"
+#include "matrix.hpp"
+
+#include "centroid_update_configuration.hpp"
+#include "fused_configuration.hpp"
+#include "labeling_configuration.hpp"
+#include "mass_update_configuration.hpp"
+
+#include "kmeans_three_stage.hpp"
+#include "kmeans_single_stage.hpp"
+#include "kmeans_naive.hpp"
+#include "kmeans_initializer.hpp"
+
+#include "SystemConfig.h"
+
+#include <boost/program_options.hpp>
+#include <boost/compute/core.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Suppress editor errors about TUNE_NAME not defined
+#ifndef TUNE_NAME
+#define TUNE_NAME ""
+#endif
+
+namespace po = boost::program_options;
+namespace bc = boost::compute;
+
+class CmdOptions {
+public:
+    int parse(int argc, char **argv) {
+        char help_msg[] =
+            "Usage: " TUNE_NAME " [OPTION] [OUTPUT FILE]\n"
+            "Search the fastest configuration for a device, number of\n"
+            "features and clusters. Writes the configuration to OUTPUT FILE,\n"
+            "or to stdout if none is given.\n"
+            "Options"
+            ;
+
+        po::options_description cmdline(help_msg);
+        cmdline.add_options()
+            ("help", "Produce help message")
+            ("verbose", "Show timings of all candidates")
+            ("platform", po::value<size_t>(&platform_)->default_value(0),
+             "OpenCL platform index")
+            ("device", po::value<size_t>(&device_)->default_value(0),
+             "OpenCL device index")
+            ("features", po::value<size_t>(&features_),
+             "Number of features (aka. dimensions)")
+            ("k", po::value<size_t>(&k_),
+             "Number of clusters")
+            ("size", po::value<uint64_t>(&megabytes_)->default_value(64),
+             "Size of generated points in MiB")
+            ("iterations", po::value<size_t>(&iterations_)->default_value(10),
+             "Number of iterations per measured run")
+            ("candidates", po::value<size_t>(&candidates_)->default_value(64),
+             "Number of sampled configurations")
+            ("pipeline", po::value<std::string>(&pipeline_)->default_value("all"),
+             "Pipeline to tune (three_stage, single_stage or all)")
+            ("seed", po::value<uint64_t>(&seed_)->default_value(0),
+             "Random seed of points and sampled configurations")
+            ;
+
+        po::options_description hidden("Hidden options");
+        hidden.add_options()
+            ("output-file", po::value<std::string>(&output_file_),
+             "output file")
+            ;
+
+        po::options_description visible;
+        visible.add(cmdline).add(hidden);
+
+        po::positional_options_description pos;
+        pos.add("output-file", 1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(visible)
+                .positional(pos).run(),
+                vm);
+        po::notify(vm);
+
+        if (vm.count("help")) {
+            std::cout << cmdline << std::endl;
+            return -1;
+        }
+
+        if (vm.count("verbose")) {
+            verbose_ = true;
+        }
+
+        // Ensure we have required options
+        if (features_ == 0 || k_ == 0) {
+            std::cout << "Number of features and clusters required." << std::endl;
+            return -1;
+        }
+
+        if (pipeline_ != "three_stage" && pipeline_ != "single_stage"
+                && pipeline_ != "all") {
+            std::cout << "Pipeline must be three_stage, single_stage or all!" << std::endl;
+            return -1;
+        }
+
+        if (iterations_ < 2 || candidates_ == 0) {
+            std::cout << "Need at least two iterations and one candidate!" << std::endl;
+            return -1;
+        }
+
+        return 1;
+    }
+
+    bool verbose() const {
+        return verbose_;
+    }
+
+    size_t platform() const {
+        return platform_;
+    }
+
+    size_t device() const {
+        return device_;
+    }
+
+    size_t features() const {
+        return features_;
+    }
+
+    size_t k() const {
+        return k_;
+    }
+
+    uint64_t bytes() const {
+        return megabytes_ * 1024 * 1024;
+    }
+
+    size_t iterations() const {
+        return iterations_;
+    }
+
+    size_t candidates() const {
+        return candidates_;
+    }
+
+    std::string pipeline() const {
+        return pipeline_;
+    }
+
+    uint64_t seed() const {
+        return seed_;
+    }
+
+    std::string output_file() const {
+        return output_file_;
+    }
+
+private:
+    bool verbose_ = false;
+    size_t platform_ = 0;
+    size_t device_ = 0;
+    size_t features_ = 0;
+    size_t k_ = 0;
+    uint64_t megabytes_ = 0;
+    size_t iterations_ = 0;
+    size_t candidates_ = 0;
+    std::string pipeline_;
+    uint64_t seed_ = 0;
+    std::string output_file_;
+};
+
+/*
+ * Offline autotuner
+ *
+ * Samples random configurations from the parameter space of all
+ * strategies, and discards those that violate a strategy's constraints
+ * or the device's limits. Candidates are ranked by successive halving:
+ * each round measures all remaining candidates and keeps the faster
+ * half, and the next round doubles the number of measured runs.
+ *
+ * Every candidate is verified against the naive k-means before it is
+ * measured. This also compiles the kernels, such that measured runs
+ * exclude compilation.
+ */
+class Tuner {
+public:
+    using PointT = float;
+    using LabelT = uint32_t;
+    using MassT = uint32_t;
+    static constexpr bool ColMajor = true;
+
+    using Points = cle::Matrix<PointT, std::allocator<PointT>, size_t, ColMajor>;
+    using Benchmark =
+        Clustering::ClusteringBenchmark<PointT, LabelT, MassT, ColMajor>;
+    using ClusteringFunction = Benchmark::ClClusteringFunction;
+
+    struct Candidate {
+        std::string pipeline;
+        Clustering::LabelingConfiguration ll_config;
+        Clustering::MassUpdateConfiguration mu_config;
+        Clustering::CentroidUpdateConfiguration cu_config;
+        Clustering::FusedConfiguration fu_config;
+        uint64_t microseconds;
+    };
+
+    int run(CmdOptions const& options) {
+        this->options = options;
+
+        this->device = bc::system::platforms()[options.platform()]
+            .devices()[options.device()];
+        this->context = bc::context(this->device);
+        this->queue = bc::command_queue(
+                this->context,
+                this->device,
+                bc::command_queue::enable_profiling);
+
+        // Vectorized labeling requires a multiple of the vector length
+        this->num_points = options.bytes() / sizeof(PointT)
+            / options.features();
+        this->num_points -= this->num_points % MAX_VECTOR_LENGTH;
+        if (this->num_points < options.k()) {
+            std::cerr << "Size too small for " << options.k()
+                << " clusters" << std::endl;
+            return -1;
+        }
+
+        std::cerr
+            << "Tuning " << this->device.name()
+            << " for " << options.features() << " features, "
+            << options.k() << " clusters and "
+            << this->num_points << " points"
+            << std::endl;
+
+        std::vector<Candidate> candidates = sample_candidates();
+        if (candidates.empty()) {
+            std::cerr << "No valid configuration found" << std::endl;
+            return -1;
+        }
+
+        Points points = generate_points();
+
+        // Two iterations, such that the second labeling depends on the
+        // first centroid update
+        Benchmark verify_bm(
+                1,
+                this->num_points,
+                VERIFY_ITERATIONS,
+                Points(points));
+        verify_bm.initialize(
+                options.k(),
+                options.features(),
+                Clustering::KmeansInitializer<PointT, ColMajor>::first_x);
+
+        Clustering::KmeansNaive<PointT, LabelT, MassT, ColMajor> kmeans_naive;
+        kmeans_naive.initialize();
+        verify_bm.setVerificationReference(kmeans_naive);
+        kmeans_naive.finalize();
+
+        Benchmark bm(
+                1,
+                this->num_points,
+                options.iterations(),
+                std::move(points));
+        bm.initialize(
+                options.k(),
+                options.features(),
+                Clustering::KmeansInitializer<PointT, ColMajor>::first_x);
+
+        size_t runs = 1;
+        while (true) {
+            std::cerr
+                << "Measuring " << candidates.size()
+                << " candidates with " << runs << " runs"
+                << std::endl;
+
+            std::vector<Candidate> survivors;
+            for (Candidate& candidate : candidates) {
+                if (measure(candidate, runs, verify_bm, bm) > 0) {
+                    survivors.push_back(candidate);
+                }
+            }
+
+            std::sort(
+                    survivors.begin(),
+                    survivors.end(),
+                    [](Candidate const& a, Candidate const& b) {
+                        return a.microseconds < b.microseconds;
+                    });
+
+            candidates = std::move(survivors);
+            candidates.resize((candidates.size() + 1) / 2);
+            if (candidates.size() <= 1) {
+                break;
+            }
+
+            runs *= 2;
+        }
+
+        verify_bm.finalize();
+        bm.finalize();
+
+        if (candidates.empty()) {
+            std::cerr << "All candidates failed" << std::endl;
+            return -1;
+        }
+
+        Candidate const& best = candidates.front();
+        std::cerr
+            << "Best configuration takes " << best.microseconds
+            << " us for " << options.iterations() << " iterations"
+            << std::endl;
+
+        if (options.output_file().empty()) {
+            write_configuration(std::cout, best);
+        }
+        else {
+            std::ofstream file(options.output_file());
+            if (not file) {
+                std::cerr << "Cannot open " << options.output_file()
+                    << std::endl;
+                return -1;
+            }
+            write_configuration(file, best);
+        }
+
+        return 1;
+    }
+
+private:
+    static constexpr size_t MAX_VECTOR_LENGTH = 16;
+    static constexpr size_t MAX_UNROLL_FEATURES = 1024;
+    static constexpr size_t VERIFY_ITERATIONS = 2;
+    static constexpr size_t MIN_GLOBAL_SIZE = 64;
+    static constexpr size_t MAX_GLOBAL_SIZE = 65536;
+    static constexpr size_t MAX_LOCAL_SIZE = 1024;
+
+    /*
+     * Sample distinct valid candidates
+     *
+     * Gives up after many duplicates or invalid samples, as small
+     * parameter spaces may have less valid candidates than requested.
+     */
+    std::vector<Candidate> sample_candidates() {
+        std::mt19937_64 rgen(this->options.seed());
+        std::vector<Candidate> candidates;
+        std::set<std::string> seen;
+
+        size_t const max_attempts = 1000 * this->options.candidates();
+        for (
+                size_t attempt = 0;
+                attempt < max_attempts
+                && candidates.size() < this->options.candidates();
+                ++attempt
+            )
+        {
+            Candidate candidate = sample(rgen);
+            if (not is_valid(candidate)) {
+                continue;
+            }
+
+            std::ostringstream key;
+            write_stages(key, candidate);
+            if (seen.insert(key.str()).second) {
+                candidates.push_back(candidate);
+            }
+        }
+
+        return candidates;
+    }
+
+    template <typename T>
+    static T pick(std::vector<T> const& values, std::mt19937_64& rgen) {
+        std::uniform_int_distribution<size_t> dist(0, values.size() - 1);
+        return values[dist(rgen)];
+    }
+
+    static std::vector<size_t> powers_of_two(size_t min, size_t max) {
+        std::vector<size_t> values;
+        for (size_t v = min; v <= max; v *= 2) {
+            values.push_back(v);
+        }
+        return values;
+    }
+
+    Candidate sample(std::mt19937_64& rgen) const {
+        std::vector<size_t> const global_sizes =
+            powers_of_two(MIN_GLOBAL_SIZE, MAX_GLOBAL_SIZE);
+        std::vector<size_t> const local_sizes =
+            powers_of_two(
+                    1,
+                    std::min(
+                        this->device.max_work_group_size(),
+                        (size_t) MAX_LOCAL_SIZE)
+                    );
+        std::vector<size_t> const vector_lengths =
+            powers_of_two(1, MAX_VECTOR_LENGTH);
+
+        std::vector<std::string> pipelines;
+        if (this->options.pipeline() == "all") {
+            pipelines = {"three_stage", "single_stage"};
+        }
+        else {
+            pipelines = {this->options.pipeline()};
+        }
+
+        Candidate c = {};
+        c.pipeline = pick(pipelines, rgen);
+
+        auto sizes = [&](size_t *global_size, size_t *local_size) {
+            global_size[0] = pick(global_sizes, rgen);
+            global_size[1] = 1;
+            global_size[2] = 1;
+            local_size[0] = pick(local_sizes, rgen);
+            local_size[1] = 1;
+            local_size[2] = 1;
+        };
+
+        c.ll_config.platform = this->options.platform();
+        c.ll_config.device = this->options.device();
+        c.ll_config.strategy = pick<std::string>(
+                {"unroll_vector", "tiled", "tiled_async"},
+                rgen);
+        sizes(c.ll_config.global_size, c.ll_config.local_size);
+        c.ll_config.vector_length = 1;
+        // Recorded as parameters, but not used by the kernels
+        c.ll_config.unroll_clusters_length = 1;
+        c.ll_config.unroll_features_length = 1;
+        if (c.ll_config.strategy == "unroll_vector") {
+            c.ll_config.vector_length = pick(vector_lengths, rgen);
+        }
+        else {
+            c.ll_config.tile_features = pick(powers_of_two(16, 512), rgen);
+            c.ll_config.tile_clusters = pick(powers_of_two(1, 16), rgen);
+        }
+
+        c.mu_config.platform = this->options.platform();
+        c.mu_config.device = this->options.device();
+        c.mu_config.strategy = pick<std::string>(
+                {"global_atomic", "part_global", "part_local", "part_private"},
+                rgen);
+        sizes(c.mu_config.global_size, c.mu_config.local_size);
+        c.mu_config.vector_length = 1;
+        if (c.mu_config.strategy == "part_private") {
+            c.mu_config.vector_length = pick(vector_lengths, rgen);
+        }
+
+        c.cu_config.platform = this->options.platform();
+        c.cu_config.device = this->options.device();
+        c.cu_config.strategy = pick<std::string>(
+                {
+                    "feature_sum",
+                    "feature_sum_pardim",
+                    "feature_sum_tiled",
+                    "cluster_merge"
+                },
+                rgen);
+        sizes(c.cu_config.global_size, c.cu_config.local_size);
+        c.cu_config.vector_length = 1;
+        if (
+                c.cu_config.strategy == "cluster_merge"
+                || c.cu_config.strategy == "feature_sum_pardim"
+           )
+        {
+            c.cu_config.vector_length = pick(vector_lengths, rgen);
+        }
+        if (c.cu_config.strategy == "feature_sum_pardim") {
+            c.cu_config.local_features = pick(powers_of_two(1, 16), rgen);
+            c.cu_config.thread_features = pick(powers_of_two(1, 8), rgen);
+        }
+        else if (c.cu_config.strategy == "feature_sum_tiled") {
+            c.cu_config.tile_features = pick(powers_of_two(16, 256), rgen);
+        }
+
+        c.fu_config.platform = this->options.platform();
+        c.fu_config.device = this->options.device();
+        c.fu_config.strategy = pick<std::string>(
+                {"cluster_merge", "feature_sum"},
+                rgen);
+        sizes(c.fu_config.global_size, c.fu_config.local_size);
+        c.fu_config.vector_length = pick(vector_lengths, rgen);
+
+        // Stages of the other pipeline are irrelevant
+        if (c.pipeline == "three_stage") {
+            c.fu_config = {};
+        }
+        else {
+            c.ll_config = {};
+            c.mu_config = {};
+            c.cu_config = {};
+        }
+
+        return c;
+    }
+
+    /*
+     * Constraints that strategies assert on, and device limits
+     *
+     * Remaining invalid candidates, e.g. due to the device's private
+     * memory, fail to launch or verify and are discarded later.
+     */
+    bool is_valid(Candidate const& c) const {
+        size_t const num_features = this->options.features();
+        size_t const num_clusters = this->options.k();
+        uint64_t const local_memory = this->device.local_memory_size();
+        uint64_t const constant_memory =
+            this->device.get_info<CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE>();
+        uint64_t const centroids_bytes =
+            num_clusters * num_features * sizeof(PointT);
+
+        auto valid_sizes = [&](size_t const *global_size, size_t const *local_size) {
+            return global_size[0] >= local_size[0]
+                && global_size[0] % local_size[0] == 0;
+        };
+
+        if (c.pipeline == "single_stage") {
+            return valid_sizes(c.fu_config.global_size, c.fu_config.local_size)
+                && num_features <= MAX_UNROLL_FEATURES
+                && centroids_bytes <= constant_memory;
+        }
+
+        if (
+                not valid_sizes(c.ll_config.global_size, c.ll_config.local_size)
+                || not valid_sizes(c.mu_config.global_size, c.mu_config.local_size)
+                || not valid_sizes(c.cu_config.global_size, c.cu_config.local_size)
+           )
+        {
+            return false;
+        }
+
+        if (c.ll_config.strategy == "unroll_vector") {
+            if (
+                    num_features > MAX_UNROLL_FEATURES
+                    || centroids_bytes > constant_memory
+               )
+            {
+                return false;
+            }
+        }
+        else {
+            // Double buffered tiles take twice the local memory
+            size_t const num_tiles =
+                (c.ll_config.strategy == "tiled_async") ? 2 : 1;
+            if (
+                    num_tiles
+                    * c.ll_config.tile_clusters * c.ll_config.tile_features
+                    * sizeof(PointT) > local_memory
+               )
+            {
+                return false;
+            }
+        }
+
+        if (c.cu_config.strategy == "feature_sum") {
+            return num_features <= c.cu_config.global_size[0];
+        }
+        else if (c.cu_config.strategy == "feature_sum_pardim") {
+            size_t const thread_features = c.cu_config.thread_features;
+            size_t const local_features =
+                std::min(c.cu_config.local_features, num_features);
+            size_t const num_feature_tiles = num_features / thread_features;
+
+            if (
+                    num_feature_tiles == 0
+                    || num_features % (thread_features * local_features) != 0
+                    || c.cu_config.global_size[0] < num_feature_tiles
+               )
+            {
+                return false;
+            }
+
+            if (num_feature_tiles > 1) {
+                size_t const local_points =
+                    c.cu_config.local_size[0] / local_features;
+                return local_points > 0
+                    && (c.cu_config.global_size[0] / num_feature_tiles)
+                    % local_points == 0;
+            }
+        }
+        else if (c.cu_config.strategy == "feature_sum_tiled") {
+            return num_clusters * c.cu_config.tile_features
+                * sizeof(PointT) <= local_memory;
+        }
+
+        return true;
+    }
+
+    /*
+     * Points around randomly placed centroids, with randomly assigned
+     * clusters such that neighbouring points have different labels
+     */
+    Points generate_points() const {
+        size_t const num_features = this->options.features();
+        size_t const num_clusters = this->options.k();
+
+        std::mt19937_64 rgen(this->options.seed());
+        std::uniform_real_distribution<PointT> domain(-100.0f, 100.0f);
+        std::normal_distribution<PointT> gaussian(0.0f, 10.0f);
+        std::uniform_int_distribution<size_t> cluster(0, num_clusters - 1);
+
+        Points centroids;
+        centroids.resize(num_clusters, num_features);
+        for (size_t c = 0; c < num_clusters; ++c) {
+            for (size_t f = 0; f < num_features; ++f) {
+                centroids(c, f) = domain(rgen);
+            }
+        }
+
+        Points points;
+        points.resize(this->num_points, num_features);
+        for (size_t p = 0; p < this->num_points; ++p) {
+            size_t const c = cluster(rgen);
+            for (size_t f = 0; f < num_features; ++f) {
+                points(p, f) = centroids(c, f) + gaussian(rgen);
+            }
+        }
+
+        return points;
+    }
+
+    ClusteringFunction create(Candidate const& c) {
+        if (c.pipeline == "three_stage") {
+            Clustering::KmeansThreeStage<
+                PointT,
+                LabelT,
+                MassT,
+                ColMajor> threestage;
+
+            threestage.set_labeling_queue(this->queue);
+            threestage.set_mass_update_queue(this->queue);
+            threestage.set_centroid_update_queue(this->queue);
+            threestage.set_labeling_context(this->context);
+            threestage.set_mass_update_context(this->context);
+            threestage.set_centroid_update_context(this->context);
+            threestage.set_labeler(c.ll_config);
+            threestage.set_mass_updater(c.mu_config);
+            threestage.set_centroid_updater(c.cu_config);
+            return threestage;
+        }
+        else {
+            Clustering::KmeansSingleStage<
+                PointT,
+                LabelT,
+                MassT,
+                ColMajor> singlestage;
+
+            singlestage.set_queue(this->queue);
+            singlestage.set_context(this->context);
+            singlestage.set_fused(c.fu_config);
+            return singlestage;
+        }
+    }
+
+    /*
+     * Verify candidate and measure the median time of runs
+     *
+     * Returns -1 if the candidate fails or produces wrong labels.
+     * Labels of points close to two centroids may differ due to
+     * rounding, thus a small fraction of differing labels is tolerated.
+     */
+    int measure(
+            Candidate& candidate,
+            size_t runs,
+            Benchmark& verify_bm,
+            Benchmark& bm)
+    {
+        std::vector<uint64_t> microseconds;
+        try {
+            ClusteringFunction kmeans = create(candidate);
+
+            verify_bm.verify(kmeans);
+            if (verify_bm.incorrect_label_fraction() > 0.001) {
+                if (this->options.verbose()) {
+                    write_rejected(candidate, "incorrect labels");
+                }
+                return -1;
+            }
+
+            for (size_t r = 0; r < runs; ++r) {
+                Clustering::ClusteringBenchmarkStats bs = bm.run(kmeans);
+                microseconds.push_back(bs.microseconds.front());
+            }
+        }
+        catch (std::exception const& e) {
+            if (this->options.verbose()) {
+                write_rejected(candidate, e.what());
+            }
+            return -1;
+        }
+
+        std::nth_element(
+                microseconds.begin(),
+                microseconds.begin() + microseconds.size() / 2,
+                microseconds.end());
+        candidate.microseconds = microseconds[microseconds.size() / 2];
+
+        if (this->options.verbose()) {
+            std::cerr << candidate.microseconds << " us: ";
+            write_summary(std::cerr, candidate);
+            std::cerr << std::endl;
+        }
+
+        return 1;
+    }
+
+    void write_rejected(Candidate const& c, char const *reason) const {
+        std::cerr << "Rejected (" << reason << "): ";
+        write_summary(std::cerr, c);
+        std::cerr << std::endl;
+    }
+
+    static void write_summary(std::ostream& os, Candidate const& c) {
+        if (c.pipeline == "three_stage") {
+            os
+                << c.ll_config.strategy << " "
+                << c.mu_config.strategy << " "
+                << c.cu_config.strategy;
+        }
+        else {
+            os << c.fu_config.strategy;
+        }
+    }
+
+    void write_configuration(std::ostream& os, Candidate const& c) const {
+        os
+            << "# Tuned for " << this->device.name()
+            << " with " << this->options.features() << " features and "
+            << this->options.k() << " clusters" << std::endl
+            << std::endl
+            << "[benchmark]" << std::endl
+            << "runs = 1" << std::endl
+            << "verify = false" << std::endl
+            << std::endl
+            << "[kmeans]" << std::endl
+            << "clusters = " << this->options.k() << std::endl
+            << "pipeline = " << c.pipeline << std::endl
+            << "iterations = " << this->options.iterations() << std::endl
+            << "converge = false" << std::endl
+            << "types.point = float" << std::endl
+            << "types.label = uint32" << std::endl
+            << "types.mass = uint32" << std::endl
+            << std::endl;
+
+        write_stages(os, c);
+    }
+
+    static void write_stages(std::ostream& os, Candidate const& c) {
+        if (c.pipeline == "three_stage") {
+            os
+                << "[kmeans.labeling]" << std::endl
+                << "platform = " << c.ll_config.platform << std::endl
+                << "device = " << c.ll_config.device << std::endl
+                << "strategy = " << c.ll_config.strategy << std::endl
+                << "global_size = " << c.ll_config.global_size[0] << std::endl
+                << "local_size = " << c.ll_config.local_size[0] << std::endl
+                << "vector_length = " << c.ll_config.vector_length << std::endl
+                << "unroll_clusters_length = "
+                << c.ll_config.unroll_clusters_length << std::endl
+                << "unroll_features_length = "
+                << c.ll_config.unroll_features_length << std::endl
+                << "tile_features = " << c.ll_config.tile_features << std::endl
+                << "tile_clusters = " << c.ll_config.tile_clusters << std::endl
+                << std::endl
+                << "[kmeans.mass_update]" << std::endl
+                << "platform = " << c.mu_config.platform << std::endl
+                << "device = " << c.mu_config.device << std::endl
+                << "strategy = " << c.mu_config.strategy << std::endl
+                << "global_size = " << c.mu_config.global_size[0] << std::endl
+                << "local_size = " << c.mu_config.local_size[0] << std::endl
+                << "vector_length = " << c.mu_config.vector_length << std::endl
+                << std::endl
+                << "[kmeans.centroid_update]" << std::endl
+                << "platform = " << c.cu_config.platform << std::endl
+                << "device = " << c.cu_config.device << std::endl
+                << "strategy = " << c.cu_config.strategy << std::endl
+                << "global_size = " << c.cu_config.global_size[0] << std::endl
+                << "local_size = " << c.cu_config.local_size[0] << std::endl
+                << "vector_length = " << c.cu_config.vector_length << std::endl
+                << "local_features = " << c.cu_config.local_features << std::endl
+                << "thread_features = " << c.cu_config.thread_features << std::endl
+                << "tile_features = " << c.cu_config.tile_features << std::endl;
+        }
+        else {
+            os
+                << "[kmeans.fused]" << std::endl
+                << "platform = " << c.fu_config.platform << std::endl
+                << "device = " << c.fu_config.device << std::endl
+                << "strategy = " << c.fu_config.strategy << std::endl
+                << "global_size = " << c.fu_config.global_size[0] << std::endl
+                << "local_size = " << c.fu_config.local_size[0] << std::endl
+                << "vector_length = " << c.fu_config.vector_length << std::endl;
+        }
+    }
+
+    CmdOptions options;
+    bc::device device;
+    bc::context context;
+    bc::command_queue queue;
+    size_t num_points;
+};
+
+int main(int argc, char **argv) {
+    int ret = 0;
+
+    CmdOptions options;
+
+    ret = options.parse(argc, argv);
+    if (ret < 0) {
+        return -1;
+    }
+
+    Tuner tuner;
+    ret = tuner.run(options);
+    if (ret < 0) {
+        return ret;
+    }
+
+    return 0;
+}